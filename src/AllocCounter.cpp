@@ -0,0 +1,40 @@
+#include "AllocCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<uint64_t> allocationCount = 0;
+
+namespace AllocCounter {
+
+uint64_t GetCount()
+{
+	return allocationCount.load(std::memory_order_relaxed);
+}
+
+} // namespace AllocCounter
+
+//---
+
+// The other forms (arrays, nothrow) call these in libstdc++.
+
+void* operator new(size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	const size_t align = size_t(alignment);
+	if (void* p = aligned_alloc(align, (size + align - 1) / align * align)) return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { free(p); }
@@ -0,0 +1,14 @@
+#pragma once
+
+// Counts heap allocations made through the global operator new, so that
+// benchmarks can check that a code path does not allocate. Linking
+// AllocCounter.o into a program replaces its operator new and delete.
+
+#include <cstdint>
+
+namespace AllocCounter {
+
+/// Returns the number of allocations so far (in all threads).
+uint64_t GetCount();
+
+} // namespace AllocCounter
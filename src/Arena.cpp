@@ -0,0 +1,61 @@
+#include "Arena.h"
+
+#include <algorithm>
+
+//---
+
+void Arena::Release(const Marker &marker)
+{
+	if (marker.current == 0) {	// taken before the first allocation
+		Reset();
+		return;
+	}
+	blockIndex = marker.block;
+	current = marker.current;
+	if (blockIndex < blocks.size()) {
+		end = reinterpret_cast<uintptr_t>(blocks[blockIndex].memory.get()) + blocks[blockIndex].size;
+	}
+}
+
+//---
+
+void Arena::Reset()
+{
+	blockIndex = 0;
+	if (blocks.empty()) {
+		current = end = 0;
+	}
+	else {
+		current = reinterpret_cast<uintptr_t>(blocks[0].memory.get());
+		end = current + blocks[0].size;
+	}
+}
+
+//---
+
+size_t Arena::GetCapacity() const
+{
+	size_t capacity = 0;
+	for (const Block &block : blocks) {
+		capacity += block.size;
+	}
+	return capacity;
+}
+
+//---
+
+uintptr_t Arena::NextBlock(size_t size, size_t alignment)
+{
+	// reuse the following blocks if they are large enough, otherwise insert a new one
+	size_t next = blocks.empty() ? 0 : blockIndex + 1;
+	while (next < blocks.size() && blocks[next].size < size + alignment) next++;
+	if (next == blocks.size()) {
+		const size_t newSize = std::max(blockSize, size + alignment);
+		blocks.push_back(Block{ std::make_unique<uint8_t[]>(newSize), newSize });
+	}
+
+	blockIndex = next;
+	const uintptr_t begin = reinterpret_cast<uintptr_t>(blocks[next].memory.get());
+	end = begin + blocks[next].size;
+	return (begin + alignment - 1) & ~uintptr_t(alignment - 1);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <type_traits>
+
+/**
+ * Bump allocator for short-lived, trivially destructible objects (search
+ * nodes and the like). Allocation is a pointer increment; memory is given
+ * back all at once by Reset(), or down to a marker by Release(), in stack
+ * order. Blocks are kept for reuse, so a warmed-up arena does not touch
+ * the heap. Not thread-safe: use one per thread.
+ */
+class Arena
+{
+public:
+
+	static const size_t DEFAULT_BLOCK_SIZE = 256 * 1024;
+
+	explicit Arena(size_t blockSize_ = DEFAULT_BLOCK_SIZE) : blockSize(blockSize_) {}
+	Arena(const Arena&) = delete;
+	Arena(Arena&&) = default;
+
+	/// Room for `count` objects of type T, uninitialized.
+	template <typename T>
+	T* Allocate(size_t count = 1) {
+		static_assert(std::is_trivially_destructible_v<T>, "Arena never runs destructors");
+		return static_cast<T*>(AllocateBytes(sizeof(T) * count, alignof(T)));
+	}
+
+	void* AllocateBytes(size_t size, size_t alignment) {
+		uintptr_t start = (current + alignment - 1) & ~uintptr_t(alignment - 1);
+		if (start + size > end) {
+			start = NextBlock(size, alignment);
+		}
+		current = start + size;
+		return reinterpret_cast<void*>(start);
+	}
+
+	/// Position to return to with Release().
+	struct Marker {
+		size_t block;
+		uintptr_t current;
+	};
+
+	Marker GetMarker() const { return Marker{ blockIndex, current }; }
+
+	/// Frees everything allocated since the marker was taken.
+	void Release(const Marker &marker);
+
+	/// Frees everything.
+	void Reset();
+
+	/// Bytes held in blocks (the high water mark).
+	size_t GetCapacity() const;
+
+protected:
+
+	/// Moves on to the next block that can hold `size` bytes, allocating it if needed.
+	/// \return The aligned start of the allocation.
+	uintptr_t NextBlock(size_t size, size_t alignment);
+
+	struct Block {
+		std::unique_ptr<uint8_t[]> memory;
+		size_t size;
+	};
+
+	size_t blockSize;
+	std::vector<Block> blocks;
+	size_t blockIndex = 0;		///< The block being allocated from (if any).
+	uintptr_t current = 0;
+	uintptr_t end = 0;
+};
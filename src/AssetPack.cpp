@@ -0,0 +1,185 @@
+#include "AssetPack.h"
+#include "SDL.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+
+//---
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+//---
+
+AssetPack::AssetPack(const char* fileName, const MappedFile::Options &options)
+	: file(fileName, options)
+{
+	if (!file.Ok()) return;
+	if (!Validate()) {
+		file.Unmap();
+	}
+}
+
+//---
+
+bool AssetPack::Validate()
+{
+	const uint64_t fileSize = file.GetSize();
+	if (fileSize < sizeof(Header)) {
+		SDL_SetError("AssetPack: the file is too short");
+		return false;
+	}
+
+	const Header* candidate = reinterpret_cast<const Header*>(file.GetData());
+	if (memcmp(candidate->magic, kMagic, sizeof(kMagic)) != 0
+		|| candidate->version != kVersion || candidate->headerSize != sizeof(Header)
+	) {
+		SDL_SetError("AssetPack: not an asset pack, or of an unsupported version");
+		return false;
+	}
+	if (candidate->fileSize != fileSize
+		|| candidate->entriesOffset % alignof(Entry) != 0
+		|| candidate->entriesOffset + uint64_t(candidate->entryCount) * sizeof(Entry) > fileSize
+		|| candidate->namesOffset + candidate->namesSize > fileSize
+	) {
+		SDL_SetError("AssetPack: the index is truncated or corrupt");
+		return false;
+	}
+
+	entries = reinterpret_cast<const Entry*>(file.GetData() + candidate->entriesOffset);
+	names = reinterpret_cast<const char*>(file.GetData() + candidate->namesOffset);
+
+	// every entry must point inside the file, and the names must be sorted for Find()
+	for (uint32_t i = 0; i < candidate->entryCount; i++) {
+		const Entry &entry = entries[i];
+		if (uint64_t(entry.nameOffset) + entry.nameLength > candidate->namesSize
+			|| entry.offset % kDataAlignment != 0
+			|| entry.offset + entry.size > fileSize
+			|| (i > 0 && !(GetName(entries[i - 1]) < GetName(entry)))
+		) {
+			SDL_SetError("AssetPack: entry %u is corrupt", i);
+			return false;
+		}
+	}
+
+	header = candidate;
+	return true;
+}
+
+//---
+
+bool AssetPack::Find(std::string_view name, std::span<const uint8_t> &data) const
+{
+	if (!header) return false;
+
+	const Entry* end = entries + header->entryCount;
+	const Entry* found = std::lower_bound(entries, end, name,
+		[this](const Entry &entry, std::string_view key) { return GetName(entry) < key; });
+	if (found == end || GetName(*found) != name) return false;
+
+	data = std::span<const uint8_t>(file.GetData() + found->offset, found->size);
+	return true;
+}
+
+//---
+
+/// Copies the whole file into `out`; returns the number of bytes copied, or -1 on error.
+static int64_t CopyFile(const char* fileName, FILE* out)
+{
+	FILE* in = fopen(fileName, "rb");
+	if (!in) return -1;
+
+	static const size_t kChunkSize = 64 * 1024;
+	std::vector<uint8_t> chunk(kChunkSize);
+	int64_t copied = 0;
+	size_t count;
+	while ((count = fread(chunk.data(), 1, kChunkSize, in)) > 0) {
+		if (fwrite(chunk.data(), 1, count, out) != count) {
+			fclose(in);
+			return -1;
+		}
+		copied += int64_t(count);
+	}
+	const bool failed = ferror(in) != 0;
+	fclose(in);
+	return failed ? -1 : copied;
+}
+
+//---
+
+bool AssetPack::Write(const char* fileName, std::vector<Source> sources)
+{
+	std::sort(sources.begin(), sources.end(),
+		[](const Source &a, const Source &b) { return a.name < b.name; });
+
+	Header header = {};
+	memcpy(header.magic, kMagic, sizeof(kMagic));
+	header.version = kVersion;
+	header.headerSize = sizeof(Header);
+	header.entryCount = uint32_t(sources.size());
+	header.entriesOffset = AlignUp(sizeof(Header), alignof(Entry));
+	header.namesOffset = header.entriesOffset + sources.size() * sizeof(Entry);
+
+	std::vector<Entry> entries(sources.size());
+	for (size_t i = 0; i < sources.size(); i++) {
+		if (i > 0 && sources[i].name == sources[i - 1].name) {
+			SDL_SetError("AssetPack::Write(): duplicate name %s", sources[i].name.c_str());
+			return false;
+		}
+		entries[i].nameOffset = uint32_t(header.namesSize);
+		entries[i].nameLength = uint32_t(sources[i].name.size());
+		header.namesSize += sources[i].name.size();
+	}
+
+	uint64_t offset = header.namesOffset + header.namesSize;
+	for (size_t i = 0; i < sources.size(); i++) {
+		struct stat fileMetadata;
+		if (stat(sources[i].fileName.c_str(), &fileMetadata) != 0) {
+			SDL_SetError("AssetPack::Write(): could not stat %s", sources[i].fileName.c_str());
+			return false;
+		}
+		entries[i].offset = AlignUp(offset, kDataAlignment);
+		entries[i].size = uint64_t(fileMetadata.st_size);
+		offset = entries[i].offset + entries[i].size;
+	}
+	header.fileSize = offset;
+
+	const std::string tempFileName = std::string(fileName) + ".tmp";
+	FILE* f = fopen(tempFileName.c_str(), "wb");
+	if (!f) {
+		SDL_SetError("AssetPack::Write(): could not create %s", tempFileName.c_str());
+		return false;
+	}
+
+	static const uint8_t zeroes[kDataAlignment] = { 0 };
+	bool written = (fwrite(&header, sizeof(header), 1, f) == 1)
+		&& (fwrite(zeroes, 1, header.entriesOffset - sizeof(header), f) == header.entriesOffset - sizeof(header))
+		&& (entries.empty() || fwrite(entries.data(), sizeof(Entry), entries.size(), f) == entries.size());
+	for (const Source &source : sources) {
+		written = written && (fwrite(source.name.data(), 1, source.name.size(), f) == source.name.size());
+	}
+	uint64_t position = header.namesOffset + header.namesSize;
+	for (size_t i = 0; i < sources.size() && written; i++) {
+		const size_t padding = size_t(entries[i].offset - position);
+		written = (fwrite(zeroes, 1, padding, f) == padding)
+			&& (CopyFile(sources[i].fileName.c_str(), f) == int64_t(entries[i].size));
+		position = entries[i].offset + entries[i].size;
+	}
+
+	if (fclose(f) != 0 || !written) {
+		SDL_SetError("AssetPack::Write(): could not write %s", tempFileName.c_str());
+		remove(tempFileName.c_str());
+		return false;
+	}
+
+	if (rename(tempFileName.c_str(), fileName) != 0) {
+		SDL_SetError("AssetPack::Write(): could not rename %s", tempFileName.c_str());
+		remove(tempFileName.c_str());
+		return false;
+	}
+	return true;
+}
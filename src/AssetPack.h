@@ -0,0 +1,96 @@
+#pragma once
+
+// Single-file archive of game assets (fonts, textures, shaders, level data),
+// mapped once and read in place instead of opening every file separately.
+//
+// Layout: a fixed Header, the Entry table sorted by name (so that lookups
+// are a binary search), the names (concatenated, not terminated), then the
+// data of the assets, each starting at a multiple of kDataAlignment.
+// Packs are built with the mjpack tool (`make pack`) or AssetPack::Write().
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MapFile.h"
+
+class AssetPack
+{
+public:
+
+	static constexpr char kMagic[8] = { 'M', 'J', 'A', 'S', 'S', 'E', 'T', 'S' };
+	static const uint32_t kVersion = 1;
+
+	/// Alignment of the data of every asset within the file (a cache line,
+	/// enough for SIMD loads and for uploading to the GPU straight from the mapping).
+	static const size_t kDataAlignment = 64;
+
+	struct Header
+	{
+		char magic[8];			///< kMagic
+		uint32_t version;		///< kVersion
+		uint32_t headerSize;	///< sizeof(Header), guards against layout changes
+		uint32_t entryCount;
+		uint32_t reserved;
+		uint64_t entriesOffset;	///< Offset of the Entry table.
+		uint64_t namesOffset;	///< Offset of the name characters.
+		uint64_t namesSize;
+		uint64_t fileSize;		///< Total size, to detect truncated files.
+	};
+
+	struct Entry
+	{
+		uint64_t offset;		///< Offset of the data, a multiple of kDataAlignment.
+		uint64_t size;
+		uint32_t nameOffset;	///< Offset of the name within the names.
+		uint32_t nameLength;
+	};
+
+	/// A file to be packed: the name it will be found under, and where to read it from.
+	struct Source
+	{
+		std::string name;
+		std::string fileName;
+	};
+
+	/**
+	 * Maps the pack and checks its index.
+	 * On error, the object is invalid (see Ok()) and SDL_SetError() is used.
+	 */
+	explicit AssetPack(const char* fileName, const MappedFile::Options &options = MappedFile::Options());
+	AssetPack(const AssetPack&) = delete;
+
+	bool Ok() const { return header != nullptr; }
+
+	/**
+	 * Finds an asset by name (binary search in the index).
+	 * \param data Set to the asset's bytes within the mapping (valid while the pack lives).
+	 * \return False if there is no such asset.
+	 */
+	bool Find(std::string_view name, std::span<const uint8_t> &data) const;
+
+	size_t GetEntryCount() const { return header ? header->entryCount : 0; }
+	std::string_view GetName(size_t index) const { return GetName(entries[index]); }
+
+	/// Returns the underlying mapping (e.g. to give access hints).
+	MappedFile& GetFile() { return file; }
+
+	/**
+	 * Writes a pack of the given files. It is written under a temporary name
+	 * and renamed at the end, as FontCache::Write() does.
+	 * \return True on success; on error, SDL_SetError() is used.
+	 */
+	static bool Write(const char* fileName, std::vector<Source> sources);
+
+protected:
+
+	bool Validate();
+	std::string_view GetName(const Entry &entry) const { return std::string_view(names + entry.nameOffset, entry.nameLength); }
+
+	MappedFile file;
+	const Header* header = nullptr;
+	const Entry* entries = nullptr;
+	const char* names = nullptr;
+};
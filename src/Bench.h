@@ -0,0 +1,86 @@
+#pragma once
+
+// Minimal harness for the benchmark executable (mjbench); the timing helpers
+// are also used by the headless benchmark mode of the game (mjewels --bench).
+// Each benchmark is a function registered with BENCHMARK(); run
+// `mjbench` to list them and `mjbench <name> [args...]` to run one.
+
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+namespace Bench {
+
+using Clock = std::chrono::steady_clock;
+
+/// Signature of a benchmark; returns the process exit code.
+using Function = int (*)(int argc, const char** argv);
+
+/// Registers a benchmark (used by the BENCHMARK() macro).
+struct Registration
+{
+	Registration(const char* name, const char* description, Function function);
+};
+
+/// Measures wall time from construction (or Restart()).
+class Stopwatch
+{
+public:
+
+	Stopwatch() : start(Clock::now()) {}
+	void Restart() { start = Clock::now(); }
+
+	double ElapsedMs() const
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+protected:
+
+	Clock::time_point start;
+};
+
+/// Returns the given percentile (0 to 100, nearest rank) of the samples (reorders them).
+inline double Percentile(std::vector<double>& samples, double percentile)
+{
+	if (samples.empty()) return 0.0;
+	const size_t rank = std::min(samples.size() - 1, size_t(percentile / 100.0 * double(samples.size())));
+	auto nth = samples.begin() + rank;
+	std::nth_element(samples.begin(), nth, samples.end());
+	return *nth;
+}
+
+/// Returns the median of the samples (reorders them).
+inline double Median(std::vector<double>& samples)
+{
+	return Percentile(samples, 50.0);
+}
+
+/// Selects SDL's offscreen (EGL) video driver and Mesa's software rasterizer,
+/// unless the environment says otherwise; call before SDL_Init().
+inline void UseHeadlessVideo()
+{
+	setenv("SDL_VIDEODRIVER", "offscreen", 0);
+	setenv("LIBGL_ALWAYS_SOFTWARE", "1", 0);
+	setenv("GALLIUM_DRIVER", "llvmpipe", 0);
+}
+
+/// Drops the file's pages from the page cache (for cold-start measurements), writing them
+/// back first if dirty; returns the fraction of its pages still resident afterwards.
+double EvictFromPageCache(const char* fileName);
+
+/// Font used by benchmarks that need one (unless given on the command line).
+extern const char* kDefFontFile;
+
+} // namespace Bench
+
+#define BENCH_CONCAT_(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_(a, b)
+
+/// Defines and registers a benchmark function with the given name.
+#define BENCHMARK(name, description) \
+	static int BENCH_CONCAT(BenchFunction_, __LINE__)(int argc, const char** argv); \
+	static Bench::Registration BENCH_CONCAT(benchRegistration_, __LINE__)( \
+		name, description, BENCH_CONCAT(BenchFunction_, __LINE__)); \
+	static int BENCH_CONCAT(BenchFunction_, __LINE__)(int argc, const char** argv)
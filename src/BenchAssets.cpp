@@ -0,0 +1,120 @@
+#include "Bench.h"
+#include "MapFile.h"
+#include "AssetPack.h"
+#include "SDL.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//---
+
+/// Sums the bytes, so that every page of an asset is actually read.
+static uint64_t Checksum(const uint8_t* data, size_t size)
+{
+	uint64_t sum = 0;
+	for (size_t i = 0; i < size; i++) sum += data[i];
+	return sum;
+}
+
+//---
+
+BENCHMARK("asset-pack", "Loading many assets: one MappedFile per file vs one AssetPack, warm and cold [count] [runs]")
+{
+	const int assetCount = (argc > 1) ? atoi(argv[1]) : 256;
+	const int runs = (argc > 2) ? atoi(argv[2]) : 10;
+	const std::string directory = "mjbench-assets";
+	const std::string packFileName = "mjbench-assets.pack";
+
+	// assets of mixed sizes (shaders and levels are small, textures and fonts big)
+	mkdir(directory.c_str(), 0755);
+	std::vector<AssetPack::Source> sources;
+	uint32_t rng = 12345;
+	auto nextRandom = [&rng]() { rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5; return rng; };
+	for (int i = 0; i < assetCount; i++) {
+		const size_t size = (i % 8 == 0) ? 64 * 1024 + nextRandom() % (192 * 1024) : 256 + nextRandom() % 8192;
+		std::vector<uint8_t> content(size);
+		for (uint8_t &byte : content) byte = uint8_t(nextRandom());
+
+		const std::string name = "asset" + std::to_string(i) + ".bin";
+		const std::string fileName = directory + "/" + name;
+		FILE* f = fopen(fileName.c_str(), "wb");
+		if (!f || fwrite(content.data(), 1, size, f) != size) {
+			fprintf(stderr, "asset-pack: could not write %s\n", fileName.c_str());
+			if (f) fclose(f);
+			return 1;
+		}
+		fclose(f);
+		sources.push_back(AssetPack::Source{ name, fileName });
+	}
+	if (!AssetPack::Write(packFileName.c_str(), sources)) {
+		fprintf(stderr, "asset-pack: %s\n", SDL_GetError());
+		return 1;
+	}
+
+	auto loadFiles = [&sources]() {
+		uint64_t sum = 0;
+		for (const AssetPack::Source &source : sources) {
+			MappedFile file(source.fileName.c_str());
+			sum += Checksum(file.GetData(), file.GetSize());
+		}
+		return sum;
+	};
+	auto loadPack = [&sources, &packFileName]() {
+		uint64_t sum = 0;
+		AssetPack pack(packFileName.c_str());
+		for (const AssetPack::Source &source : sources) {
+			std::span<const uint8_t> data;
+			if (pack.Find(source.name, data)) sum += Checksum(data.data(), data.size());
+		}
+		return sum;
+	};
+	double residentAfterEviction = 0.0;
+	auto evictAll = [&sources, &packFileName, &residentAfterEviction]() {
+		for (const AssetPack::Source &source : sources) {
+			residentAfterEviction = std::max(residentAfterEviction, Bench::EvictFromPageCache(source.fileName.c_str()));
+		}
+		residentAfterEviction = std::max(residentAfterEviction, Bench::EvictFromPageCache(packFileName.c_str()));
+	};
+
+	std::vector<double> filesWarm, packWarm, filesCold, packCold;
+	bool identical = true;
+	for (int run = 0; run < runs; run++) {
+		Bench::Stopwatch stopwatch;
+		const uint64_t filesSum = loadFiles();
+		filesWarm.push_back(stopwatch.ElapsedMs());
+		stopwatch.Restart();
+		const uint64_t packSum = loadPack();
+		packWarm.push_back(stopwatch.ElapsedMs());
+		identical = identical && filesSum == packSum;
+
+		evictAll();
+		stopwatch.Restart();
+		const uint64_t filesColdSum = loadFiles();
+		filesCold.push_back(stopwatch.ElapsedMs());
+		evictAll();
+		stopwatch.Restart();
+		const uint64_t packColdSum = loadPack();
+		packCold.push_back(stopwatch.ElapsedMs());
+		identical = identical && filesColdSum == packColdSum && filesColdSum == filesSum;
+	}
+
+	for (const AssetPack::Source &source : sources) remove(source.fileName.c_str());
+	rmdir(directory.c_str());
+	remove(packFileName.c_str());
+
+	printf("asset-pack.assets %d\n", assetCount);
+	printf("asset-pack.files_warm_ms %.3f\n", Bench::Median(filesWarm));
+	printf("asset-pack.pack_warm_ms %.3f\n", Bench::Median(packWarm));
+	printf("asset-pack.files_cold_ms %.3f\n", Bench::Median(filesCold));
+	printf("asset-pack.pack_cold_ms %.3f\n", Bench::Median(packCold));
+	printf("asset-pack.identical %d\n", identical ? 1 : 0);
+
+	// if eviction did not work (e.g. no permission), the cold numbers above are warm
+	printf("asset-pack.resident_after_eviction %.2f\n", residentAfterEviction);
+	return identical ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+#include "Bench.h"
+#include "Board.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+/**
+ * The straightforward board, one colour per cell, with the same rules and the
+ * same order of random numbers as Board: the baseline, and a check of the bitboards.
+ */
+struct ReferenceBoard
+{
+	static const int N = Board::SIZE;
+	int cells[N][N];	// [column][row], -1 = empty
+	int colorCount;
+
+	explicit ReferenceBoard(int colorCount_) : colorCount(colorCount_) {
+		for (auto& column : cells) for (int& cell : column) cell = -1;
+	}
+
+	void Refill(Random &random) {
+		for (auto& column : cells) for (int& cell : column) {
+			if (cell < 0) cell = random.NextBelow(colorCount);
+		}
+	}
+
+	int ClearMatches() {
+		bool matched[N][N] = {};
+		for (int column = 0; column < N; column++) {
+			for (int row = 0; row < N; row++) {
+				const int color = cells[column][row];
+				if (color < 0) continue;
+				if (row + 2 < N && cells[column][row + 1] == color && cells[column][row + 2] == color) {
+					matched[column][row] = matched[column][row + 1] = matched[column][row + 2] = true;
+				}
+				if (column + 2 < N && cells[column + 1][row] == color && cells[column + 2][row] == color) {
+					matched[column][row] = matched[column + 1][row] = matched[column + 2][row] = true;
+				}
+			}
+		}
+		int removed = 0;
+		for (int column = 0; column < N; column++) {
+			for (int row = 0; row < N; row++) {
+				if (matched[column][row]) {
+					cells[column][row] = -1;
+					removed++;
+				}
+			}
+		}
+		return removed;
+	}
+
+	void Collapse() {
+		for (auto& column : cells) {
+			int bottom = 0;
+			for (int row = 0; row < N; row++) {
+				if (column[row] >= 0) column[bottom++] = column[row];
+			}
+			while (bottom < N) column[bottom++] = -1;
+		}
+	}
+
+	Board::Cascade Resolve(Random &random) {
+		Board::Cascade cascade;
+		while (int removed = ClearMatches()) {
+			cascade.steps++;
+			cascade.removed += removed;
+			Collapse();
+			Refill(random);
+		}
+		return cascade;
+	}
+
+	bool Equals(const Board &board) const {
+		for (int column = 0; column < N; column++) {
+			for (int row = 0; row < N; row++) {
+				if (board.GetColor(column, row) != cells[column][row]) return false;
+			}
+		}
+		return true;
+	}
+};
+
+} // namespace
+
+//---
+
+BENCHMARK("board-resolve", "Random boards resolved per second (match, remove, gravity, refill): bitboards vs per-cell [boards] [colors]")
+{
+	const int boards = (argc > 1) ? atoi(argv[1]) : 200000;
+	const int colorCount = (argc > 2) ? atoi(argv[2]) : Board::DEFAULT_COLORS;
+	const uint64_t seed = 12345;
+
+	// random boards are full of runs: most take several rounds of cascades
+	Random random(seed);
+	Bench::Stopwatch stopwatch;
+	long long steps = 0, removed = 0;
+	Board board(colorCount);
+	for (int i = 0; i < boards; i++) {
+		board.Remove(Board::kFull);
+		board.Refill(random);
+		const Board::Cascade cascade = board.Resolve(random);
+		steps += cascade.steps;
+		removed += cascade.removed;
+	}
+	const double bitboardMs = stopwatch.ElapsedMs();
+
+	Random referenceRandom(seed);
+	stopwatch.Restart();
+	long long referenceSteps = 0, referenceRemoved = 0;
+	ReferenceBoard reference(board.GetColorCount());
+	for (int i = 0; i < boards; i++) {
+		reference = ReferenceBoard(board.GetColorCount());
+		reference.Refill(referenceRandom);
+		const Board::Cascade cascade = reference.Resolve(referenceRandom);
+		referenceSteps += cascade.steps;
+		referenceRemoved += cascade.removed;
+	}
+	const double referenceMs = stopwatch.ElapsedMs();
+
+	const bool identical = reference.Equals(board) && steps == referenceSteps && removed == referenceRemoved
+		&& random.GetState() == referenceRandom.GetState();
+
+	printf("board-resolve.cascade_steps_per_board %.2f\n", double(steps) / boards);
+	printf("board-resolve.gems_removed_per_board %.2f\n", double(removed) / boards);
+	printf("board-resolve.bitboard_boards_per_second %.0f\n", boards * 1000.0 / bitboardMs);
+	printf("board-resolve.per_cell_boards_per_second %.0f\n", boards * 1000.0 / referenceMs);
+	printf("board-resolve.speedup %.2f\n", referenceMs / bitboardMs);
+	printf("board-resolve.identical %d\n", identical ? 1 : 0);
+	return identical ? 0 : 1;
+}
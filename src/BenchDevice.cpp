@@ -0,0 +1,172 @@
+#include "Bench.h"
+#include "MapFile.h"
+#include "LoadFont.h"
+#include "GLDevice.h"
+#include "TextRenderer.h"
+#include "SpriteBatch.h"
+#include "GemSprites.h"
+#include "GameView.h"
+#include "GpuProfiler.h"
+#include "Game.h"
+#include "SDLWrapper.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+struct FrameCosts {
+	double cpuMs = 0.0;			///< Issuing the frame (GPU work not included).
+	double frameMs = 0.0;		///< Whole frame, GPU included.
+	double issued = 0.0;		///< GL calls the device passed on.
+	double skipped = 0.0;		///< State calls the device dropped.
+	uint64_t hash = 0;			///< Of the last frame.
+};
+
+/// Draws the game screen `frames` times. \return Averages per frame.
+FrameCosts RunFrames(GL::Device &device, const Game &game, const Font &font,
+	TextRenderer &textRenderer, SpriteBatch &sprites, int width, int height, int frames)
+{
+	FrameCosts costs;
+	for (int frame = 0; frame < frames; frame++) {
+		Bench::Stopwatch stopwatch;
+		device.BeginFrame();
+		GameView::Draw(device, game, font, textRenderer, sprites, width, height);
+		costs.cpuMs += stopwatch.ElapsedMs();
+		costs.issued += double(device.GetFrame().issued);
+		costs.skipped += double(device.GetFrame().skipped);
+		glFinish();
+		costs.frameMs += stopwatch.ElapsedMs();
+	}
+	costs.cpuMs /= frames;
+	costs.frameMs /= frames;
+	costs.issued /= frames;
+	costs.skipped /= frames;
+
+	// FNV-1a of the framebuffer, to check that skipping calls changed nothing
+	std::vector<uint8_t> pixels(size_t(width) * height * 4);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	costs.hash = 0xcbf29ce484222325ull;
+	for (uint8_t byte : pixels) {
+		costs.hash = (costs.hash ^ byte) * 0x100000001b3ull;
+	}
+	return costs;
+}
+
+} // namespace
+
+//---
+
+BENCHMARK("gl-state", "GL calls of the game screen with and without the device's redundant-state filter, headless [font] [frames]")
+{
+	const char* fontFileName = (argc > 1) ? argv[1] : Bench::kDefFontFile;
+	const int frames = (argc > 2) ? atoi(argv[2]) : 200;
+	const int width = 1280, height = 1024;
+
+	Bench::UseHeadlessVideo();
+	SDL::Library libSDL(SDL_INIT_VIDEO);
+	SDL::Window window("mjbench", width, height, SDL_WINDOW_HIDDEN);
+
+	MappedFile fontFile(fontFileName);
+	Font font(fontFile, 32.0f);
+	if (!fontFile.Ok() || !font.Ok()) {
+		fprintf(stderr, "gl-state: could not load %s\n", fontFileName);
+		return 1;
+	}
+	GL::Device device;
+	TextRenderer textRenderer(device, font);
+	SpriteBatch sprites(device, GemSprites::SIZE, GemSprites::LAYER_COUNT, 4096);
+	GemSprites::Load(sprites);
+
+	// a full board with a gem selected, so that every kind of sprite is drawn
+	Game game(1);
+	game.Apply(GameInput{ GameInput::Type::kMouseButton, Game::LEFT_BUTTON,
+		Game::BOARD_X + Game::CELL_SIZE * Board::SIZE / 2, Game::BOARD_Y + Game::CELL_SIZE * Board::SIZE / 2 });
+
+	// the first frame compiles shaders and allocates driver state; do not count it
+	RunFrames(device, game, font, textRenderer, sprites, width, height, 1);
+
+	device.SetShadowing(false);
+	const FrameCosts unfiltered = RunFrames(device, game, font, textRenderer, sprites, width, height, frames);
+	device.SetShadowing(true);
+	const FrameCosts filtered = RunFrames(device, game, font, textRenderer, sprites, width, height, frames);
+
+	printf("gl-state.renderer %s\n", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+	printf("gl-state.unfiltered_gl_calls_per_frame %.1f\n", unfiltered.issued);
+	printf("gl-state.unfiltered_cpu_ms %.4f\n", unfiltered.cpuMs);
+	printf("gl-state.unfiltered_frame_ms %.3f\n", unfiltered.frameMs);
+	printf("gl-state.filtered_gl_calls_per_frame %.1f\n", filtered.issued);
+	printf("gl-state.filtered_state_calls_skipped_per_frame %.1f\n", filtered.skipped);
+	printf("gl-state.filtered_cpu_ms %.4f\n", filtered.cpuMs);
+	printf("gl-state.filtered_frame_ms %.3f\n", filtered.frameMs);
+	printf("gl-state.gl_call_reduction %.2f\n", unfiltered.issued / filtered.issued);
+	printf("gl-state.same_image %s\n", (unfiltered.hash == filtered.hash) ? "yes" : "no");
+	return (unfiltered.hash == filtered.hash) ? 0 : 1;
+}
+
+//---
+
+BENCHMARK("gpu-passes", "GPU time per render pass of the game screen from timer queries, and the profiler's own cost, headless [font] [frames] [csv file]")
+{
+	const char* fontFileName = (argc > 1) ? argv[1] : Bench::kDefFontFile;
+	const int frames = (argc > 2) ? atoi(argv[2]) : 200;
+	const char* csvFileName = (argc > 3) ? argv[3] : nullptr;
+	const int width = 1280, height = 1024;
+
+	Bench::UseHeadlessVideo();
+	SDL::Library libSDL(SDL_INIT_VIDEO);
+	SDL::Window window("mjbench", width, height, SDL_WINDOW_HIDDEN);
+
+	MappedFile fontFile(fontFileName);
+	Font font(fontFile, 32.0f);
+	if (!fontFile.Ok() || !font.Ok()) {
+		fprintf(stderr, "gpu-passes: could not load %s\n", fontFileName);
+		return 1;
+	}
+	GL::Device device;
+	TextRenderer textRenderer(device, font);
+	SpriteBatch sprites(device, GemSprites::SIZE, GemSprites::LAYER_COUNT, 4096);
+	GemSprites::Load(sprites);
+	GpuProfiler profiler;
+
+	Game game(1);
+	game.Apply(GameInput{ GameInput::Type::kMouseButton, Game::LEFT_BUTTON,
+		Game::BOARD_X + Game::CELL_SIZE * Board::SIZE / 2, Game::BOARD_Y + Game::CELL_SIZE * Board::SIZE / 2 });
+
+	// frames are swapped, not finished, so that results come back as they would in the game
+	auto runFrames = [&](GpuProfiler* current) {
+		Bench::Stopwatch stopwatch;
+		for (int frame = 0; frame < frames; frame++) {
+			device.BeginFrame();
+			if (current) current->BeginFrame();
+			GameView::Draw(device, game, font, textRenderer, sprites, width, height, current, true);
+			SDL_GL_SwapWindow(window.getWindow());
+		}
+		glFinish();
+		return stopwatch.ElapsedMs() / frames;
+	};
+	runFrames(nullptr);		// warm-up
+	const double plainMs = runFrames(nullptr);
+	const double profiledMs = runFrames(&profiler);
+
+	printf("gpu-passes.renderer %s\n", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+	printf("gpu-passes.supported %s\n", profiler.IsSupported() ? "yes" : "no");
+	for (int pass = 0; pass < GpuProfiler::PASS_COUNT; pass++) {
+		const GpuProfiler::PassStats &stats = profiler.GetStats(GpuProfiler::Pass(pass));
+		const char* name = GpuProfiler::GetPassName(GpuProfiler::Pass(pass));
+		printf("gpu-passes.%s_frames %d\n", name, stats.samples);
+		printf("gpu-passes.%s_avg_ms %.4f\n", name, stats.averageMs);
+		printf("gpu-passes.%s_max_ms %.4f\n", name, stats.maxMs);
+	}
+	printf("gpu-passes.gpu_frame_ms %.4f\n", profiler.GetAverageFrameMs());
+	printf("gpu-passes.frames_measured %llu\n", (unsigned long long) profiler.GetMeasuredFrames());
+	printf("gpu-passes.frames_late %llu\n", (unsigned long long) profiler.GetLateFrames());
+	printf("gpu-passes.frame_ms_without_profiler %.3f\n", plainMs);
+	printf("gpu-passes.frame_ms_with_profiler %.3f\n", profiledMs);
+	if (csvFileName && !profiler.WriteCsv(csvFileName)) {
+		fprintf(stderr, "gpu-passes: %s\n", SDL_GetError());
+		return 1;
+	}
+	return (profiler.IsSupported() && profiler.GetMeasuredFrames() > 0) ? 0 : 1;
+}
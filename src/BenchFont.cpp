@@ -0,0 +1,363 @@
+#include "Bench.h"
+#include "MapFile.h"
+#include "LoadFont.h"
+#include "GlyphCache.h"
+#include "SDLWrapper.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+//---
+
+BENCHMARK("font-startup", "Font construction: cold (rasterize + store cache) vs warm (mapped cache) [font] [size] [runs]")
+{
+	const char* fontFileName = (argc > 1) ? argv[1] : Bench::kDefFontFile;
+	const float fontSize = (argc > 2) ? float(atof(argv[2])) : 32.0f;
+	const int runs = (argc > 3) ? atoi(argv[3]) : 10;
+	const std::string cacheFileName = "mjbench-font.cache";
+
+	std::vector<double> uncached, cold, warm;
+	for (int i = 0; i < runs; i++) {
+		{
+			Bench::Stopwatch stopwatch;
+			MappedFile fontFile(fontFileName);
+			Font font(fontFile, fontSize);
+			uncached.push_back(stopwatch.ElapsedMs());
+			if (!font.Ok()) {
+				fprintf(stderr, "font-startup: could not load %s\n", fontFileName);
+				return 1;
+			}
+		}
+
+		remove(cacheFileName.c_str());
+		{
+			Bench::Stopwatch stopwatch;
+			MappedFile fontFile(fontFileName);
+			Font font(fontFile, Font::Settings{ .size = fontSize, .cacheFileName = cacheFileName.c_str() });
+			cold.push_back(stopwatch.ElapsedMs());
+		}
+		{
+			Bench::Stopwatch stopwatch;
+			MappedFile fontFile(fontFileName);
+			Font font(fontFile, Font::Settings{ .size = fontSize, .cacheFileName = cacheFileName.c_str() });
+			warm.push_back(stopwatch.ElapsedMs());
+			if (!font.IsFromCache()) {
+				fprintf(stderr, "font-startup: the cache was not used on the warm start\n");
+				return 1;
+			}
+		}
+	}
+	remove(cacheFileName.c_str());
+
+	const double warmMs = Bench::Median(warm);
+	printf("font-startup.uncached_ms %.3f\n", Bench::Median(uncached));
+	printf("font-startup.cold_ms %.3f\n", Bench::Median(cold));
+	printf("font-startup.warm_ms %.3f\n", warmMs);
+	printf("font-startup.speedup %.1f\n", warmMs > 0.0 ? Bench::Median(cold) / warmMs : 0.0);
+	return 0;
+}
+
+//---
+
+BENCHMARK("font-parallel", "Font construction of several sizes: serial vs thread pool rendering [font] [threads]")
+{
+	const char* fontFileName = (argc > 1) ? argv[1] : Bench::kDefFontFile;
+	const int threadCount = (argc > 2) ? atoi(argv[2]) : 0;
+	const float sizes[] = { 12.0f, 16.0f, 20.0f, 24.0f, 32.0f, 36.0f, 40.0f, 44.0f };
+
+	MappedFile fontFile(fontFileName);
+	if (!fontFile.Ok()) {
+		fprintf(stderr, "font-parallel: could not map %s\n", fontFileName);
+		return 1;
+	}
+	ThreadPool threadPool(threadCount);
+
+	double serialMs = 0.0, parallelMs = 0.0;
+	bool identical = true;
+	for (float size : sizes) {
+		Bench::Stopwatch stopwatch;
+		Font serial(fontFile, size);
+		serialMs += stopwatch.ElapsedMs();
+
+		stopwatch.Restart();
+		Font parallel(fontFile, Font::Settings{ .size = size, .threadPool = &threadPool });
+		parallelMs += stopwatch.ElapsedMs();
+
+		if (!serial.Ok() || !parallel.Ok()) {
+			fprintf(stderr, "font-parallel: could not build the %g px atlas\n", size);
+			return 1;
+		}
+
+		SDL::Surface& a = serial.GetSurface();
+		SDL::Surface& b = parallel.GetSurface();
+		identical = identical && memcmp(a.GetPixels(), b.GetPixels(), size_t(a.GetPitch()) * a.GetHeight()) == 0;
+		for (int c = 0; c < Font::NUMBER_OF_CHARS; c++) {
+			stbtt_packedchar ga, gb;
+			serial.GetGlyphGeometry(c, ga);
+			parallel.GetGlyphGeometry(c, gb);
+			identical = identical && memcmp(&ga, &gb, sizeof(ga)) == 0;
+		}
+	}
+
+	printf("font-parallel.threads %d\n", threadPool.GetThreadCount());
+	printf("font-parallel.serial_ms %.3f\n", serialMs);
+	printf("font-parallel.parallel_ms %.3f\n", parallelMs);
+	printf("font-parallel.speedup %.2f\n", parallelMs > 0.0 ? serialMs / parallelMs : 0.0);
+	printf("font-parallel.identical %d\n", identical ? 1 : 0);
+	return identical ? 0 : 1;
+}
+
+//---
+
+BENCHMARK("glyph-cache", "On-demand glyph atlas with LRU eviction over a large codepoint set [font] [size] [frames]")
+{
+	const char* fontFileName = (argc > 1) ? argv[1] : Bench::kDefFontFile;
+	const float fontSize = (argc > 2) ? float(atof(argv[2])) : 24.0f;
+	const int frames = (argc > 3) ? atoi(argv[3]) : 2000;
+	const int glyphsPerFrame = 200;
+
+	MappedFile fontFile(fontFileName);
+	GlyphCache glyphCache(fontFile, fontSize, 512, 512);
+	if (!fontFile.Ok() || !glyphCache.Ok()) {
+		fprintf(stderr, "glyph-cache: could not load %s\n", fontFileName);
+		return 1;
+	}
+
+	// codepoints spread over the BMP with a skewed distribution, so that
+	// a small working set is hot and a long tail keeps forcing evictions
+	uint32_t rng = 12345;
+	auto nextRandom = [&rng]() { rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5; return rng; };
+
+	// glyphs used in a frame must stay where they are until its end, as quads drawn earlier sample them
+	std::vector<std::pair<char32_t, stbtt_packedchar>> usedThisFrame;
+	usedThisFrame.reserve(glyphsPerFrame);
+	uint64_t lookups = 0, failures = 0, moved = 0, dirtyRects = 0;
+	double elapsedMs = 0.0;
+	for (int frame = 0; frame < frames; frame++) {
+		usedThisFrame.clear();
+		Bench::Stopwatch stopwatch;
+		glyphCache.BeginFrame();
+		for (int i = 0; i < glyphsPerFrame; i++) {
+			const uint32_t r = nextRandom();
+			const char32_t codepoint = (r & 3) ? 0x20 + (r >> 8) % 0x60 : 0x100 + (r >> 8) % 0x2f00;
+			stbtt_packedchar glyphGeometry;
+			if (glyphCache.GetGlyphGeometry(codepoint, glyphGeometry)) {
+				usedThisFrame.emplace_back(codepoint, glyphGeometry);
+			}
+			else {
+				failures++;
+			}
+			lookups++;
+		}
+		dirtyRects += glyphCache.GetDirtyRects().size();
+		glyphCache.ClearDirtyRects();
+		elapsedMs += stopwatch.ElapsedMs();
+
+		for (const auto &[codepoint, geometry] : usedThisFrame) {
+			stbtt_packedchar now;
+			if (!glyphCache.GetGlyphGeometry(codepoint, now) || memcmp(&now, &geometry, sizeof(now)) != 0) moved++;
+		}
+	}
+
+	printf("glyph-cache.lookups %llu\n", (unsigned long long) lookups);
+	printf("glyph-cache.ns_per_lookup %.1f\n", elapsedMs * 1e6 / double(lookups));
+	printf("glyph-cache.miss_rate %.4f\n", double(glyphCache.GetMissCount()) / double(lookups));
+	printf("glyph-cache.evictions %llu\n", (unsigned long long) glyphCache.GetEvictionCount());
+	printf("glyph-cache.eviction_rounds %llu\n", (unsigned long long) glyphCache.GetGeneration());
+	printf("glyph-cache.resident_glyphs %zu\n", glyphCache.GetGlyphCount());
+	printf("glyph-cache.dirty_rects_per_frame %.2f\n", double(dirtyRects) / frames);
+	printf("glyph-cache.failures %llu\n", (unsigned long long) failures);
+	printf("glyph-cache.moved_in_frame %llu\n", (unsigned long long) moved);
+	return (failures == 0 && moved == 0) ? 0 : 1;
+}
+
+//---
+
+BENCHMARK("font-sdf", "One SDF atlas vs a bitmap atlas per HUD size: memory and construction time [font] [sdf size]")
+{
+	const char* fontFileName = (argc > 1) ? argv[1] : Bench::kDefFontFile;
+	const float sdfSize = (argc > 2) ? float(atof(argv[2])) : 32.0f;
+	const float hudSizes[] = { 12.0f, 16.0f, 20.0f, 24.0f, 32.0f, 40.0f };
+	const int sizeCount = int(sizeof(hudSizes) / sizeof(hudSizes[0]));
+
+	MappedFile fontFile(fontFileName);
+	if (!fontFile.Ok()) {
+		fprintf(stderr, "font-sdf: could not map %s\n", fontFileName);
+		return 1;
+	}
+
+	auto atlasBytes = [](Font &font) {
+		return size_t(font.GetSurface().GetPitch()) * font.GetSurface().GetHeight();
+	};
+
+	size_t bitmapBytes = 0;
+	Bench::Stopwatch stopwatch;
+	for (float size : hudSizes) {
+		Font font(fontFile, size);
+		if (!font.Ok()) {
+			fprintf(stderr, "font-sdf: could not build the %g px atlas\n", size);
+			return 1;
+		}
+		bitmapBytes += atlasBytes(font);
+	}
+	const double bitmapMs = stopwatch.ElapsedMs();
+
+	stopwatch.Restart();
+	Font sdfFont(fontFile, Font::Settings{ .size = sdfSize, .sdf = true });
+	const double sdfMs = stopwatch.ElapsedMs();
+	if (!sdfFont.Ok()) {
+		fprintf(stderr, "font-sdf: could not build the SDF atlas: %s\n", SDL_GetError());
+		return 1;
+	}
+
+	ThreadPool threadPool;
+	stopwatch.Restart();
+	Font sdfFontParallel(fontFile, Font::Settings{ .size = sdfSize, .threadPool = &threadPool, .sdf = true });
+	const double sdfParallelMs = stopwatch.ElapsedMs();
+
+	const size_t sdfBytes = atlasBytes(sdfFont);
+	printf("font-sdf.sizes %d\n", sizeCount);
+	printf("font-sdf.bitmap_bytes %zu\n", bitmapBytes);
+	printf("font-sdf.sdf_bytes %zu\n", sdfBytes);
+	printf("font-sdf.saved_bytes %zu\n", bitmapBytes - sdfBytes);
+	printf("font-sdf.bitmap_ms %.3f\n", bitmapMs);
+	printf("font-sdf.sdf_ms %.3f\n", sdfMs);
+	printf("font-sdf.sdf_parallel_ms %.3f\n", sdfParallelMs);
+	return 0;
+}
+
+//---
+
+BENCHMARK("font-kerning", "Kerned advance of a long paragraph: stbtt_GetCodepointKernAdvance() vs the flat KernTable [font] [runs]")
+{
+	const char* fontFileName = (argc > 1) ? argv[1] : Bench::kDefFontFile;
+	const int runs = (argc > 2) ? atoi(argv[2]) : 20;
+	const float fontSize = 16.0f;
+
+	MappedFile fontFile(fontFileName);
+	Bench::Stopwatch stopwatch;
+	Font font(fontFile, fontSize);
+	const double loadMs = stopwatch.ElapsedMs();
+	stbtt_fontinfo fontInfo;
+	if (!fontFile.Ok() || !font.Ok() || !stbtt_InitFont(&fontInfo, fontFile.GetData(), 0)) {
+		fprintf(stderr, "font-kerning: could not load %s\n", fontFileName);
+		return 1;
+	}
+	const float scale = stbtt_ScaleForPixelHeight(&fontInfo, fontSize);
+
+	std::wstring paragraph;
+	while (paragraph.size() < 100000) {
+		paragraph += L"AVATAR WAVE Ty To Yo P. F, \"Quick brown fox\" jumps over the lazy dog; "
+			L"L'Oréal, Tœ, Wąż — kerned pairs: AV AW AY LT LV LY Te Tr Tu Tw Ty Va Ve Vo Wa We Wo Ya Ye Yo. ";
+	}
+
+	std::vector<double> stbMs, tableMs;
+	double stbAdvance = 0.0, tableAdvance = 0.0;
+	for (int run = 0; run < runs; run++) {
+		stbAdvance = 0.0;
+		stopwatch.Restart();
+		for (size_t i = 1; i < paragraph.size(); i++) {
+			stbAdvance += scale * stbtt_GetCodepointKernAdvance(&fontInfo, int(paragraph[i - 1]), int(paragraph[i]));
+		}
+		stbMs.push_back(stopwatch.ElapsedMs());
+
+		tableAdvance = 0.0;
+		stopwatch.Restart();
+		for (size_t i = 1; i < paragraph.size(); i++) {
+			tableAdvance += font.GetKernAdvance(int(paragraph[i - 1]), int(paragraph[i]));
+		}
+		tableMs.push_back(stopwatch.ElapsedMs());
+	}
+
+	// the table is read from the kern/GPOS tables directly; each pair must match what stbtt looks up
+	int mismatchedPairs = 0;
+	for (int first = 0; first < Font::NUMBER_OF_CHARS; first++) {
+		for (int second = 0; second < Font::NUMBER_OF_CHARS; second++) {
+			const float advance = scale * stbtt_GetCodepointKernAdvance(&fontInfo, first, second);
+			if (font.GetKernAdvance(first, second) != advance) mismatchedPairs++;
+		}
+	}
+
+	const double pairCount = double(paragraph.size() - 1);
+	const double stbNs = Bench::Median(stbMs) * 1e6 / pairCount;
+	const double tableNs = Bench::Median(tableMs) * 1e6 / pairCount;
+	const bool identical = (stbAdvance == tableAdvance && mismatchedPairs == 0);
+	printf("font-kerning.font_load_ms %.3f\n", loadMs);
+	printf("font-kerning.mismatched_pairs %d\n", mismatchedPairs);
+	printf("font-kerning.kerned_pairs %u\n", font.GetKernTable().GetPairCount());
+	printf("font-kerning.table_bytes %zu\n", font.GetKernTable().GetSlotCount() * sizeof(KernTable::Slot));
+	printf("font-kerning.stbtt_ns_per_pair %.2f\n", stbNs);
+	printf("font-kerning.table_ns_per_pair %.2f\n", tableNs);
+	printf("font-kerning.speedup %.1f\n", tableNs > 0.0 ? stbNs / tableNs : 0.0);
+	printf("font-kerning.identical %d\n", identical ? 1 : 0);
+	return identical ? 0 : 1;
+}
+
+//---
+
+BENCHMARK("font-coldstart", "Startup with a cold page cache: plain mmap vs MAP_POPULATE vs async prefetch overlapped with window creation [font] [runs]")
+{
+	const char* fontFileName = (argc > 1) ? argv[1] : Bench::kDefFontFile;
+	const int runs = (argc > 2) ? atoi(argv[2]) : 10;
+
+	Bench::UseHeadlessVideo();
+	SDL::Library libSDL(SDL_INIT_VIDEO);
+
+	struct Mode {
+		const char* name;
+		MappedFile::Options options;
+	};
+	const Mode modes[] = {
+		{ "plain", MappedFile::Options{} },
+		{ "populate", MappedFile::Options{ .populate = true } },
+		{ "prefetch", MappedFile::Options{ .access = MappedFile::Access::kRandom, .prefetch = true } },
+	};
+
+	// the atlas comes from its cache, so that the startup is dominated by I/O, not rasterization
+	const char* cacheFileName = "mjbench-coldstart.cache";
+	remove(cacheFileName);
+	{
+		MappedFile fontFile(fontFileName);
+		Font font(fontFile, Font::Settings{ .size = 16.0f, .cacheFileName = cacheFileName });
+		if (!font.Ok()) {
+			fprintf(stderr, "font-coldstart: could not load %s\n", fontFileName);
+			return 1;
+		}
+	}
+
+	double residentAfterEviction = 0.0;
+	for (const Mode &mode : modes) {
+		std::vector<double> totalMs, fontMs;
+		for (int run = 0; run < runs; run++) {
+			residentAfterEviction = std::max(residentAfterEviction, Bench::EvictFromPageCache(fontFileName));
+			Bench::EvictFromPageCache(cacheFileName);
+
+			// the order of main(): map the font, create the window, then build the atlas
+			Bench::Stopwatch total;
+			MappedFile fontFile(fontFileName, mode.options);
+			SDL::Window window("mjbench", 640, 480, SDL_WINDOW_HIDDEN);
+			fontFile.WaitForPrefetch();
+
+			Bench::Stopwatch stopwatch;
+			Font font(fontFile, Font::Settings{ .size = 16.0f, .cacheFileName = cacheFileName });
+			fontMs.push_back(stopwatch.ElapsedMs());
+			totalMs.push_back(total.ElapsedMs());
+			if (!font.IsFromCache()) {
+				fprintf(stderr, "font-coldstart: the atlas cache was not used\n");
+				return 1;
+			}
+		}
+		printf("font-coldstart.%s.startup_ms %.3f\n", mode.name, Bench::Median(totalMs));
+		printf("font-coldstart.%s.font_ms %.3f\n", mode.name, Bench::Median(fontMs));
+	}
+
+	remove(cacheFileName);
+
+	// if eviction did not work (e.g. no permission), the numbers above are warm
+	printf("font-coldstart.resident_after_eviction %.2f\n", residentAfterEviction);
+	return 0;
+}
@@ -0,0 +1,468 @@
+#include "Bench.h"
+#include "SDLWrapper.h"
+#include "GLWrapper.h"
+#include "MpscQueue.h"
+#include "AllocCounter.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+//---
+
+BENCHMARK("loop-pacing", "Fixed-step loop: tick rate, frame pacing jitter and recovery from a stall, headless [frames] [tickRate] [frameRate]")
+{
+	const int frames = (argc > 1) ? atoi(argv[1]) : 240;
+	const int tickRate = (argc > 2) ? atoi(argv[2]) : SDL::EventLoop::DEFAULT_TICK_RATE;
+	const int frameRate = (argc > 3) ? atoi(argv[3]) : SDL::EventLoop::FALLBACK_FRAME_RATE;
+	const int stallFrame = frames / 2;
+	const double stallMs = 100.0;
+
+	Bench::UseHeadlessVideo();
+	SDL::Library libSDL(SDL_INIT_VIDEO);
+	SDL::Window window("mjbench", 320, 240, SDL_WINDOW_HIDDEN);
+	SDL::EventLoop eventLoop(libSDL);
+
+	// a gem falling at a constant speed: the interpolated position must never step backwards
+	const double speed = 100.0;		// pixels per second
+	double previousY = 0.0, currentY = 0.0, lastDrawnY = 0.0;
+	long long backwardSteps = 0;
+	eventLoop.OnTick = [&](double dt) {
+		previousY = currentY;
+		currentY += speed * dt;
+	};
+	int frame = 0;
+	eventLoop.OnRender = [&](float alpha) {
+		const double y = previousY + (currentY - previousY) * alpha;
+		if (y < lastDrawnY) backwardSteps++;
+		lastDrawnY = y;
+
+		glViewport(0, 0, 320, 240);
+		glClearColor(0.0f, 0.0f, float(std::fmod(y, 1.0)), 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		glFinish();
+		if (frame == stallFrame) {
+			Bench::Stopwatch stall;
+			while (stall.ElapsedMs() < stallMs) {}
+		}
+	};
+
+	eventLoop.SetFixedStepMode(window.getWindow(), tickRate, frameRate);
+	std::vector<double> intervalMs;
+	Bench::Stopwatch total, stopwatch;
+	for (frame = 0; frame < frames; frame++) {
+		if (!eventLoop.RunOnce()) break;
+		if (frame != stallFrame && frame != stallFrame + 1) {
+			intervalMs.push_back(stopwatch.ElapsedMs());
+		}
+		stopwatch.Restart();
+	}
+	const double totalMs = total.ElapsedMs();
+
+	// jitter: how far frame intervals stray from the target
+	const double targetMs = 1000.0 / frameRate;
+	std::vector<double> jitterMs;
+	for (double ms : intervalMs) jitterMs.push_back(std::fabs(ms - targetMs));
+
+	const SDL::EventLoop::FrameStats& stats = eventLoop.GetFrameStats();
+	printf("loop-pacing.ticks_per_second %.1f\n", double(stats.ticks + stats.droppedTicks) * 1000.0 / totalMs);
+	printf("loop-pacing.frames_per_second %.1f\n", double(stats.frames) * 1000.0 / totalMs);
+	printf("loop-pacing.interval_ms_p50 %.3f\n", Bench::Percentile(intervalMs, 50.0));
+	printf("loop-pacing.jitter_ms_p50 %.3f\n", Bench::Percentile(jitterMs, 50.0));
+	printf("loop-pacing.jitter_ms_p99 %.3f\n", Bench::Percentile(jitterMs, 99.0));
+	printf("loop-pacing.late_frames %llu\n", (unsigned long long)stats.lateFrames);
+	printf("loop-pacing.dropped_frames %llu\n", (unsigned long long)stats.droppedFrames);
+	printf("loop-pacing.dropped_ticks %llu\n", (unsigned long long)stats.droppedTicks);
+	printf("loop-pacing.max_frame_ms %.3f\n", stats.maxFrameMs);
+	printf("loop-pacing.backward_steps %lld\n", backwardSteps);
+	return backwardSteps == 0 ? 0 : 1;
+}
+
+//---
+
+namespace {
+
+/// Nanoseconds on the performance counter.
+uint64_t NowNs()
+{
+	return uint64_t(double(SDL_GetPerformanceCounter()) * 1e9 / double(SDL_GetPerformanceFrequency()));
+}
+
+/// Cross-thread channel under test: the lock-free queue, or SDL's event queue.
+struct Channel
+{
+	virtual ~Channel() {}
+	virtual bool Post(int64_t value) = 0;
+	virtual bool Take(int64_t &value) = 0;
+};
+
+struct QueueChannel : Channel
+{
+	MpscQueue<SDL::EventLoop::Command> queue { SDL::EventLoop::COMMAND_QUEUE_CAPACITY };
+	bool Post(int64_t value) override { return queue.TryPush(SDL::EventLoop::Command{ 1, value, nullptr }); }
+	bool Take(int64_t &value) override {
+		SDL::EventLoop::Command command;
+		if (!queue.TryPop(command)) return false;
+		value = command.value;
+		return true;
+	}
+};
+
+struct SDLChannel : Channel
+{
+	bool Post(int64_t value) override {
+		SDL_Event event = {};
+		event.type = SDL_USEREVENT;
+		event.user.code = 1;
+		event.user.data1 = reinterpret_cast<void*>(intptr_t(value));
+		return SDL_PushEvent(&event) == 1;
+	}
+	bool Take(int64_t &value) override {
+		SDL_Event event;
+		if (!SDL_PollEvent(&event)) return false;
+		value = int64_t(reinterpret_cast<intptr_t>(event.user.data1));
+		return true;
+	}
+};
+
+//---
+
+/// Messages per second from `producers` threads to this one.
+double MeasureThroughput(Channel &channel, int producers, int messagesEach)
+{
+	std::vector<std::thread> threads;
+	Bench::Stopwatch stopwatch;
+	for (int p = 0; p < producers; p++) {
+		threads.emplace_back([&channel, messagesEach]() {
+			for (int i = 0; i < messagesEach; i++) {
+				while (!channel.Post(i)) std::this_thread::yield();
+			}
+		});
+	}
+	const int64_t total = int64_t(producers) * messagesEach;
+	int64_t received = 0, value;
+	while (received < total) {
+		if (channel.Take(value)) received++;
+		else std::this_thread::yield();
+	}
+	const double ms = stopwatch.ElapsedMs();
+	for (auto &thread : threads) thread.join();
+	return double(total) * 1000.0 / ms;
+}
+
+//---
+
+/// One-way latencies (ns) of messages sent one at a time, each after the previous one arrived.
+std::vector<double> MeasureLatency(Channel &channel, int messages)
+{
+	std::atomic<int> received { 0 };
+	std::thread producer([&channel, &received, messages]() {
+		for (int i = 0; i < messages; i++) {
+			while (received.load() < i) std::this_thread::yield();
+			while (!channel.Post(int64_t(NowNs()))) std::this_thread::yield();
+		}
+	});
+	std::vector<double> latencies;
+	latencies.reserve(messages);
+	int64_t sent;
+	while (int(latencies.size()) < messages) {
+		if (channel.Take(sent)) {
+			latencies.push_back(double(NowNs() - uint64_t(sent)));
+			received++;
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+	producer.join();
+	return latencies;
+}
+
+} // namespace
+
+//---
+
+BENCHMARK("command-queue", "Posting to the main thread: lock-free MPSC queue vs SDL_PushEvent, throughput and latency [producers] [messages]")
+{
+	const int producers = (argc > 1) ? atoi(argv[1]) : 2;
+	const int messages = (argc > 2) ? atoi(argv[2]) : 200000;
+
+	SDL::Library libSDL(SDL_INIT_EVENTS);
+	QueueChannel queueChannel;
+	SDLChannel sdlChannel;
+
+	const double queueRate = MeasureThroughput(queueChannel, producers, messages);
+	const double sdlRate = MeasureThroughput(sdlChannel, producers, messages);
+	std::vector<double> queueLatency = MeasureLatency(queueChannel, 20000);
+	std::vector<double> sdlLatency = MeasureLatency(sdlChannel, 20000);
+
+	// the loop's own drain: commands posted, then handed out by one RunOnce()
+	SDL::EventLoop eventLoop(libSDL);
+	int64_t handled = 0;
+	eventLoop.OnCommand = [&handled](const SDL::EventLoop::Command &command) { handled += command.value; };
+	const int batch = int(SDL::EventLoop::COMMAND_QUEUE_CAPACITY);
+	eventLoop.RunOnce(false);
+	uint64_t allocations = AllocCounter::GetCount();
+	Bench::Stopwatch stopwatch;
+	for (int round = 0; round < 100; round++) {
+		for (int i = 0; i < batch; i++) eventLoop.PostCommand(SDL::EventLoop::Command{ 0, 1, nullptr });
+		eventLoop.RunOnce(false);
+	}
+	const double drainMs = stopwatch.ElapsedMs();
+	allocations = AllocCounter::GetCount() - allocations;
+
+	printf("command-queue.producers %d\n", producers);
+	printf("command-queue.mpsc_messages_per_second %.0f\n", queueRate);
+	printf("command-queue.sdl_messages_per_second %.0f\n", sdlRate);
+	printf("command-queue.mpsc_latency_ns_p50 %.0f\n", Bench::Percentile(queueLatency, 50.0));
+	printf("command-queue.mpsc_latency_ns_p99 %.0f\n", Bench::Percentile(queueLatency, 99.0));
+	printf("command-queue.sdl_latency_ns_p50 %.0f\n", Bench::Percentile(sdlLatency, 50.0));
+	printf("command-queue.sdl_latency_ns_p99 %.0f\n", Bench::Percentile(sdlLatency, 99.0));
+	printf("command-queue.loop_ns_per_command %.1f\n", drainMs * 1e6 / (100.0 * batch));
+	printf("command-queue.loop_allocations %llu\n", (unsigned long long) allocations);
+	return (handled == 100 * batch && allocations == 0) ? 0 : 1;
+}
+
+//---
+
+namespace {
+
+/// Input handler of the benchmark: counts the callbacks and sums up the relative motion.
+struct InputCounter
+{
+	uint64_t callbacks = 0;
+	int64_t motion = 0;
+
+	void OnMouseMotion(const SDL_MouseMotionEvent &event) { callbacks++; motion += event.xrel; }
+	void OnMouseButton(const SDL_MouseButtonEvent&) { callbacks++; }
+	void OnKey(const SDL_KeyboardEvent&) { callbacks++; }
+};
+
+//---
+
+/**
+ * Queues `count` synthetic events: with `burst` > 1, runs of that many mouse
+ * motion events (as a high-rate mouse sends them) each followed by a click;
+ * with `burst` 1, motion and key presses alternating (nothing to merge).
+ */
+void PushEvents(int count, int burst)
+{
+	std::vector<SDL_Event> events(count);
+	for (int i = 0; i < count; i++) {
+		SDL_Event &event = events[i];
+		event = {};
+		if ((burst > 1) ? (i % (burst + 1) != burst) : (i % 2 == 0)) {
+			event.type = SDL_MOUSEMOTION;
+			event.motion.x = i & 1023;
+			event.motion.xrel = 1 + (i & 3);
+		}
+		else if (burst > 1) {
+			event.type = SDL_MOUSEBUTTONDOWN;
+			event.button.button = SDL_BUTTON_LEFT;
+		}
+		else {
+			event.type = SDL_KEYDOWN;
+			event.key.keysym.sym = SDLK_SPACE;
+		}
+	}
+	SDL_PeepEvents(events.data(), count, SDL_ADDEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT);
+}
+
+//---
+
+/// The dispatch of old: one SDL_PollEvent(), an if/else chain and a std::function call per event.
+void PollEachEvent(SDL::EventLoop &eventLoop)
+{
+	SDL_Event event;
+	while (SDL_PollEvent(&event)) {
+		if (event.type == SDL_QUIT) {
+			eventLoop.quitRequested = true;
+		}
+		else if (event.type == SDL_KEYDOWN) {
+			if (eventLoop.OnKey) eventLoop.OnKey(event.key);
+		}
+		else if (event.type == SDL_MOUSEBUTTONDOWN) {
+			if (eventLoop.OnMouseButton) eventLoop.OnMouseButton(event.button);
+		}
+		else if (event.type == SDL_MOUSEMOTION) {
+			if (eventLoop.OnMouseMotion) eventLoop.OnMouseMotion(event.motion);
+		}
+	}
+}
+
+//---
+
+/// Drains `rounds` batches of `count` events with `drain`. \return Events per second.
+template <typename Drain>
+double MeasureDispatch(int rounds, int count, int burst, Drain drain)
+{
+	double ms = 0.0;
+	for (int round = 0; round < rounds; round++) {
+		PushEvents(count, burst);
+		Bench::Stopwatch stopwatch;
+		drain();
+		ms += stopwatch.ElapsedMs();
+	}
+	return double(rounds) * count * 1000.0 / ms;
+}
+
+} // namespace
+
+//---
+
+BENCHMARK("event-dispatch", "Input event dispatch: polling with std::function callbacks vs batched, merged and statically dispatched, events/s [rounds] [events per round]")
+{
+	const int rounds = (argc > 1) ? atoi(argv[1]) : 200;
+	const int count = (argc > 2) ? atoi(argv[2]) : 8192;
+
+	Bench::UseHeadlessVideo();
+	SDL::Library libSDL(SDL_INIT_VIDEO);
+	SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
+
+	InputCounter polled, functions, handler;
+	SDL::EventLoop eventLoop(libSDL);
+	auto bind = [&eventLoop](InputCounter &counter) {
+		eventLoop.OnMouseMotion = [&counter](const SDL_MouseMotionEvent &event) { counter.OnMouseMotion(event); };
+		eventLoop.OnMouseButton = [&counter](const SDL_MouseButtonEvent &event) { counter.OnMouseButton(event); };
+		eventLoop.OnKey = [&counter](const SDL_KeyboardEvent &event) { counter.OnKey(event); };
+	};
+	SDL::StaticEventLoop<InputCounter> staticLoop(libSDL, handler);
+
+	bool sameMotion = true;
+	printf("event-dispatch.events_per_round %d\n", count);
+	for (int burst : { 1, 16 }) {
+		polled = functions = handler = InputCounter();
+		bind(polled);
+		const double polledRate = MeasureDispatch(rounds, count, burst, [&]() { PollEachEvent(eventLoop); });
+		bind(functions);
+		const double functionRate = MeasureDispatch(rounds, count, burst, [&]() { eventLoop.RunOnce(false); });
+		const double staticRate = MeasureDispatch(rounds, count, burst, [&]() { staticLoop.RunOnce(false); });
+		sameMotion = sameMotion && functions.motion == polled.motion && handler.motion == polled.motion;
+
+		const char* pattern = (burst > 1) ? "burst" : "interleaved";
+		printf("event-dispatch.%s.poll_events_per_second %.0f\n", pattern, polledRate);
+		printf("event-dispatch.%s.function_events_per_second %.0f\n", pattern, functionRate);
+		printf("event-dispatch.%s.static_events_per_second %.0f\n", pattern, staticRate);
+		printf("event-dispatch.%s.speedup %.2f\n", pattern, staticRate / polledRate);
+		printf("event-dispatch.%s.callbacks_per_event %.3f\n", pattern, double(handler.callbacks) / (double(rounds) * count));
+	}
+	printf("event-dispatch.same_motion %s\n", sameMotion ? "yes" : "no");
+	return sameMotion ? 0 : 1;
+}
+
+//---
+
+namespace {
+
+/// What the game would make of the input; must come out the same through either API.
+struct InputTotals
+{
+	uint64_t callbacks = 0;
+	uint64_t keyPresses = 0;
+	uint64_t clicks = 0;
+	int64_t motion = 0;
+
+	bool operator==(const InputTotals &other) const {
+		return keyPresses == other.keyPresses && clicks == other.clicks && motion == other.motion;
+	}
+};
+
+//---
+
+/// Queues an event storm: mostly mouse motion, with key and button presses and releases in between.
+void PushStorm(int count)
+{
+	std::vector<SDL_Event> events(count);
+	for (int i = 0; i < count; i++) {
+		SDL_Event &event = events[i];
+		event = {};
+		const bool press = (i / 10) % 2 == 0;
+		if (i % 10 == 0) {
+			event.type = press ? SDL_KEYDOWN : SDL_KEYUP;
+			event.key.keysym.scancode = SDL_Scancode(SDL_SCANCODE_A + (i / 20) % 26);
+			event.key.keysym.sym = 'a' + (i / 20) % 26;
+		}
+		else if (i % 10 == 5) {
+			event.type = press ? SDL_MOUSEBUTTONDOWN : SDL_MOUSEBUTTONUP;
+			event.button.button = SDL_BUTTON_LEFT;
+			event.button.x = i & 1023;
+		}
+		else {
+			event.type = SDL_MOUSEMOTION;
+			event.motion.x = i & 1023;
+			event.motion.xrel = 1;
+		}
+	}
+	SDL_PeepEvents(events.data(), count, SDL_ADDEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT);
+}
+
+//---
+
+/// Runs `frames` frames of `storm` events each. \return Nanoseconds per event.
+double MeasureStorm(SDL::EventLoop &eventLoop, int frames, int storm)
+{
+	double ms = 0.0;
+	for (int frame = 0; frame < frames; frame++) {
+		PushStorm(storm);
+		Bench::Stopwatch stopwatch;
+		eventLoop.RunOnce(false);
+		ms += stopwatch.ElapsedMs();
+	}
+	return ms * 1e6 / (double(frames) * storm);
+}
+
+} // namespace
+
+//---
+
+BENCHMARK("input-batch", "Event storms under the dummy video driver: per-event callbacks vs one InputBatch per frame [frames]")
+{
+	const int frames = (argc > 1) ? atoi(argv[1]) : 200;
+
+	setenv("SDL_VIDEODRIVER", "dummy", 1);
+	SDL::Library libSDL(SDL_INIT_VIDEO);
+	SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
+
+	InputTotals perEvent, batched;
+	SDL::EventLoop callbackLoop(libSDL);
+	callbackLoop.OnKey = [&perEvent](const SDL_KeyboardEvent &event) {
+		perEvent.callbacks++;
+		if (!event.repeat) perEvent.keyPresses++;
+	};
+	callbackLoop.OnMouseButton = [&perEvent](const SDL_MouseButtonEvent&) {
+		perEvent.callbacks++;
+		perEvent.clicks++;
+	};
+	callbackLoop.OnMouseMotion = [&perEvent](const SDL_MouseMotionEvent &event) {
+		perEvent.callbacks++;
+		perEvent.motion += event.xrel;
+	};
+	SDL::EventLoop batchLoop(libSDL);
+	batchLoop.OnInput = [&batched](const SDL::InputBatch &input) {
+		batched.callbacks++;
+		for (const SDL::InputEvent &event : input.events) {
+			if (event.type == SDL::InputEvent::Type::kKeyDown) batched.keyPresses++;
+			else if (event.type == SDL::InputEvent::Type::kButtonDown) batched.clicks++;
+		}
+		batched.motion += input.mouseDeltaX;
+	};
+
+	bool same = true;
+	for (int storm : { 16, 256, 4096 }) {
+		perEvent = batched = InputTotals();
+		const double callbackNs = MeasureStorm(callbackLoop, frames, storm);
+		const double batchNs = MeasureStorm(batchLoop, frames, storm);
+		same = same && perEvent == batched;
+
+		printf("input-batch.storm_%d.callback_ns_per_event %.1f\n", storm, callbackNs);
+		printf("input-batch.storm_%d.batch_ns_per_event %.1f\n", storm, batchNs);
+		printf("input-batch.storm_%d.callback_calls_per_frame %.1f\n", storm, double(perEvent.callbacks) / frames);
+		printf("input-batch.storm_%d.batch_calls_per_frame %.1f\n", storm, double(batched.callbacks) / frames);
+	}
+	printf("input-batch.input_event_bytes %zu\n", sizeof(SDL::InputEvent));
+	printf("input-batch.same_input %s\n", same ? "yes" : "no");
+	return same ? 0 : 1;
+}
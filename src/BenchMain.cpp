@@ -0,0 +1,86 @@
+#include "Bench.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace Bench {
+
+const char* kDefFontFile = "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf";
+
+double EvictFromPageCache(const char* fileName)
+{
+	const int f = open(fileName, O_RDONLY);
+	if (f < 0) return 1.0;
+
+	// dirty pages (of a file just written) are not dropped, they have to be written back first
+	fdatasync(f);
+	posix_fadvise(f, 0, 0, POSIX_FADV_DONTNEED);
+
+	struct stat fileMetadata;
+	fstat(f, &fileMetadata);
+	const size_t size = size_t(fileMetadata.st_size);
+	if (size == 0) {
+		close(f);
+		return 0.0;
+	}
+	const size_t pageSize = size_t(sysconf(_SC_PAGESIZE));
+	void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, f, 0);
+	close(f);
+	if (mapped == MAP_FAILED) return 1.0;
+
+	std::vector<unsigned char> residency((size + pageSize - 1) / pageSize);
+	mincore(mapped, size, residency.data());
+	munmap(mapped, size);
+	size_t resident = 0;
+	for (unsigned char page : residency) resident += (page & 1);
+	return double(resident) / double(residency.size());
+}
+
+struct Entry
+{
+	const char* name;
+	const char* description;
+	Function function;
+};
+
+/// Registered benchmarks (function-local so that it exists before the registrations run).
+static std::vector<Entry>& GetEntries()
+{
+	static std::vector<Entry> entries;
+	return entries;
+}
+
+Registration::Registration(const char* name, const char* description, Function function)
+{
+	GetEntries().push_back(Entry{ name, description, function });
+}
+
+} // namespace Bench
+
+//---
+
+int main(int argc, const char** argv)
+{
+	if (argc < 2) {
+		printf("usage: %s <benchmark> [args...]\n\nbenchmarks:\n", argv[0]);
+		for (const auto& entry : Bench::GetEntries()) {
+			printf("  %-24s %s\n", entry.name, entry.description);
+		}
+		return 1;
+	}
+
+	for (const auto& entry : Bench::GetEntries()) {
+		if (strcmp(entry.name, argv[1]) == 0) {
+			return entry.function(argc - 1, argv + 1);
+		}
+	}
+
+	fprintf(stderr, "%s: unknown benchmark '%s'\n", argv[0], argv[1]);
+	return 1;
+}
@@ -0,0 +1,98 @@
+#include "Bench.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include "SDL.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace {
+
+/// Stand-in for work inside a zone, which the compiler cannot drop.
+std::atomic<uint64_t> sink{ 0 };
+
+//---
+
+/// Records `count` zones (in groups of 64 within an outer one) on the calling thread. \return ns per inner zone.
+double RecordZones(uint32_t outerId, uint32_t innerId, int count)
+{
+	Bench::Stopwatch stopwatch;
+	for (int group = 0; group < count / 64; group++) {
+		Profiler::Zone outer(outerId);
+		for (int i = 0; i < 64; i++) {
+			Profiler::Zone inner(innerId);
+			sink.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	return stopwatch.ElapsedMs() * 1e6 / count;
+}
+
+//---
+
+/// The same loop without zones. \return ns per iteration.
+double RunBaseline(int count)
+{
+	Bench::Stopwatch stopwatch;
+	for (int i = 0; i < count; i++) {
+		sink.fetch_add(1, std::memory_order_relaxed);
+	}
+	return stopwatch.ElapsedMs() * 1e6 / count;
+}
+
+} // namespace
+
+//---
+
+BENCHMARK("cpu-zones", "Cost of a profiling zone on one thread and on several at once, and of the trace export [zones per thread] [threads] [trace file]")
+{
+	const int count = (argc > 1) ? atoi(argv[1]) : 262144;
+	const int threads = (argc > 2) ? atoi(argv[2]) : 4;
+	const char* traceFileName = (argc > 3) ? argv[3] : "/tmp/mjbench-trace.json";
+
+	Profiler::SetThreadName("main");
+	const uint32_t outerId = Profiler::RegisterName("bench group");
+	const uint32_t innerId = Profiler::RegisterName("bench zone");
+
+	const double baselineNs = RunBaseline(count);
+	const double singleNs = RecordZones(outerId, innerId, count);
+
+	// every worker records into its own buffer; no locks are shared (the wall time
+	// covers all threads' zones, so it shows contention only with as many cores)
+	double parallelMs = 0.0;
+	{
+		ThreadPool pool(threads);
+		Bench::Stopwatch stopwatch;
+		pool.ParallelFor(threads, [&](int) {
+			char threadName[32];
+			snprintf(threadName, sizeof(threadName), "bench worker %d", pool.GetCurrentWorker());
+			Profiler::SetThreadName(threadName);
+			RecordZones(outerId, innerId, count);
+		});
+		parallelMs = stopwatch.ElapsedMs();
+	}
+	const double cores = double(std::min<unsigned>(unsigned(threads), std::max(1u, std::thread::hardware_concurrency())));
+	const double parallelNs = parallelMs * 1e6 * cores / (double(count) * threads);
+
+	Bench::Stopwatch exportStopwatch;
+	const bool exported = Profiler::WriteChromeTrace(traceFileName);
+	const double exportMs = exportStopwatch.ElapsedMs();
+
+#ifdef PROFILE_ZONES
+	printf("cpu-zones.compiled_in yes\n");
+#else
+	printf("cpu-zones.compiled_in no\n");
+#endif
+	printf("cpu-zones.event_bytes %zu\n", sizeof(Profiler::Event));
+	printf("cpu-zones.cores %u\n", std::thread::hardware_concurrency());
+	printf("cpu-zones.baseline_ns %.2f\n", baselineNs);
+	printf("cpu-zones.zone_ns_one_thread %.2f\n", singleNs - baselineNs);
+	printf("cpu-zones.zone_ns_per_core_%d_threads %.2f\n", threads, parallelNs - baselineNs);
+	printf("cpu-zones.events %llu\n", (unsigned long long) Profiler::GetEventCount());
+	printf("cpu-zones.dropped %llu\n", (unsigned long long) Profiler::GetDroppedCount());
+	printf("cpu-zones.export_ms %.1f\n", exportMs);
+	printf("cpu-zones.trace %s\n", exported ? traceFileName : SDL_GetError());
+	return exported ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+#include "Bench.h"
+#include "Game.h"
+#include "Replay.h"
+#include "ThreadPool.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <vector>
+
+namespace {
+
+/// Window position of the middle of a cell.
+void CellCenter(int column, int row, int32_t &x, int32_t &y)
+{
+	x = Game::BOARD_X + column * Game::CELL_SIZE + Game::CELL_SIZE / 2;
+	y = Game::BOARD_Y + (Board::SIZE - 1 - row) * Game::CELL_SIZE + Game::CELL_SIZE / 2;
+}
+
+//---
+
+/**
+ * Plays a game with a scripted player for the given number of ticks and
+ * records it: the mouse wanders over the board, and every second or so the
+ * player swaps a random valid pair (sometimes an invalid one, or a single
+ * stray click); once in a while a new game is started.
+ */
+std::vector<uint8_t> RecordSession(uint64_t seed, int ticks)
+{
+	Game game(seed);
+	ReplayRecorder recorder(seed, game.GetColorCount());
+	Random player(seed * 31 + 7);
+	auto apply = [&](const GameInput &input) {
+		recorder.Record(game.GetTick(), input);
+		game.Apply(input);
+	};
+
+	int32_t x = 640, y = 512;
+	Board::Move moves[Board::MAX_MOVES];
+	for (int tick = 0; tick < ticks; tick++) {
+		if (tick % 2 == 0) {
+			x += player.NextBelow(21) - 10;
+			y += player.NextBelow(21) - 10;
+			apply(GameInput{ GameInput::Type::kMouseMotion, 0, x, y });
+		}
+		if (player.NextBelow(Game::TICK_RATE) == 0) {
+			const int moveCount = game.GetBoard().FindMoves(moves);
+			const int choice = player.NextBelow(moveCount + 2);
+			if (choice < moveCount) {
+				const Board::Move &move = moves[choice];
+				CellCenter(move.column, move.row, x, y);
+				apply(GameInput{ GameInput::Type::kMouseButton, Game::LEFT_BUTTON, x, y });
+				CellCenter(move.GetColumn2(), move.GetRow2(), x, y);
+				apply(GameInput{ GameInput::Type::kMouseButton, Game::LEFT_BUTTON, x, y });
+			}
+			else {
+				CellCenter(player.NextBelow(Board::SIZE), player.NextBelow(Board::SIZE), x, y);
+				apply(GameInput{ GameInput::Type::kMouseButton, Game::LEFT_BUTTON, x, y });
+			}
+		}
+		if (player.NextBelow(20 * Game::TICK_RATE) == 0) {
+			apply(GameInput{ GameInput::Type::kKey, Game::KEY_NEW_GAME });
+		}
+		game.Tick();
+	}
+	recorder.Finish(game.GetTick(), game.GetStateHash());
+	return recorder.GetData();
+}
+
+} // namespace
+
+//---
+
+BENCHMARK("replay", "Re-simulating recorded games: replays/s on one thread and on all, and bit-exactness [sessions] [seconds each]")
+{
+	const int sessionCount = (argc > 1) ? atoi(argv[1]) : 2000;
+	const int seconds = (argc > 2) ? atoi(argv[2]) : 60;
+	const int ticks = seconds * Game::TICK_RATE;
+
+	std::vector<std::vector<uint8_t>> logs(sessionCount);
+	size_t logBytes = 0;
+	for (int i = 0; i < sessionCount; i++) {
+		logs[i] = RecordSession(uint64_t(i) + 1, ticks);
+		logBytes += logs[i].size();
+	}
+
+	Bench::Stopwatch stopwatch;
+	uint64_t inputs = 0;
+	long long score = 0;
+	int serialIdentical = 0;
+	for (const auto &log : logs) {
+		const ReplayResult result = RunReplay(log);
+		inputs += result.inputs;
+		score += result.score;
+		serialIdentical += result.identical ? 1 : 0;
+	}
+	const double serialMs = stopwatch.ElapsedMs();
+
+	ThreadPool threadPool;
+	std::atomic<int> parallelIdentical { 0 };
+	stopwatch.Restart();
+	threadPool.ParallelFor(sessionCount, [&](int i) {
+		if (RunReplay(logs[i]).identical) parallelIdentical++;
+	});
+	const double parallelMs = stopwatch.ElapsedMs();
+
+	const double simulatedSeconds = double(sessionCount) * seconds;
+	printf("replay.sessions %d\n", sessionCount);
+	printf("replay.inputs_per_session %.1f\n", double(inputs) / sessionCount);
+	printf("replay.score_per_session %.1f\n", double(score) / sessionCount);
+	printf("replay.log_bytes_per_input %.2f\n", double(logBytes) / double(inputs));
+	printf("replay.serial_replays_per_second %.0f\n", sessionCount * 1000.0 / serialMs);
+	printf("replay.threads %d\n", threadPool.GetThreadCount() + 1);
+	printf("replay.parallel_replays_per_second %.0f\n", sessionCount * 1000.0 / parallelMs);
+	printf("replay.speed_vs_real_time %.0f\n", simulatedSeconds * 1000.0 / parallelMs);
+	printf("replay.identical %d/%d\n", parallelIdentical.load(), sessionCount);
+	return (serialIdentical == sessionCount && parallelIdentical.load() == sessionCount) ? 0 : 1;
+}
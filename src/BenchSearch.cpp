@@ -0,0 +1,77 @@
+#include "Bench.h"
+#include "Board.h"
+#include "MoveSearch.h"
+#include "ThreadPool.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+//---
+
+BENCHMARK("move-search", "Hint search: nodes/s by worker count at a fixed depth, and keeping a time budget [depth] [boards] [budgetMs]")
+{
+	const int depth = (argc > 1) ? atoi(argv[1]) : 2;
+	const int boardCount = (argc > 2) ? atoi(argv[2]) : 4;
+	const double budgetMs = (argc > 3) ? atof(argv[3]) : 50.0;
+
+	std::vector<Board> boards;
+	Random random(2024);
+	for (int i = 0; i < boardCount; i++) {
+		Board board;
+		board.Fill(random);
+		boards.push_back(board);
+	}
+
+	// fixed work, so that nodes/s compares; each run starts with an empty table
+	const int hardwareThreads = std::max(1, int(std::thread::hardware_concurrency()));
+	MoveSearch::Settings settings;
+	settings.maxDepth = depth;
+	settings.timeBudgetMs = 0.0;
+	double singleRate = 0.0;
+	float firstValue = 0.0f;
+	bool deterministic = true;
+	for (int workerCount = 1; ; workerCount = std::min(workerCount * 2, hardwareThreads)) {
+		ThreadPool threadPool(workerCount);
+		MoveSearch search(threadPool);
+		uint64_t nodes = 0;
+		float valueSum = 0.0f;
+		Bench::Stopwatch stopwatch;
+		for (const Board &board : boards) {
+			const MoveSearch::Result result = search.Search(board, settings);
+			nodes += result.nodes;
+			valueSum += result.value;
+		}
+		const double rate = double(nodes) * 1000.0 / stopwatch.ElapsedMs();
+		if (workerCount == 1) {
+			singleRate = rate;
+			firstValue = valueSum;
+		}
+		deterministic = deterministic && (valueSum == firstValue);
+
+		printf("move-search.workers_%d_nodes_per_second %.0f\n", workerCount, rate);
+		printf("move-search.workers_%d_scaling %.2f\n", workerCount, rate / singleRate);
+		if (workerCount >= hardwareThreads) break;
+	}
+
+	// the hint as the game would ask for it: as deep as fits in the budget
+	ThreadPool threadPool;
+	MoveSearch search(threadPool);
+	settings.maxDepth = 8;
+	settings.timeBudgetMs = budgetMs;
+	double worstMs = 0.0;
+	int shallowestDepth = settings.maxDepth;
+	for (const Board &board : boards) {
+		const MoveSearch::Result result = search.Search(board, settings);
+		worstMs = std::max(worstMs, result.elapsedMs);
+		shallowestDepth = std::min(shallowestDepth, result.completedDepth);
+	}
+
+	printf("move-search.hardware_threads %d\n", hardwareThreads);
+	printf("move-search.budget_ms %.1f\n", budgetMs);
+	printf("move-search.budget_worst_ms %.3f\n", worstMs);
+	printf("move-search.budget_min_completed_depth %d\n", shallowestDepth);
+	printf("move-search.same_values_for_all_worker_counts %d\n", deterministic ? 1 : 0);
+	return deterministic ? 0 : 1;
+}
@@ -0,0 +1,191 @@
+#include "Bench.h"
+#include "GLDevice.h"
+#include "SpriteBatch.h"
+#include "GemSprites.h"
+#include "SDLWrapper.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+/// Palette of the benchmark's sprites (RGBA8, R in the lowest byte).
+const uint32_t kTints[] = { 0xff3030e0, 0xff30d030, 0xffe06020, 0xff20d0e0, 0xffd040d0, 0xffe0e0e0, 0xff2090f0 };
+
+//---
+
+/**
+ * Adds a frame of `count` sprites laid out in a grid over the viewport, all
+ * layers and tints mixed and slowly turning; with `flushEach`, draws every
+ * sprite with a draw call of its own (the way a naive renderer would),
+ * otherwise leaves them all to one Flush().
+ */
+void AddScene(SpriteBatch &batch, int width, int height, int count, int frame, bool flushEach)
+{
+	const int columns = int(std::ceil(std::sqrt(double(count) * width / height)));
+	const float cell = float(width) / float(columns);
+	const int tintCount = int(sizeof(kTints) / sizeof(kTints[0]));
+	for (int i = 0; i < count; i++) {
+		const float x = (float(i % columns) + 0.5f) * cell;
+		const float y = (float(i / columns) + 0.5f) * cell;
+		batch.Add(x, y, cell, cell, i % GemSprites::LAYER_COUNT, kTints[i % tintCount], float(frame + i) * 0.01f);
+		if (flushEach) batch.Flush();
+	}
+}
+
+//---
+
+/// Hash of the framebuffer (FNV-1a), to check that two ways of drawing give the same picture.
+uint64_t HashFramebuffer(int width, int height)
+{
+	std::vector<uint8_t> pixels(size_t(width) * height * 4);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (uint8_t byte : pixels) {
+		hash = (hash ^ byte) * 0x100000001b3ull;
+	}
+	return hash;
+}
+
+//---
+
+struct SceneTimes {
+	double addMs = 0.0;		///< CPU time writing the sprites (and, one draw per sprite, submitting them).
+	double frameMs = 0.0;	///< Whole frame, GPU included.
+	double glCalls = 0.0;		///< Made through the device.
+	uint64_t hash = 0;		///< Of the last frame.
+};
+
+/// Draws `frames` frames of the scene. \return Averages per frame.
+SceneTimes RunScene(GL::Device &device, SpriteBatch &batch, int width, int height, int count, int frames, bool flushEach)
+{
+	SceneTimes times;
+	const uint64_t callsBefore = device.GetRunningTotal().issued;
+	for (int frame = 0; frame < frames; frame++) {
+		Bench::Stopwatch frameStopwatch;
+		device.Viewport(0, 0, width, height);
+		device.ClearColor(0.0f, 0.0f, 0.2f, 1.0f);
+		device.Clear(GL_COLOR_BUFFER_BIT);
+
+		Bench::Stopwatch addStopwatch;
+		batch.Begin(width, height);
+		AddScene(batch, width, height, count, frame, flushEach);
+		times.addMs += addStopwatch.ElapsedMs();
+		batch.Flush();
+		glFinish();
+		times.frameMs += frameStopwatch.ElapsedMs();
+	}
+	times.glCalls = double(device.GetRunningTotal().issued - callsBefore) / frames;
+	times.addMs /= frames;
+	times.frameMs /= frames;
+	times.hash = HashFramebuffer(width, height);
+	return times;
+}
+
+} // namespace
+
+//---
+
+BENCHMARK("sprite-batch", "Instanced sprites from a texture array vs a draw call per sprite, headless [sprites] [frames]")
+{
+	const int count = (argc > 1) ? atoi(argv[1]) : 16384;
+	const int frames = (argc > 2) ? atoi(argv[2]) : 60;
+	const int width = 1280, height = 1024;
+
+	Bench::UseHeadlessVideo();
+	SDL::Library libSDL(SDL_INIT_VIDEO);
+	SDL::Window window("mjbench", width, height, SDL_WINDOW_HIDDEN);
+
+	GL::Device device;
+	SpriteBatch batch(device, GemSprites::SIZE, GemSprites::LAYER_COUNT, count);
+	GemSprites::Load(batch);
+
+	// the first frame compiles shaders and allocates driver state; do not count it
+	RunScene(device, batch, width, height, count, 1, false);
+
+	// a draw per sprite is much slower: fewer frames, and the same last frame for the comparison
+	const SceneTimes batched = RunScene(device, batch, width, height, count, frames, false);
+	const int slowFrames = std::max(1, frames / 10);
+	const SceneTimes perSprite = RunScene(device, batch, width, height, count, slowFrames, true);
+	const SceneTimes batchedCheck = RunScene(device, batch, width, height, count, slowFrames, false);
+
+	printf("sprite-batch.renderer %s\n", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+	printf("sprite-batch.sprites_per_frame %d\n", count);
+	printf("sprite-batch.batched_cpu_ns_per_sprite %.2f\n", batched.addMs * 1e6 / count);
+	printf("sprite-batch.batched_frame_ms %.3f\n", batched.frameMs);
+	printf("sprite-batch.batched_gl_calls_per_frame %.1f\n", batched.glCalls);
+	printf("sprite-batch.per_sprite_cpu_ns_per_sprite %.2f\n", perSprite.addMs * 1e6 / count);
+	printf("sprite-batch.per_sprite_frame_ms %.3f\n", perSprite.frameMs);
+	printf("sprite-batch.per_sprite_gl_calls_per_frame %.1f\n", perSprite.glCalls);
+	printf("sprite-batch.frame_speedup %.2f\n", perSprite.frameMs / batched.frameMs);
+	printf("sprite-batch.same_image %s\n", (perSprite.hash == batchedCheck.hash) ? "yes" : "no");
+	return (perSprite.hash == batchedCheck.hash) ? 0 : 1;
+}
+
+//---
+
+BENCHMARK("stream-buffer", "Sprite frames streamed through the persistently mapped ring without waiting on each frame, headless [sprites] [frames]")
+{
+	const int count = (argc > 1) ? atoi(argv[1]) : 16384;
+	const int frames = (argc > 2) ? atoi(argv[2]) : 120;
+	const int width = 1280, height = 1024;
+
+	Bench::UseHeadlessVideo();
+	SDL::Library libSDL(SDL_INIT_VIDEO);
+	SDL::Window window("mjbench", width, height, SDL_WINDOW_HIDDEN);
+
+	// a ring sized for the scene, one holding half of it (which must drop the rest),
+	// and one sized for the scene but given a quarter of it (whose peak must be just that)
+	GL::Device device;
+	SpriteBatch batch(device, GemSprites::SIZE, GemSprites::LAYER_COUNT, count);
+	SpriteBatch smallBatch(device, GemSprites::SIZE, GemSprites::LAYER_COUNT, std::max(1, count / 2));
+	SpriteBatch partialBatch(device, GemSprites::SIZE, GemSprites::LAYER_COUNT, count);
+	GemSprites::Load(batch);
+	GemSprites::Load(smallBatch);
+	GemSprites::Load(partialBatch);
+
+	struct Run {
+		const char* name;
+		SpriteBatch* batch;
+		int sprites;
+	};
+	const Run runs[] = {
+		{ "sized", &batch, count },
+		{ "undersized", &smallBatch, count },
+		{ "partial", &partialBatch, std::max(1, count / 4) },
+	};
+
+	int failures = 0;
+	for (const Run &run : runs) {
+		// no glFinish() between frames: the CPU runs ahead until the ring makes it wait
+		glFinish();
+		const GL::StreamBuffer::Stats before = run.batch->GetStreamStats();
+		const uint64_t callsBefore = device.GetRunningTotal().issued;
+		Bench::Stopwatch stopwatch;
+		for (int frame = 0; frame < frames; frame++) {
+			device.Viewport(0, 0, width, height);
+			device.Clear(GL_COLOR_BUFFER_BIT);
+			run.batch->Begin(width, height);
+			AddScene(*run.batch, width, height, run.sprites, frame, false);
+			run.batch->Flush();
+			SDL_GL_SwapWindow(window.getWindow());
+		}
+		glFinish();
+		const double totalMs = stopwatch.ElapsedMs();
+		const GL::StreamBuffer::Stats &after = run.batch->GetStreamStats();
+
+		printf("stream-buffer.%s.frame_ms %.3f\n", run.name, totalMs / frames);
+		printf("stream-buffer.%s.gl_calls_per_frame %.1f\n", run.name, double(device.GetRunningTotal().issued - callsBefore) / frames);
+		printf("stream-buffer.%s.stalls %llu\n", run.name, (unsigned long long)(after.stalls - before.stalls));
+		printf("stream-buffer.%s.wait_ms_per_frame %.3f\n", run.name, (after.waitMs - before.waitMs) / frames);
+		printf("stream-buffer.%s.dropped_per_frame %.1f\n", run.name, double(after.overflows - before.overflows) / frames);
+		printf("stream-buffer.%s.peak_kib %.1f\n", run.name, double(after.peakBytes) / 1024.0);
+		const bool dropped = (after.overflows != before.overflows);
+		if (dropped != (run.batch == &smallBatch)) failures++;
+		if (run.batch == &partialBatch && after.peakBytes != size_t(run.sprites) * sizeof(SpriteBatch::Sprite)) failures++;
+	}
+	return failures ? 1 : 0;
+}
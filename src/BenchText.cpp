@@ -0,0 +1,222 @@
+#include "Bench.h"
+#include "MapFile.h"
+#include "LoadFont.h"
+#include "TextRenderer.h"
+#include "TextLayout.h"
+#include "ToUnicode.h"
+#include "AllocCounter.h"
+#include "SDLWrapper.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+//---
+
+BENCHMARK("text-render", "Batched GPU text: CPU cost per glyph and frame time, headless [font] [frames]")
+{
+	const char* fontFileName = (argc > 1) ? argv[1] : Bench::kDefFontFile;
+	const int frames = (argc > 2) ? atoi(argv[2]) : 200;
+	const int width = 1280, height = 1024;
+
+	Bench::UseHeadlessVideo();
+	SDL::Library libSDL(SDL_INIT_VIDEO);
+	SDL::Window window("mjbench", width, height, SDL_WINDOW_HIDDEN);
+
+	MappedFile fontFile(fontFileName);
+	Font font(fontFile, 16.0f);
+	if (!fontFile.Ok() || !font.Ok()) {
+		fprintf(stderr, "text-render: could not load %s\n", fontFileName);
+		return 1;
+	}
+	GL::Device device;
+	TextRenderer renderer(device, font);
+
+	// a screenful of text: 60 lines of 100 characters
+	std::vector<std::wstring> lines;
+	for (int line = 0; line < 60; line++) {
+		std::wstring text;
+		for (int i = 0; i < 100; i++) {
+			text.push_back(wchar_t(0x21 + (line * 7 + i * 13) % 0x5e));
+		}
+		lines.push_back(text);
+	}
+
+	double addMs = 0.0, frameMs = 0.0;
+	long long glyphs = 0;
+	for (int frame = 0; frame < frames; frame++) {
+		Bench::Stopwatch frameStopwatch;
+		glViewport(0, 0, width, height);
+		glClearColor(0.0f, 0.0f, 0.3f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+
+		Bench::Stopwatch addStopwatch;
+		renderer.Begin(width, height);
+		float y = 16.0f;
+		for (const auto& text : lines) {
+			renderer.AddText(text, 4.0f, y, 0xffffffff);
+			y += 16.0f;
+		}
+		addMs += addStopwatch.ElapsedMs();
+		glyphs += renderer.GetGlyphCount();
+
+		renderer.Flush();
+		glFinish();
+		frameMs += frameStopwatch.ElapsedMs();
+	}
+
+	// sanity check that the text actually reached the framebuffer
+	std::vector<uint8_t> pixels(size_t(width) * height * 4);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	long long litPixels = 0;
+	for (size_t i = 0; i < pixels.size(); i += 4) {
+		if (pixels[i] > 128) litPixels++;
+	}
+
+	// text must be drawn as wide as it is measured, or centring and right alignment are off
+	int mismatchedWidths = 0;
+	renderer.Begin(width, height);
+	for (const auto& text : lines) {
+		const float advance = renderer.AddText(text, 0.0f, 16.0f);
+		if (fabsf(advance - float(font.ComputeTextSize(text).w)) > 0.5f) mismatchedWidths++;
+	}
+
+	printf("text-render.renderer %s\n", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+	printf("text-render.glyphs_per_frame %lld\n", glyphs / frames);
+	printf("text-render.draw_calls_per_frame 1\n");
+	printf("text-render.cpu_ns_per_glyph %.2f\n", addMs * 1e6 / double(glyphs));
+	printf("text-render.frame_ms %.3f\n", frameMs / frames);
+	printf("text-render.lit_pixels %lld\n", litPixels);
+	printf("text-render.mismatched_widths %d\n", mismatchedWidths);
+	return (litPixels > 0 && mismatchedWidths == 0) ? 0 : 1;
+}
+
+//---
+
+BENCHMARK("text-layout", "Laying out HUD strings every frame: uncached vs TextLayoutCache [font] [frames]")
+{
+	const char* fontFileName = (argc > 1) ? argv[1] : Bench::kDefFontFile;
+	const int frames = (argc > 2) ? atoi(argv[2]) : 2000;
+
+	MappedFile fontFile(fontFileName);
+	Font font(fontFile, 16.0f);
+	if (!fontFile.Ok() || !font.Ok()) {
+		fprintf(stderr, "text-layout: could not load %s\n", fontFileName);
+		return 1;
+	}
+
+	// what a HUD redraws each frame: a few labels that rarely change, one wrapped paragraph
+	const std::vector<std::wstring> strings = {
+		L"Score: 123450",
+		L"Level 7",
+		L"Moves left: 12",
+		L"Press Escape to pause the game, or click on two adjacent jewels to swap them. "
+		L"Three or more jewels of the same colour in a row or a column disappear, and the "
+		L"jewels above them fall down to fill the gap.",
+	};
+	const float wrapWidth = 320.0f;
+
+	Bench::Stopwatch stopwatch;
+	TextLayout layout;
+	size_t uncachedGlyphs = 0;
+	for (int frame = 0; frame < frames; frame++) {
+		for (const auto& text : strings) {
+			TextLayout::Compute(font, text, wrapWidth, layout);
+			uncachedGlyphs += layout.glyphs.size();
+		}
+	}
+	const double uncachedMs = stopwatch.ElapsedMs();
+
+	TextLayoutCache cache;
+	size_t cachedGlyphs = 0;
+	stopwatch.Restart();
+	for (int frame = 0; frame < frames; frame++) {
+		for (const auto& text : strings) {
+			cachedGlyphs += cache.Get(font, text, wrapWidth).glyphs.size();
+		}
+	}
+	const double cachedMs = stopwatch.ElapsedMs();
+
+	const double calls = double(frames) * strings.size();
+	printf("text-layout.paragraph_lines %d\n", cache.Get(font, strings.back(), wrapWidth).lineCount);
+	printf("text-layout.uncached_us_per_frame %.3f\n", uncachedMs * 1e3 / frames);
+	printf("text-layout.cached_us_per_frame %.3f\n", cachedMs * 1e3 / frames);
+	printf("text-layout.cached_ns_per_call %.1f\n", cachedMs * 1e6 / calls);
+	printf("text-layout.cache_hits %llu\n", (unsigned long long)cache.GetHitCount());
+	printf("text-layout.cache_misses %llu\n", (unsigned long long)cache.GetMissCount());
+	return (cachedGlyphs == uncachedGlyphs) ? 0 : 1;
+}
+
+//---
+
+BENCHMARK("text-alloc", "Heap allocations per frame when measuring, laying out and drawing HUD text [font] [frames]")
+{
+	const char* fontFileName = (argc > 1) ? argv[1] : Bench::kDefFontFile;
+	const int frames = (argc > 2) ? atoi(argv[2]) : 1000;
+	const int width = 1280, height = 1024;
+
+	Bench::UseHeadlessVideo();
+	SDL::Library libSDL(SDL_INIT_VIDEO);
+	SDL::Window window("mjbench", width, height, SDL_WINDOW_HIDDEN);
+
+	MappedFile fontFile(fontFileName);
+	Font font(fontFile, 16.0f);
+	if (!fontFile.Ok() || !font.Ok()) {
+		fprintf(stderr, "text-alloc: could not load %s\n", fontFileName);
+		return 1;
+	}
+	GL::Device device;
+	TextRenderer renderer(device, font);
+
+	const char* scoreText = "Skóre: 123450";
+	const std::u8string_view scoreView = u8"Skóre: 123450";
+	const std::u32string_view levelView = U"Úroveň 7";
+	const std::u8string_view help = u8"Stiskni Escape pro pauzu, nebo klikni na dva sousední drahokamy.";
+
+	// one frame first, so that the driver's one-time allocations (e.g. shader variants) are not counted
+	renderer.Begin(width, height);
+	renderer.AddText(scoreView, 0.0f, 16.0f);
+	renderer.Flush();
+	glFinish();
+
+	// the old path: convert to a fresh std::wstring, then measure and draw it
+	uint64_t before = AllocCounter::GetCount();
+	Bench::Stopwatch stopwatch;
+	for (int frame = 0; frame < frames; frame++) {
+		renderer.Begin(width, height);
+		const std::wstring score = MultibyteToWideString(scoreText);
+		const SDL_Rect size = font.ComputeTextSize(score);
+		renderer.AddText(score, float(width - size.w), 16.0f);
+		renderer.Flush();
+	}
+	const double wideMs = stopwatch.ElapsedMs();
+	const uint64_t wideAllocations = AllocCounter::GetCount() - before;
+
+	// views decoded on the fly, a layout reused across frames, and a cached one
+	TextLayout layout;
+	TextLayout::Compute(font, help, 400.0f, layout);
+	TextLayoutCache cache;
+	cache.Get(font, scoreView);
+	before = AllocCounter::GetCount();
+	stopwatch.Restart();
+	for (int frame = 0; frame < frames; frame++) {
+		renderer.Begin(width, height);
+		const SDL_Rect size = font.ComputeTextSize(scoreView);
+		renderer.AddText(scoreView, float(width - size.w), 16.0f);
+		renderer.AddText(levelView, 4.0f, 16.0f);
+		TextLayout::Compute(font, help, 400.0f, layout);
+		renderer.AddLayout(layout, 4.0f, 32.0f);
+		renderer.AddLayout(cache.Get(font, scoreView), 4.0f, 128.0f);
+		renderer.Flush();
+	}
+	const double viewMs = stopwatch.ElapsedMs();
+	const uint64_t viewAllocations = AllocCounter::GetCount() - before;
+
+	printf("text-alloc.wstring_allocations_per_frame %.2f\n", double(wideAllocations) / frames);
+	printf("text-alloc.wstring_us_per_frame %.3f\n", wideMs * 1e3 / frames);
+	printf("text-alloc.view_allocations_per_frame %.2f\n", double(viewAllocations) / frames);
+	printf("text-alloc.view_us_per_frame %.3f\n", viewMs * 1e3 / frames);
+	return viewAllocations == 0 ? 0 : 1;
+}
@@ -0,0 +1,184 @@
+#include "Bench.h"
+#include "Board.h"
+#include "TimerWheel.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <vector>
+
+namespace {
+
+/// The timer wheel, on synthetic time.
+class WheelScheduler
+{
+public:
+
+	using Handle = TimerWheel::Handle;
+
+	Handle Add(uint64_t deadline, std::function<void(void)> callback) { return wheel.AddAt(deadline, std::move(callback)); }
+	void Cancel(Handle handle) { wheel.Cancel(handle); }
+	void Advance(uint64_t now) { wheel.Advance(now); }
+	uint64_t Now() const { return wheel.GetTime(); }
+
+protected:
+
+	TimerWheel wheel { 0 };
+};
+
+//---
+
+/// The usual alternative: timers ordered by deadline in a tree.
+class MapScheduler
+{
+public:
+
+	using Timers = std::multimap<uint64_t, std::function<void(void)>>;
+	using Handle = Timers::iterator;
+
+	Handle Add(uint64_t deadline, std::function<void(void)> callback) { return timers.emplace(deadline, std::move(callback)); }
+	void Cancel(Handle handle) { timers.erase(handle); }
+	uint64_t Now() const { return now; }
+
+	void Advance(uint64_t now_)
+	{
+		now = now_;
+		while (!timers.empty() && timers.begin()->first <= now) {
+			auto node = timers.extract(timers.begin());
+			node.mapped()();
+		}
+	}
+
+protected:
+
+	Timers timers;
+	uint64_t now = 0;
+};
+
+//---
+
+/// Delay of an effect timer: mostly animation steps, some longer effects, a few idle hints.
+uint64_t NextDelay(Random &random)
+{
+	const uint64_t us = 1000;
+	const int kind = random.NextBelow(10);
+	if (kind < 6) return (1000 + uint64_t(random.NextBelow(100000))) * us;
+	if (kind < 9) return (100000 + uint64_t(random.NextBelow(1900000))) * us;
+	return (2000000 + uint64_t(random.NextBelow(58000000))) * us;
+}
+
+//---
+
+/**
+ * Keeps `count` timers running: each re-arms itself when it fires, and a few
+ * are cancelled and re-armed every frame. Every timer draws its delays from
+ * its own generator, so the same timers fire whatever the order within a frame.
+ */
+template <class Scheduler>
+class Simulation
+{
+public:
+
+	struct Result {
+		double insertNs = 0.0;			///< Per timer added.
+		double frameNs = 0.0;			///< Per Advance() with the frame's cancels.
+		double cancelNs = 0.0;			///< Per timer cancelled.
+		uint64_t fired = 0;
+		uint64_t early = 0;				///< Callbacks before their deadline (must be 0).
+		uint64_t maxLatenessNs = 0;
+	};
+
+	Result Run(int count, int frames, uint64_t frameLengthNs, int cancelsPerFrame)
+	{
+		handles.resize(count);
+		deadlines.resize(count);
+		for (int i = 0; i < count; i++) {
+			randoms.emplace_back(uint64_t(i) + 1);
+		}
+
+		Bench::Stopwatch stopwatch;
+		for (int i = 0; i < count; i++) {
+			Arm(i);
+		}
+		result.insertNs = stopwatch.ElapsedMs() * 1e6 / count;
+
+		stopwatch.Restart();
+		for (int frame = 1; frame <= frames; frame++) {
+			for (int k = 0; k < cancelsPerFrame; k++) {
+				const int i = int((uint64_t(frame) * 7919 + uint64_t(k) * 104729) % uint64_t(count));
+				scheduler.Cancel(handles[i]);
+				Arm(i);
+			}
+			scheduler.Advance(uint64_t(frame) * frameLengthNs);
+		}
+		result.frameNs = stopwatch.ElapsedMs() * 1e6 / frames;
+
+		stopwatch.Restart();
+		for (int i = 0; i < count; i++) {
+			scheduler.Cancel(handles[i]);
+		}
+		result.cancelNs = stopwatch.ElapsedMs() * 1e6 / count;
+		return result;
+	}
+
+protected:
+
+	void Arm(int i)
+	{
+		deadlines[i] = scheduler.Now() + NextDelay(randoms[i]);
+		handles[i] = scheduler.Add(deadlines[i], [this, i]() { Fire(i); });
+	}
+
+	void Fire(int i)
+	{
+		result.fired++;
+		const uint64_t now = scheduler.Now();
+		if (now < deadlines[i]) {
+			result.early++;
+		}
+		else {
+			result.maxLatenessNs = std::max(result.maxLatenessNs, now - deadlines[i]);
+		}
+		Arm(i);
+	}
+
+	Scheduler scheduler;
+	std::vector<typename Scheduler::Handle> handles;
+	std::vector<uint64_t> deadlines;
+	std::vector<Random> randoms;
+	Result result;
+};
+
+} // namespace
+
+//---
+
+BENCHMARK("timer-wheel", "Main-thread timers: hierarchical timer wheel vs std::multimap, 1 ms frames of synthetic time [timers] [seconds]")
+{
+	const int count = (argc > 1) ? atoi(argv[1]) : 10000;
+	const int seconds = (argc > 2) ? atoi(argv[2]) : 60;
+	const uint64_t frameLengthNs = 1000000;
+	const int frames = seconds * 1000;
+	const int cancelsPerFrame = 10;
+
+	Simulation<WheelScheduler> wheel;
+	const auto wheelResult = wheel.Run(count, frames, frameLengthNs, cancelsPerFrame);
+	Simulation<MapScheduler> map;
+	const auto mapResult = map.Run(count, frames, frameLengthNs, cancelsPerFrame);
+
+	printf("timers.count %d\n", count);
+	printf("timers.fired %llu\n", (unsigned long long)wheelResult.fired);
+	printf("timers.wheel_insert_ns %.1f\n", wheelResult.insertNs);
+	printf("timers.wheel_cancel_ns %.1f\n", wheelResult.cancelNs);
+	printf("timers.wheel_frame_us %.2f\n", wheelResult.frameNs / 1000.0);
+	printf("timers.map_insert_ns %.1f\n", mapResult.insertNs);
+	printf("timers.map_cancel_ns %.1f\n", mapResult.cancelNs);
+	printf("timers.map_frame_us %.2f\n", mapResult.frameNs / 1000.0);
+	printf("timers.frame_speedup %.2f\n", mapResult.frameNs / wheelResult.frameNs);
+	printf("timers.early %llu\n", (unsigned long long)wheelResult.early);
+	printf("timers.max_lateness_us %.1f\n", double(wheelResult.maxLatenessNs) / 1000.0);
+	printf("timers.same_as_map %s\n", (wheelResult.fired == mapResult.fired) ? "yes" : "no");
+	return (wheelResult.early == 0 && wheelResult.fired == mapResult.fired) ? 0 : 1;
+}
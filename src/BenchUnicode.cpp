@@ -0,0 +1,90 @@
+#include "Bench.h"
+#include "ToUnicode.h"
+
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+#include <cwchar>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+//---
+
+/// The former MultibyteToWideString(): two passes of mbsrtowcs(), needs a UTF-8 locale.
+static std::wstring MbsrtowcsToWideString(const char* source)
+{
+	const char* p = source;
+	auto mbstate = std::mbstate_t();
+	const size_t count = std::mbsrtowcs(nullptr, &p, 0, &mbstate);
+	if (count == size_t(-1)) return std::wstring();
+
+	std::wstring result(count, L'\0');
+	p = source;
+	mbstate = std::mbstate_t();
+	std::mbsrtowcs(result.data(), &p, count, &mbstate);
+	return result;
+}
+
+//---
+
+BENCHMARK("utf8-decode", "UTF-8 to UTF-32 throughput in MB/s: mbsrtowcs() vs DecodeUtf8() [MiB per text] [runs]")
+{
+	const size_t textSize = size_t((argc > 1) ? atof(argv[1]) : 4.0) * 1024 * 1024;
+	const int runs = (argc > 2) ? atoi(argv[2]) : 10;
+
+	// the reference needs a UTF-8 locale; the new decoder does not care
+	if (!setlocale(LC_CTYPE, "C.UTF-8") && !setlocale(LC_CTYPE, "en_US.UTF-8")) {
+		fprintf(stderr, "utf8-decode: no UTF-8 locale for the mbsrtowcs() reference\n");
+		return 1;
+	}
+
+	struct Sample {
+		const char* name;
+		const char* text;
+	};
+	const Sample samples[] = {
+		{ "ascii", "Score: 123450  Level 7  Press Escape to pause the game. " },
+		{ "czech", "Příliš žluťoučký kůň úpěl ďábelské ódy, skóre: 123450. " },
+		{ "cjk", "真夜中の宝石、スコア：一二三四五〇。" },
+	};
+
+	bool identical = true;
+	for (const Sample &sample : samples) {
+		std::string text;
+		while (text.size() < textSize) text += sample.text;
+
+		std::vector<double> referenceMs, convertMs, decodeMs;
+		std::vector<char32_t> buffer(text.size());
+		std::wstring reference, converted;
+		Utf8DecodeResult decoded;
+		for (int run = 0; run < runs; run++) {
+			Bench::Stopwatch stopwatch;
+			reference = MbsrtowcsToWideString(text.c_str());
+			referenceMs.push_back(stopwatch.ElapsedMs());
+
+			stopwatch.Restart();
+			converted = MultibyteToWideString(text.c_str());
+			convertMs.push_back(stopwatch.ElapsedMs());
+
+			stopwatch.Restart();
+			decoded = DecodeUtf8(text.data(), text.size(), buffer.data(), buffer.size());
+			decodeMs.push_back(stopwatch.ElapsedMs());
+		}
+
+		identical = identical && decoded.status == Utf8Status::Ok
+			&& converted == reference && decoded.written == reference.size()
+			&& std::equal(reference.begin(), reference.end(), buffer.begin(),
+				[](wchar_t a, char32_t b) { return char32_t(a) == b; });
+
+		auto megabytesPerSecond = [&text](std::vector<double> &samplesMs) {
+			return double(text.size()) / (1024.0 * 1024.0) / (Bench::Median(samplesMs) / 1000.0);
+		};
+		printf("utf8-decode.%s.mbsrtowcs_mb_s %.1f\n", sample.name, megabytesPerSecond(referenceMs));
+		printf("utf8-decode.%s.multibyte_to_wide_mb_s %.1f\n", sample.name, megabytesPerSecond(convertMs));
+		printf("utf8-decode.%s.decode_utf8_mb_s %.1f\n", sample.name, megabytesPerSecond(decodeMs));
+	}
+
+	printf("utf8-decode.identical %d\n", identical ? 1 : 0);
+	return identical ? 0 : 1;
+}
@@ -0,0 +1,267 @@
+#include "Board.h"
+
+#include <algorithm>
+#include <array>
+
+#if defined(__x86_64__)
+#define BOARD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using Mask = Board::Mask;
+
+/// Cells where a vertical run of three can start (rows 0 to 5 of every column).
+const Mask kVerticalRunStarts = 0x3f3f3f3f3f3f3f3full;
+
+//---
+
+/// Gravity without BMI2: closes the holes one by one, top down, moving the cells above each down by one.
+void CollapsePortable(Mask* colors, Mask occupied)
+{
+	for (Mask holes = ~occupied; holes; ) {
+		const int hole = 63 - __builtin_clzll(holes);
+		holes &= ~(Mask(1) << hole);
+		const Mask column = Mask(0xff) << (hole & ~(Board::SIZE - 1));
+		const Mask above = column & ~((Mask(2) << hole) - 1);
+		for (int color = 0; color < Board::MAX_COLORS; color++) {
+			colors[color] = (colors[color] & ~above) | ((colors[color] & above) >> 1);
+		}
+	}
+}
+
+//---
+
+#ifdef BOARD_X86
+
+/// For every column, as many cells from the bottom as it has occupied ones.
+Mask CompactOccupancy(Mask occupied)
+{
+	// population count of each byte, i.e. of each column
+	Mask counts = occupied - ((occupied >> 1) & 0x5555555555555555ull);
+	counts = (counts & 0x3333333333333333ull) + ((counts >> 2) & 0x3333333333333333ull);
+	counts = (counts + (counts >> 4)) & 0x0f0f0f0f0f0f0f0full;
+
+	Mask result = 0;
+	for (int column = 0; column < Board::SIZE; column++) {
+		const unsigned count = unsigned(counts >> (column * 8)) & 0xff;
+		result |= Mask((1u << count) - 1) << (column * 8);
+	}
+	return result;
+}
+
+//---
+
+/**
+ * Gravity for all columns at once: pext packs the surviving gems of a colour
+ * (column by column, bottom up), pdep unpacks them into the bottom cells of
+ * the same columns; the order of gems within a column is kept.
+ */
+__attribute__((target("bmi2")))
+void CollapseBMI2(Mask* colors, Mask occupied)
+{
+	const Mask compacted = CompactOccupancy(occupied);
+	for (int color = 0; color < Board::MAX_COLORS; color++) {
+		colors[color] = _pdep_u64(_pext_u64(colors[color], occupied), compacted);
+	}
+}
+
+#endif
+
+} // namespace
+
+//---
+
+Board::Board(int colorCount_)
+	: colorCount(std::clamp(colorCount_, 1, MAX_COLORS))
+{
+}
+
+//---
+
+int Board::GetColor(int column, int row) const
+{
+	const Mask bit = Bit(column, row);
+	for (int color = 0; color < colorCount; color++) {
+		if (colors[color] & bit) return color;
+	}
+	return -1;
+}
+
+//---
+
+void Board::SetColor(int column, int row, int color)
+{
+	const Mask bit = Bit(column, row);
+	for (Mask &colorMask : colors) {
+		colorMask &= ~bit;
+	}
+	if (color >= 0 && color < colorCount) {
+		colors[color] |= bit;
+	}
+}
+
+//---
+
+Board::Mask Board::GetOccupied() const
+{
+	Mask occupied = 0;
+	for (Mask colorMask : colors) {
+		occupied |= colorMask;
+	}
+	return occupied;
+}
+
+//---
+
+Board::Mask Board::FindMatches() const
+{
+	// a run starts at a cell whose two neighbours to the right (or above) have the same colour;
+	// shifting by whole columns cannot wrap, shifting by rows is masked to stay within the column
+	Mask matched = 0;
+	for (Mask gems : colors) {
+		const Mask horizontal = gems & (gems >> SIZE) & (gems >> (2 * SIZE));
+		const Mask vertical = gems & (gems >> 1) & (gems >> 2) & kVerticalRunStarts;
+		matched |= horizontal | (horizontal << SIZE) | (horizontal << (2 * SIZE))
+			| vertical | (vertical << 1) | (vertical << 2);
+	}
+	return matched;
+}
+
+//---
+
+int Board::Remove(Mask cells)
+{
+	const int removed = __builtin_popcountll(cells & GetOccupied());
+	for (Mask &colorMask : colors) {
+		colorMask &= ~cells;
+	}
+	return removed;
+}
+
+//---
+
+void Board::Collapse()
+{
+	const Mask occupied = GetOccupied();
+#ifdef BOARD_X86
+	static const bool haveBMI2 = __builtin_cpu_supports("bmi2");
+	if (haveBMI2) {
+		CollapseBMI2(colors, occupied);
+		return;
+	}
+#endif
+	CollapsePortable(colors, occupied);
+}
+
+//---
+
+void Board::Refill(Random &random)
+{
+	for (Mask empty = ~GetOccupied(); empty; empty &= empty - 1) {
+		colors[random.NextBelow(colorCount)] |= empty & (~empty + 1);
+	}
+}
+
+//---
+
+void Board::Fill(Random &random)
+{
+	for (Mask &colorMask : colors) {
+		colorMask = 0;
+	}
+	for (int column = 0; column < SIZE; column++) {
+		for (int row = 0; row < SIZE; row++) {
+			int color;
+			do {
+				color = random.NextBelow(colorCount);
+			} while (colorCount >= 3 && (
+				(row >= 2 && GetColor(column, row - 1) == color && GetColor(column, row - 2) == color) ||
+				(column >= 2 && GetColor(column - 1, row) == color && GetColor(column - 2, row) == color)));
+			colors[color] |= Bit(column, row);
+		}
+	}
+}
+
+//---
+
+void Board::Swap(int column1, int row1, int column2, int row2)
+{
+	const int shift1 = column1 * SIZE + row1, shift2 = column2 * SIZE + row2;
+	for (Mask &colorMask : colors) {
+		const Mask bit1 = (colorMask >> shift1) & 1, bit2 = (colorMask >> shift2) & 1;
+		colorMask = (colorMask & ~((Mask(1) << shift1) | (Mask(1) << shift2)))
+			| (bit1 << shift2) | (bit2 << shift1);
+	}
+}
+
+//---
+
+int Board::FindMoves(Move* moves) const
+{
+	// a swap can only create a run next to one of the two cells, so try each and check the board
+	int count = 0;
+	Board swapped = *this;
+	for (int column = 0; column < SIZE; column++) {
+		for (int row = 0; row < SIZE; row++) {
+			for (bool vertical : { false, true }) {
+				const Move move { uint8_t(column), uint8_t(row), vertical };
+				if (move.GetColumn2() >= SIZE || move.GetRow2() >= SIZE) continue;
+
+				const Mask touched = Bit(column, row) | Bit(move.GetColumn2(), move.GetRow2());
+				if (GetColor(column, row) == GetColor(move.GetColumn2(), move.GetRow2())) continue;
+				swapped.Apply(move);
+				if (swapped.FindMatches() & touched) {
+					moves[count++] = move;
+				}
+				swapped.Apply(move);	// swap back
+			}
+		}
+	}
+	return count;
+}
+
+//---
+
+uint64_t Board::GetHash() const
+{
+	// one random key per cell and colour, generated once
+	static const auto keys = []() {
+		std::array<uint64_t, SIZE * SIZE * MAX_COLORS> table;
+		Random random(0x5eed);
+		for (uint64_t &key : table) key = random.Next();
+		return table;
+	}();
+
+	uint64_t hash = 0;
+	for (int color = 0; color < MAX_COLORS; color++) {
+		for (Mask gems = colors[color]; gems; gems &= gems - 1) {
+			hash ^= keys[__builtin_ctzll(gems) * MAX_COLORS + color];
+		}
+	}
+	return hash;
+}
+
+//---
+
+Board::Cascade Board::Resolve(Random &random)
+{
+	Cascade cascade;
+	for (Mask matches = FindMatches(); matches; matches = FindMatches()) {
+		cascade.steps++;
+		const int removed = Remove(matches);
+		cascade.removed += removed;
+		cascade.score += removed * cascade.steps;
+		Collapse();
+		Refill(random);
+	}
+	return cascade;
+}
+
+//---
+
+bool Board::operator==(const Board &other) const
+{
+	return colorCount == other.colorCount && std::equal(colors, colors + MAX_COLORS, other.colors);
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+
+/// Small, fast and reproducible random generator (xorshift64*); the same seed gives the same sequence everywhere.
+class Random
+{
+public:
+
+	explicit Random(uint64_t seed = 1) { Seed(seed); }
+
+	/// Any seed works, including 0.
+	void Seed(uint64_t seed) { state = seed ^ 0x9e3779b97f4a7c15ull; if (!state) state = 1; }
+
+	uint64_t Next() {
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return state * 0x2545f4914f6cdd1dull;
+	}
+
+	/// Uniform in [0, bound) (with a negligible bias for small bounds).
+	int NextBelow(int bound) { return int(((Next() >> 32) * uint64_t(bound)) >> 32); }
+
+	uint64_t GetState() const { return state; }
+
+protected:
+
+	uint64_t state;
+};
+
+//---
+
+/**
+ * The match-3 playfield: 8x8 cells, each empty or holding a gem of one of
+ * up to MAX_COLORS colours. Every colour is a bitboard (one bit per cell),
+ * so finding runs, removing them and letting the gems fall take a handful
+ * of word operations per colour instead of loops over the cells.
+ *
+ * Cells are addressed by column (0 = left) and row (0 = bottom), bit
+ * column * 8 + row: a column is one byte, its bottom cell the lowest bit.
+ */
+class Board
+{
+public:
+
+	static const int SIZE = 8;
+	static const int MAX_COLORS = 8;
+	static const int DEFAULT_COLORS = 7;
+
+	/// Set of cells, one bit per cell.
+	using Mask = uint64_t;
+
+	static constexpr Mask kFull = ~Mask(0);
+
+	static constexpr Mask Bit(int column, int row) { return Mask(1) << (column * SIZE + row); }
+
+	/// An empty board; colorCount is clamped to [1, MAX_COLORS].
+	explicit Board(int colorCount = DEFAULT_COLORS);
+
+	int GetColorCount() const { return colorCount; }
+
+	/// \return The colour of the cell, -1 if it is empty.
+	int GetColor(int column, int row) const;
+
+	/// Puts a gem of the colour in the cell (-1 empties it).
+	void SetColor(int column, int row, int color);
+
+	Mask GetColorMask(int color) const { return colors[color]; }
+	Mask GetOccupied() const;
+
+	/// Cells in horizontal or vertical runs of three or more gems of the same colour.
+	Mask FindMatches() const;
+
+	/// Empties the cells. \return The number of gems removed.
+	int Remove(Mask cells);
+
+	/// Lets the gems fall down to fill the empty cells below them; the empty cells end up at the tops of the columns.
+	void Collapse();
+
+	/**
+	 * Puts random gems into the empty cells, in bit order (column by column,
+	 * bottom up), so that a seed always produces the same board.
+	 */
+	void Refill(Random &random);
+
+	/// Fills the board with random gems, rerolling cells until there are no runs.
+	void Fill(Random &random);
+
+	/// Exchanges the contents of two cells.
+	void Swap(int column1, int row1, int column2, int row2);
+
+	/// Swap of a cell with its neighbour to the right, or above.
+	struct Move {
+		uint8_t column;
+		uint8_t row;
+		bool vertical;
+
+		int GetColumn2() const { return vertical ? column : column + 1; }
+		int GetRow2() const { return vertical ? row + 1 : row; }
+	};
+
+	/// Number of possible swaps, i.e. of pairs of neighbouring cells.
+	static const int MAX_MOVES = 2 * SIZE * (SIZE - 1);
+
+	/**
+	 * Lists the swaps that make a run (the only ones the game allows).
+	 * \param moves Room for MAX_MOVES moves.
+	 * \return The number of moves written.
+	 */
+	int FindMoves(Move* moves) const;
+
+	void Apply(const Move &move) { Swap(move.column, move.row, move.GetColumn2(), move.GetRow2()); }
+
+	/// Zobrist hash of the cells (equal boards hash equally, whatever the history).
+	uint64_t GetHash() const;
+
+	/// Outcome of Resolve().
+	struct Cascade {
+		int steps = 0;		///< Rounds of matches cleared (1 = no chain reaction).
+		int removed = 0;	///< Gems removed in all rounds.
+		int score = 0;		///< Gems removed, each counting as many points as the round it fell in.
+	};
+
+	/**
+	 * Clears matches, collapses and refills until no runs are left.
+	 * \return What happened; steps is 0 if there was nothing to clear.
+	 */
+	Cascade Resolve(Random &random);
+
+	bool operator==(const Board &other) const;
+
+protected:
+
+	int colorCount;
+	Mask colors[MAX_COLORS] = {};
+};
@@ -0,0 +1,140 @@
+#include "FontCache.h"
+#include "SDL.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <algorithm>
+
+namespace FontCache {
+
+//---
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+//---
+
+uint64_t HashBytes(const uint8_t* data, size_t size)
+{
+	const uint64_t kPrime = 0x100000001b3ull;
+	uint64_t hash = 0xcbf29ce484222325ull ^ size;
+
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, data + i, sizeof(word));
+		hash = (hash ^ word) * kPrime;
+	}
+	for (; i < size; i++) {
+		hash = (hash ^ data[i]) * kPrime;
+	}
+	return hash;
+}
+
+//---
+
+static bool WritePadding(FILE* f, size_t byteCount)
+{
+	static const uint8_t zeroes[kPixelAlignment] = { 0 };
+	return byteCount == 0 || fwrite(zeroes, byteCount, 1, f) == 1;
+}
+
+//---
+
+static bool KeysEqual(const Key& a, const Key& b)
+{
+	return a.fontHash == b.fontHash
+		&& a.fontSize == b.fontSize
+		&& a.oversampling == b.oversampling
+		&& a.width == b.width
+		&& a.height == b.height
+		&& a.charCount == b.charCount
+		&& a.sdf == b.sdf;
+}
+
+//---
+
+const Header* Validate(const MappedFile& cacheFile, const Key& key)
+{
+	if (!cacheFile.Ok() || cacheFile.GetSize() < sizeof(Header)) return nullptr;
+
+	const Header* header = reinterpret_cast<const Header*>(cacheFile.GetData());
+	if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0) return nullptr;
+	if (header->version != kVersion || header->headerSize != sizeof(Header)) return nullptr;
+	if (!KeysEqual(header->key, key)) return nullptr;
+	if (header->fileSize != cacheFile.GetSize()) return nullptr;
+
+	const uint64_t charsSize = uint64_t(key.charCount) * sizeof(stbtt_packedchar);
+	const uint64_t pixelsSize = uint64_t(header->pitch) * key.height;
+	if (header->pitch < key.width) return nullptr;
+	if (header->charsOffset % alignof(stbtt_packedchar) != 0) return nullptr;
+	if (header->charsOffset + charsSize > header->fileSize) return nullptr;
+	if (header->pixelsOffset + pixelsSize > header->fileSize) return nullptr;
+
+	// the slot count must be a power of two and lookups must find an empty slot
+	const uint64_t kernSize = uint64_t(header->kernSlotCount) * sizeof(KernTable::Slot);
+	if (header->kernSlotCount == 0 || (header->kernSlotCount & (header->kernSlotCount - 1)) != 0) return nullptr;
+	if (header->kernOffset % alignof(KernTable::Slot) != 0) return nullptr;
+	if (header->kernOffset + kernSize > header->fileSize) return nullptr;
+	const KernTable::Slot* kernSlots = GetKernSlots(cacheFile, *header);
+	if (std::none_of(kernSlots, kernSlots + header->kernSlotCount,
+		[](const KernTable::Slot &slot) { return slot.pair == KernTable::EMPTY_PAIR; })
+	) {
+		return nullptr;
+	}
+
+	return header;
+}
+
+//---
+
+bool Write(const char* fileName, const Key& key,
+	const stbtt_packedchar* chars, const KernTable& kernTable, const uint8_t* pixels, int pitch)
+{
+	Header header = {};
+	memcpy(header.magic, kMagic, sizeof(kMagic));
+	header.version = kVersion;
+	header.headerSize = sizeof(Header);
+	header.key = key;
+	header.pitch = uint32_t(pitch);
+	header.kernSlotCount = kernTable.GetSlotCount();
+	header.charsOffset = AlignUp(sizeof(Header), alignof(stbtt_packedchar));
+	header.kernOffset = AlignUp(header.charsOffset + key.charCount * sizeof(stbtt_packedchar), alignof(KernTable::Slot));
+	header.pixelsOffset = AlignUp(header.kernOffset + header.kernSlotCount * sizeof(KernTable::Slot), kPixelAlignment);
+	header.fileSize = header.pixelsOffset + uint64_t(pitch) * key.height;
+
+	const std::string tempFileName = std::string(fileName) + ".tmp";
+	FILE* f = fopen(tempFileName.c_str(), "wb");
+	if (!f) {
+		SDL_SetError("FontCache::Write(): could not create %s", tempFileName.c_str());
+		return false;
+	}
+
+	const size_t charsEnd = header.charsOffset + key.charCount * sizeof(stbtt_packedchar);
+	const size_t kernEnd = header.kernOffset + header.kernSlotCount * sizeof(KernTable::Slot);
+	bool written = (fwrite(&header, sizeof(header), 1, f) == 1)
+		&& WritePadding(f, header.charsOffset - sizeof(header))
+		&& (fwrite(chars, sizeof(stbtt_packedchar), key.charCount, f) == key.charCount)
+		&& WritePadding(f, header.kernOffset - charsEnd)
+		&& (fwrite(kernTable.GetSlots(), sizeof(KernTable::Slot), header.kernSlotCount, f) == header.kernSlotCount)
+		&& WritePadding(f, header.pixelsOffset - kernEnd)
+		&& (fwrite(pixels, size_t(pitch) * key.height, 1, f) == 1);
+
+	if (fclose(f) != 0 || !written) {
+		SDL_SetError("FontCache::Write(): could not write %s", tempFileName.c_str());
+		remove(tempFileName.c_str());
+		return false;
+	}
+
+	if (rename(tempFileName.c_str(), fileName) != 0) {
+		SDL_SetError("FontCache::Write(): could not rename %s", tempFileName.c_str());
+		remove(tempFileName.c_str());
+		return false;
+	}
+	return true;
+}
+
+} // namespace FontCache
@@ -0,0 +1,91 @@
+#pragma once
+
+// On-disk format of a rasterized font atlas, so that Font does not have
+// to re-rasterize all glyphs on every start.
+//
+// The file is laid out so that it can be used directly from a MappedFile:
+// a fixed header, then the stbtt_packedchar table, then the slots of the
+// KernTable, then the atlas pixels (one byte per pixel, rows of `pitch`
+// bytes). All tables are aligned,
+// so the pointers into the mapping can be handed out as they are.
+
+#include <cstdint>
+#include <cstddef>
+
+#include "MapFile.h"
+#include "KernTable.h"
+
+#include "stb_truetype.h"
+
+namespace FontCache {
+
+/// Identifies the contents of the cache; when any of these changes,
+/// the cache is stale and must be rebuilt.
+struct Key
+{
+	uint64_t fontHash = 0;		///< HashBytes() of the whole font file.
+	float fontSize = 0.0f;
+	uint32_t oversampling = 1;
+	uint32_t width = 0;			///< Atlas width in pixels.
+	uint32_t height = 0;		///< Atlas height in pixels.
+	uint32_t charCount = 0;		///< Number of entries in the packedchar table.
+	uint32_t sdf = 0;			///< 1 if the atlas holds signed distance fields.
+};
+
+struct Header
+{
+	char magic[8];				///< kMagic
+	uint32_t version;			///< kVersion
+	uint32_t headerSize;		///< sizeof(Header), guards against layout changes
+	Key key;
+	uint32_t pitch;				///< Bytes per pixel row.
+	uint32_t kernSlotCount;		///< Number of KernTable slots (a power of two).
+	uint64_t charsOffset;		///< Offset of the stbtt_packedchar table.
+	uint64_t kernOffset;		///< Offset of the KernTable slots.
+	uint64_t pixelsOffset;		///< Offset of the pixel data.
+	uint64_t fileSize;			///< Total size, to detect truncated files.
+};
+
+static const char kMagic[8] = { 'M', 'J', 'F', 'A', 'T', 'L', 'A', 'S' };
+static const uint32_t kVersion = 4;
+
+/// Alignment of the pixel data within the file.
+static const size_t kPixelAlignment = 64;
+
+/// Fast non-cryptographic 64-bit hash (FNV-1a over 64-bit words).
+uint64_t HashBytes(const uint8_t* data, size_t size);
+
+/**
+ * Checks that the mapped file is a complete cache matching the given key.
+ * \return The header within the mapping, or nullptr if the cache is unusable.
+ */
+const Header* Validate(const MappedFile& cacheFile, const Key& key);
+
+/// Returns the packedchar table of a validated cache (points into the mapping).
+inline const stbtt_packedchar* GetChars(const MappedFile& cacheFile, const Header& header)
+{
+	return reinterpret_cast<const stbtt_packedchar*>(cacheFile.GetData() + header.charsOffset);
+}
+
+/// Returns the kerning table slots of a validated cache (points into the mapping).
+inline const KernTable::Slot* GetKernSlots(const MappedFile& cacheFile, const Header& header)
+{
+	return reinterpret_cast<const KernTable::Slot*>(cacheFile.GetData() + header.kernOffset);
+}
+
+/// Returns the atlas pixels of a validated cache (points into the mapping).
+inline const uint8_t* GetPixels(const MappedFile& cacheFile, const Header& header)
+{
+	return cacheFile.GetData() + header.pixelsOffset;
+}
+
+/**
+ * Writes a new cache file. The file is written under a temporary name
+ * and renamed at the end, so a concurrently starting process never maps
+ * a half-written cache.
+ * \return True on success; on error, SDL_SetError() is used.
+ */
+bool Write(const char* fileName, const Key& key,
+	const stbtt_packedchar* chars, const KernTable& kernTable, const uint8_t* pixels, int pitch);
+
+} // namespace FontCache
@@ -0,0 +1,166 @@
+#include "GLDevice.h"
+
+#include <cmath>
+
+namespace GL {
+
+//---
+
+Device::Device(bool shadowing_)
+	: shadowing(shadowing_)
+{
+	Invalidate();
+}
+
+//---
+
+void Device::BeginFrame()
+{
+	lastFrame = frame;
+	total.issued += frame.issued;
+	total.skipped += frame.skipped;
+	frame = Counters();
+}
+
+//---
+
+void Device::Invalidate()
+{
+	program = vertexArray = blend = UNKNOWN;
+	blendSource = blendDestination = UNKNOWN;
+	for (GLuint &texture : textures) texture = UNKNOWN;
+	for (GLint &value : viewport) value = -1;
+	for (float &value : clearColor) value = NAN;
+	uniforms.clear();
+}
+
+//---
+
+void Device::UseProgram(GLuint program_)
+{
+	if (!Check(program == program_)) return;
+	glUseProgram(program_);
+	program = program_;
+}
+
+//---
+
+void Device::BindTextureUnit(GLuint unit, GLuint texture)
+{
+	const bool shadowed = (unit < GLuint(MAX_TEXTURE_UNITS));
+	if (!Check(shadowed && textures[unit] == texture)) return;
+	glBindTextureUnit(unit, texture);
+	if (shadowed) textures[unit] = texture;
+}
+
+//---
+
+void Device::BindVertexArray(GLuint vertexArray_)
+{
+	if (!Check(vertexArray == vertexArray_)) return;
+	glBindVertexArray(vertexArray_);
+	vertexArray = vertexArray_;
+}
+
+//---
+
+void Device::SetBlend(bool enabled)
+{
+	if (!Check(blend == GLuint(enabled))) return;
+	if (enabled) glEnable(GL_BLEND);
+	else glDisable(GL_BLEND);
+	blend = GLuint(enabled);
+}
+
+//---
+
+void Device::BlendFunc(GLenum sourceFactor, GLenum destinationFactor)
+{
+	if (!Check(blendSource == sourceFactor && blendDestination == destinationFactor)) return;
+	glBlendFunc(sourceFactor, destinationFactor);
+	blendSource = sourceFactor;
+	blendDestination = destinationFactor;
+}
+
+//---
+
+void Device::Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	if (!Check(viewport[0] == x && viewport[1] == y && viewport[2] == width && viewport[3] == height)) return;
+	glViewport(x, y, width, height);
+	viewport[0] = x;
+	viewport[1] = y;
+	viewport[2] = width;
+	viewport[3] = height;
+}
+
+//---
+
+void Device::ClearColor(float red, float green, float blue, float alpha)
+{
+	if (!Check(clearColor[0] == red && clearColor[1] == green && clearColor[2] == blue && clearColor[3] == alpha)) return;
+	glClearColor(red, green, blue, alpha);
+	clearColor[0] = red;
+	clearColor[1] = green;
+	clearColor[2] = blue;
+	clearColor[3] = alpha;
+}
+
+//---
+
+Device::UniformValue& Device::FindUniform(GLuint program_, GLint location)
+{
+	// a handful of uniforms in all; a linear search beats hashing
+	for (UniformValue &uniform : uniforms) {
+		if (uniform.program == program_ && uniform.location == location) return uniform;
+	}
+	uniforms.push_back(UniformValue{ program_, location, { NAN, NAN } });
+	return uniforms.back();
+}
+
+//---
+
+void Device::ProgramUniform1f(GLuint program_, GLint location, float x)
+{
+	UniformValue &uniform = FindUniform(program_, location);
+	if (!Check(uniform.value[0] == x)) return;
+	glProgramUniform1f(program_, location, x);
+	uniform.value[0] = x;
+}
+
+//---
+
+void Device::ProgramUniform2f(GLuint program_, GLint location, float x, float y)
+{
+	UniformValue &uniform = FindUniform(program_, location);
+	if (!Check(uniform.value[0] == x && uniform.value[1] == y)) return;
+	glProgramUniform2f(program_, location, x, y);
+	uniform.value[0] = x;
+	uniform.value[1] = y;
+}
+
+//---
+
+void Device::Clear(GLbitfield mask)
+{
+	frame.issued++;
+	glClear(mask);
+}
+
+//---
+
+void Device::NamedBufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data)
+{
+	frame.issued++;
+	glNamedBufferSubData(buffer, offset, size, data);
+}
+
+//---
+
+void Device::DrawArraysInstancedBaseInstance(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount, GLuint baseInstance)
+{
+	frame.issued++;
+	glDrawArraysInstancedBaseInstance(mode, first, count, instanceCount, baseInstance);
+}
+
+} // namespace GL
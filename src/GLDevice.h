@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "GLWrapper.h"
+
+namespace GL {
+
+/**
+ * The render thread's view of the GL context: state changes go through here,
+ * using direct state access where GL has it, and each is checked against a
+ * shadow copy of the context's state, so that a bind or enable that would
+ * change nothing is never issued. Draws, clears and uploads always go
+ * through. Every call is counted, so the counters are the frame's GL calls
+ * for the code that draws through the device (the renderers, GameView).
+ * Code that changes the same state with raw GL calls (or deletes a bound
+ * object) must call Invalidate() afterwards.
+ * Requires a current GL 4.5 context for its whole lifetime.
+ */
+class Device
+{
+public:
+
+	static const int MAX_TEXTURE_UNITS = 8;
+
+	/// Calls made through the device.
+	struct Counters {
+		uint64_t issued = 0;		///< Passed on to GL (state changes, clears, uploads and draws).
+		uint64_t skipped = 0;		///< State changes dropped, as the state was already set.
+	};
+
+	/// With `shadowing` off, every call is issued (for comparisons).
+	explicit Device(bool shadowing = true);
+	Device(const Device&) = delete;
+
+	/// Starts counting a new frame (the counts so far become GetLastFrame()).
+	void BeginFrame();
+
+	const Counters& GetFrame() const { return frame; }
+	const Counters& GetLastFrame() const { return lastFrame; }
+	const Counters& GetTotal() const { return total; }
+
+	/// Calls so far, the current frame's included.
+	Counters GetRunningTotal() const { return Counters{ total.issued + frame.issued, total.skipped + frame.skipped }; }
+
+	bool IsShadowing() const { return shadowing; }
+	void SetShadowing(bool shadowing_) { shadowing = shadowing_; Invalidate(); }
+
+	/// Forgets the shadowed state; the next call of each kind is issued.
+	void Invalidate();
+
+	void UseProgram(GLuint program);
+	void BindTextureUnit(GLuint unit, GLuint texture);
+	void BindVertexArray(GLuint vertexArray);
+	void SetBlend(bool enabled);
+	void BlendFunc(GLenum sourceFactor, GLenum destinationFactor);
+	void Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+	void ClearColor(float red, float green, float blue, float alpha);
+
+	/// Uniforms are set with glProgramUniform*() (no need to bind the program first)
+	/// and remembered per program, so a value set in an earlier frame is not sent again.
+	void ProgramUniform1f(GLuint program, GLint location, float x);
+	void ProgramUniform2f(GLuint program, GLint location, float x, float y);
+
+	void Clear(GLbitfield mask);
+	void NamedBufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data);
+	void DrawArraysInstancedBaseInstance(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount, GLuint baseInstance);
+
+protected:
+
+	/// Remembered value of a uniform (up to 2 floats are used).
+	struct UniformValue {
+		GLuint program;
+		GLint location;
+		float value[2];
+	};
+
+	/// Counts a call; \return Whether to issue it (`unchanged` tells that the shadow state already matches).
+	bool Check(bool unchanged)
+	{
+		if (unchanged && shadowing) {
+			frame.skipped++;
+			return false;
+		}
+		frame.issued++;
+		return true;
+	}
+
+	/// Looks up the remembered value of a uniform, adding one (NaN, never matching) if there is none.
+	UniformValue& FindUniform(GLuint program, GLint location);
+
+	bool shadowing = true;
+	Counters frame, lastFrame, total;
+
+	// the shadow state; Invalidate() sets it to UNKNOWN (or NaN), which no call matches
+	static const GLuint UNKNOWN = ~GLuint(0);
+	GLuint program = UNKNOWN;
+	GLuint textures[MAX_TEXTURE_UNITS];
+	GLuint vertexArray = UNKNOWN;
+	GLuint blend = UNKNOWN;
+	GLenum blendSource = UNKNOWN, blendDestination = UNKNOWN;
+	GLint viewport[4];
+	float clearColor[4];
+	std::vector<UniformValue> uniforms;
+};
+
+} // namespace GL
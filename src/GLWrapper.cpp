@@ -0,0 +1,71 @@
+#include "GLWrapper.h"
+
+#include <vector>
+
+namespace GL {
+
+//---
+
+Program::Program(const char* vertexSource, const char* fragmentSource)
+{
+	GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, vertexSource);
+	GLuint fragmentShader = 0;
+	try {
+		fragmentShader = CompileShader(GL_FRAGMENT_SHADER, fragmentSource);
+	}
+	catch (...) {
+		glDeleteShader(vertexShader);
+		throw;
+	}
+
+	id = glCreateProgram();
+	glAttachShader(id, vertexShader);
+	glAttachShader(id, fragmentShader);
+	glLinkProgram(id);
+	glDeleteShader(vertexShader);	// only flagged for deletion while attached
+	glDeleteShader(fragmentShader);
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(id, GL_LINK_STATUS, &linked);
+	if (!linked) {
+		GLint logLength = 0;
+		glGetProgramiv(id, GL_INFO_LOG_LENGTH, &logLength);
+		std::vector<char> log(logLength + 1, '\0');
+		glGetProgramInfoLog(id, logLength, nullptr, log.data());
+		glDeleteProgram(id);
+		id = 0;
+		throw Error(std::string("GL::Program::Program(): linking failed: ") + log.data());
+	}
+}
+
+//---
+
+Program::~Program()
+{
+	if (id) {
+		glDeleteProgram(id);
+	}
+}
+
+//---
+
+GLuint Program::CompileShader(GLenum stage, const char* source)
+{
+	GLuint shader = glCreateShader(stage);
+	glShaderSource(shader, 1, &source, nullptr);
+	glCompileShader(shader);
+
+	GLint compiled = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if (!compiled) {
+		GLint logLength = 0;
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
+		std::vector<char> log(logLength + 1, '\0');
+		glGetShaderInfoLog(shader, logLength, nullptr, log.data());
+		glDeleteShader(shader);
+		throw Error(std::string("GL::Program::CompileShader(): compilation failed: ") + log.data());
+	}
+	return shader;
+}
+
+} // namespace GL
@@ -0,0 +1,50 @@
+#pragma once
+
+// Thin C++ helpers for OpenGL objects, in the spirit of SDLWrapper.h.
+// All functions expect a current GL 4.5 core context (see SDL::Window).
+
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES 1
+#endif
+#include "GL/gl.h"
+#include "GL/glext.h"
+
+#include <string>
+#include <stdexcept>
+
+namespace GL {
+
+/// Wraps GL errors that are not reasonable to return in-band (panic-grade).
+class Error : public std::runtime_error
+{
+public:
+
+	Error(const std::string &reason_) : std::runtime_error(reason_) {}
+};
+
+//---
+
+/// A linked GLSL program made of a vertex and a fragment shader.
+class Program
+{
+public:
+
+	/// Compiles and links the program. Throws GL::Error (with the info log) on failure.
+	Program(const char* vertexSource, const char* fragmentSource);
+	Program(const Program&) = delete;
+	~Program();
+
+	GLuint GetId() const { return id; }
+
+	/// Returns the location of a uniform, or -1 if the program does not use it.
+	GLint GetUniformLocation(const char* name) const { return glGetUniformLocation(id, name); }
+
+protected:
+
+	/// Compiles one stage; throws GL::Error on failure.
+	static GLuint CompileShader(GLenum stage, const char* source);
+
+	GLuint id = 0;
+};
+
+} // namespace GL
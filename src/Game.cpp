@@ -0,0 +1,156 @@
+#include "Game.h"
+#include "Profiler.h"
+
+#include <cstdlib>
+#include <initializer_list>
+
+namespace {
+
+/// Mixes a value into a hash (the splitmix64 finalizer).
+uint64_t Mix(uint64_t hash, uint64_t value)
+{
+	uint64_t x = hash ^ (value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2));
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+	return x ^ (x >> 31);
+}
+
+} // namespace
+
+//---
+
+Game::Game(uint64_t seed_, int colorCount)
+	: seed(seed_), random(seed_), board(colorCount)
+{
+	NewBoard();
+}
+
+//---
+
+void Game::Apply(const GameInput &input)
+{
+	int column, row;
+	switch (input.type) {
+	case GameInput::Type::kKey:
+		if (input.code == KEY_NEW_GAME) {
+			NewBoard();
+			score = 0;
+			moveCount = 0;
+		}
+		break;
+	case GameInput::Type::kMouseButton:
+		if (input.code == LEFT_BUTTON && phase == Phase::kIdle && CellAt(input.x, input.y, column, row)) {
+			Click(column, row);
+		}
+		break;
+	case GameInput::Type::kMouseMotion:
+		hovered = CellAt(input.x, input.y, column, row) ? column * Board::SIZE + row : -1;
+		break;
+	}
+}
+
+//---
+
+void Game::Tick()
+{
+	PROFILE_ZONE("Game::Tick");
+	tick++;
+	if (phase == Phase::kResolving && tick >= nextStepTick) {
+		Step();
+	}
+}
+
+//---
+
+uint64_t Game::GetStateHash() const
+{
+	uint64_t hash = board.GetHash();
+	for (uint64_t value : { random.GetState(), tick, nextStepTick, uint64_t(phase), uint64_t(score),
+		uint64_t(moveCount), uint64_t(chain), uint64_t(selected), uint64_t(hovered) }) {
+		hash = Mix(hash, value);
+	}
+	return hash;
+}
+
+//---
+
+bool Game::CellAt(int x, int y, int &column, int &row)
+{
+	if (x < BOARD_X || y < BOARD_Y) return false;
+	column = (x - BOARD_X) / CELL_SIZE;
+	row = Board::SIZE - 1 - (y - BOARD_Y) / CELL_SIZE;
+	return column < Board::SIZE && row >= 0;
+}
+
+//---
+
+void Game::NewBoard()
+{
+	// a board without runs, but with at least one valid swap
+	Board::Move moves[Board::MAX_MOVES];
+	do {
+		board.Fill(random);
+	} while (board.FindMoves(moves) == 0);
+
+	phase = Phase::kIdle;
+	selected = -1;
+	chain = 0;
+}
+
+//---
+
+void Game::Click(int column, int row)
+{
+	const int cell = column * Board::SIZE + row;
+	if (selected < 0) {
+		selected = cell;
+		return;
+	}
+
+	const int selectedColumn = selected / Board::SIZE, selectedRow = selected % Board::SIZE;
+	const bool adjacent = abs(column - selectedColumn) + abs(row - selectedRow) == 1;
+	if (!adjacent) {
+		selected = (cell == selected) ? -1 : cell;
+		return;
+	}
+	selected = -1;
+
+	// the move starts at the left (or lower) cell
+	const Board::Move move {
+		uint8_t(column < selectedColumn ? column : selectedColumn),
+		uint8_t(row < selectedRow ? row : selectedRow),
+		column == selectedColumn
+	};
+	board.Apply(move);
+	const Board::Mask touched = Board::Bit(move.column, move.row) | Board::Bit(move.GetColumn2(), move.GetRow2());
+	if (!(board.FindMatches() & touched)) {
+		board.Apply(move);		// not allowed, swap back
+		return;
+	}
+
+	moveCount++;
+	chain = 0;
+	phase = Phase::kResolving;
+	nextStepTick = tick + STEP_TICKS;
+}
+
+//---
+
+void Game::Step()
+{
+	const Board::Mask matches = board.FindMatches();
+	if (matches) {
+		chain++;
+		score += board.Remove(matches) * chain;
+		board.Collapse();
+		board.Refill(random);
+		nextStepTick = tick + STEP_TICKS;
+		return;
+	}
+
+	phase = Phase::kIdle;
+	Board::Move moves[Board::MAX_MOVES];
+	if (board.FindMoves(moves) == 0) {
+		NewBoard();		// stuck: deal a new board, keeping the score
+	}
+}
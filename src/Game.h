@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Board.h"
+
+/// One input to the game, as delivered by the EventLoop and recorded in replays.
+struct GameInput
+{
+	enum class Type : uint8_t {
+		kKey = 0,
+		kMouseButton = 1,
+		kMouseMotion = 2
+	};
+
+	Type type;
+	int32_t code = 0;	///< Key code (SDL_Keycode) or mouse button (SDL_BUTTON_*), unused for motion.
+	int32_t x = 0;		///< Mouse position in window pixels (buttons and motion).
+	int32_t y = 0;
+};
+
+//---
+
+/**
+ * The rules and state of a game, without any rendering or SDL. What happens
+ * follows only from the seed, the inputs and the ticks they come at, with
+ * integer arithmetic throughout, so a game replays bit-exactly (see Replay.h).
+ * Time advances by Tick(), TICK_RATE times per second.
+ *
+ * Click a gem, then a neighbouring one, to swap them; a swap must make a
+ * run of three. The runs then disappear one round every STEP_TICKS, and
+ * each gem counts as many points as the round of the cascade it falls in.
+ */
+class Game
+{
+public:
+
+	static const int TICK_RATE = 120;
+	static const int STEP_TICKS = 30;
+
+	// where the board is drawn, in window pixels, for hit testing (row 0 is the bottom one)
+	static const int BOARD_X = 320;
+	static const int BOARD_Y = 192;
+	static const int CELL_SIZE = 80;
+
+	static const int32_t KEY_NEW_GAME = 'n';	///< SDLK_n
+	static const int32_t LEFT_BUTTON = 1;		///< SDL_BUTTON_LEFT
+
+	enum class Phase {
+		kIdle,			///< Waiting for a swap.
+		kResolving		///< Clearing a cascade, one round every STEP_TICKS; inputs are ignored.
+	};
+
+	explicit Game(uint64_t seed, int colorCount = Board::DEFAULT_COLORS);
+
+	void Apply(const GameInput &input);
+	void Tick();
+
+	uint64_t GetSeed() const { return seed; }
+	int GetColorCount() const { return board.GetColorCount(); }
+	const Board& GetBoard() const { return board; }
+	Phase GetPhase() const { return phase; }
+	uint64_t GetTick() const { return tick; }
+	int GetScore() const { return score; }
+	int GetMoveCount() const { return moveCount; }
+
+	/// The cell clicked first (column * Board::SIZE + row), -1 if none.
+	int GetSelected() const { return selected; }
+
+	/// The cell under the mouse, -1 if none.
+	int GetHovered() const { return hovered; }
+
+	/// Hash of the whole state, to check that a replay came out the same.
+	uint64_t GetStateHash() const;
+
+	/// Finds the cell at a window position. \return False if the position is off the board.
+	static bool CellAt(int x, int y, int &column, int &row);
+
+protected:
+
+	void NewBoard();
+	void Click(int column, int row);
+
+	/// One round of the cascade.
+	void Step();
+
+	uint64_t seed;
+	Random random;
+	Board board;
+	Phase phase = Phase::kIdle;
+	uint64_t tick = 0;
+	uint64_t nextStepTick = 0;
+	int score = 0;
+	int moveCount = 0;
+	int chain = 0;		///< Rounds of the current cascade so far.
+	int selected = -1;
+	int hovered = -1;
+};
@@ -0,0 +1,92 @@
+#include "GameView.h"
+#include "GLDevice.h"
+#include "Game.h"
+#include "LoadFont.h"
+#include "TextRenderer.h"
+#include "SpriteBatch.h"
+#include "GemSprites.h"
+#include "GpuProfiler.h"
+
+#include <cstdio>
+#include <string_view>
+
+namespace GameView {
+
+const uint32_t kGemColors[Board::MAX_COLORS] = {
+	0xff3030e0, 0xff30d030, 0xffe06020, 0xff20d0e0, 0xffd040d0, 0xffe0e0e0, 0xff2090f0, 0xff808080
+};
+
+//---
+
+void Draw(GL::Device &device, const Game &game, const Font &font,
+	TextRenderer &textRenderer, SpriteBatch &sprites, int width, int height,
+	GpuProfiler* profiler, bool overlay)
+{
+	const Board &board = game.GetBoard();
+	const float cell = float(Game::CELL_SIZE);
+	auto cellCenter = [cell](int column, int row, float &x, float &y) {
+		x = float(Game::BOARD_X) + (float(column) + 0.5f) * cell;
+		y = float(Game::BOARD_Y) + (float(Board::SIZE - 1 - row) + 0.5f) * cell;
+	};
+
+	{
+		GpuProfiler::Scope pass(profiler, GpuProfiler::kClear);
+		device.Viewport(0, 0, width, height);
+		device.ClearColor(0.0f, 0.0f, 0.2f, 1.0f);
+		device.Clear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
+	}
+
+	sprites.Begin(width, height);
+	const int selected = game.GetSelected();
+	if (selected >= 0) {
+		GpuProfiler::Scope pass(profiler, GpuProfiler::kParticles);
+		const int column = selected / Board::SIZE, row = selected % Board::SIZE;
+		const int color = board.GetColor(column, row);
+		if (color >= 0) {
+			float x, y;
+			cellCenter(column, row, x, y);
+			sprites.Add(x, y, cell * 1.2f, cell * 1.2f, GemSprites::kSpark, kGemColors[color]);
+			sprites.Flush();
+		}
+	}
+
+	{
+		GpuProfiler::Scope pass(profiler, GpuProfiler::kBoard);
+		for (int column = 0; column < Board::SIZE; column++) {
+			for (int row = 0; row < Board::SIZE; row++) {
+				float x, y;
+				cellCenter(column, row, x, y);
+				sprites.Add(x, y, cell, cell, GemSprites::kCell, 0x40ffc080);
+
+				const int color = board.GetColor(column, row);
+				if (color < 0) continue;
+				if (selected == column * Board::SIZE + row) {
+					const float angle = float(game.GetTick() % Game::TICK_RATE) * (6.2831853f / Game::TICK_RATE);
+					sprites.Add(x, y, cell, cell, GemSprites::kSelection, 0xffffffff, angle);
+				}
+				sprites.Add(x, y, cell * 0.8f, cell * 0.8f, GemSprites::kGem + color, kGemColors[color]);
+			}
+		}
+		sprites.Flush();
+	}
+
+	textRenderer.Begin(width, height);
+	{
+		GpuProfiler::Scope pass(profiler, GpuProfiler::kText);
+		char score[32];
+		const int length = snprintf(score, sizeof(score), "Score: %d", game.GetScore());
+		textRenderer.AddText(std::u8string_view(reinterpret_cast<const char8_t*>(score), size_t(length)),
+			float(Game::BOARD_X), font.GetAscent() + 16.0f);
+		textRenderer.Flush();
+	}
+
+	if (profiler) {
+		GpuProfiler::Scope pass(profiler, GpuProfiler::kPost);
+		if (overlay) {
+			profiler->AddOverlay(textRenderer, font, 16.0f, float(height) - 6.0f * font.GetLineHeight() - 16.0f, 0xff80ff80);
+			textRenderer.Flush();
+		}
+	}
+}
+
+} // namespace GameView
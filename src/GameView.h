@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Board.h"
+
+namespace GL { class Device; }
+class Game;
+class Font;
+class TextRenderer;
+class SpriteBatch;
+class GpuProfiler;
+
+/**
+ * Drawing of the game screen, shared by the game and the benchmarks
+ * (so that they measure the scene that is actually shown).
+ */
+namespace GameView {
+
+/// Gem colours (RGBA8, R in the lowest byte), one per Board colour.
+extern const uint32_t kGemColors[Board::MAX_COLORS];
+
+/**
+ * Draws the board (the glow of the selected gem, then the cells, gems and
+ * the selection ring with one draw call) and the score into a viewport of
+ * the given size. With a profiler, each pass is timed, and `overlay` adds
+ * its statistics in the post pass.
+ */
+void Draw(GL::Device &device, const Game &game, const Font &font,
+	TextRenderer &textRenderer, SpriteBatch &sprites, int width, int height,
+	GpuProfiler* profiler = nullptr, bool overlay = false);
+
+} // namespace GameView
@@ -0,0 +1,118 @@
+#include "GemSprites.h"
+#include "SpriteBatch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace GemSprites {
+
+namespace {
+
+const float kPi = 3.14159265f;
+
+/// Signed distance (negative inside) to a regular polygon with the given circumradius;
+/// `angle` is the direction of the first edge's normal.
+float PolygonDistance(float x, float y, int sides, float radius, float angle)
+{
+	float distance = -1e9f;
+	for (int i = 0; i < sides; i++) {
+		const float normal = angle + 2.0f * kPi * float(i) / float(sides);
+		distance = std::max(distance, x * std::cos(normal) + y * std::sin(normal));
+	}
+	return distance - radius * std::cos(kPi / float(sides));
+}
+
+//---
+
+/// Signed distance to the outline of gem shape `shape` (0 to Board::MAX_COLORS - 1).
+float GemDistance(int shape, float x, float y)
+{
+	switch (shape) {
+	case 0: return std::hypot(x, y) - 0.8f;
+	case 1: return PolygonDistance(x, y, 4, 0.9f, kPi / 4.0f);		// diamond
+	case 2: return PolygonDistance(x, y, 4, 0.95f, 0.0f);			// square
+	case 3: return PolygonDistance(x, y, 3, 0.9f, kPi / 2.0f);		// triangle, pointing up
+	case 4: return PolygonDistance(x, y, 6, 0.85f, 0.0f);			// hexagon
+	case 5: {														// five-pointed star
+		const float angle = std::atan2(y, x) + kPi / 2.0f;
+		return std::hypot(x, y) - 0.9f * (0.7f + 0.3f * std::cos(5.0f * angle));
+	}
+	case 6: return PolygonDistance(x, y, 8, 0.85f, kPi / 8.0f);		// octagon
+	default: return PolygonDistance(x, y, 5, 0.85f, kPi / 2.0f);	// pentagon
+	}
+}
+
+//---
+
+uint32_t Pixel(float brightness, float alpha)
+{
+	const uint32_t gray = uint32_t(std::clamp(brightness, 0.0f, 1.0f) * 255.0f + 0.5f);
+	const uint32_t a = uint32_t(std::clamp(alpha, 0.0f, 1.0f) * 255.0f + 0.5f);
+	return gray | (gray << 8) | (gray << 16) | (a << 24);
+}
+
+} // namespace
+
+//---
+
+void Rasterize(int layer, uint32_t* pixels)
+{
+	const float pixelSize = 2.0f / float(SIZE);
+	for (int row = 0; row < SIZE; row++) {
+		for (int column = 0; column < SIZE; column++) {
+
+			// the pixel's center, from -1 to 1 (y down)
+			const float x = (float(column) + 0.5f) * pixelSize - 1.0f;
+			const float y = (float(row) + 0.5f) * pixelSize - 1.0f;
+			const float radius = std::hypot(x, y);
+
+			float brightness = 1.0f, alpha = 0.0f;
+			if (layer < kCell) {
+
+				// lit from the upper left, with a highlight and a darker rim
+				const float distance = GemDistance(layer - kGem, x, y);
+				alpha = 0.5f - distance / pixelSize;
+				brightness = std::clamp(1.05f - 0.45f * std::hypot(x + 0.35f, y + 0.4f), 0.45f, 1.0f);
+				brightness *= 0.7f + 0.3f * std::clamp(-distance * 5.0f, 0.0f, 1.0f);
+				if (std::hypot(x + 0.3f, y + 0.35f) < 0.16f) brightness = 1.0f;
+			}
+			else if (layer == kCell) {
+
+				// a faint rounded square with a brighter frame
+				const float corner = 0.2f;
+				const float qx = std::fabs(x) - (0.94f - corner), qy = std::fabs(y) - (0.94f - corner);
+				const float box = std::hypot(std::max(qx, 0.0f), std::max(qy, 0.0f))
+					+ std::min(std::max(qx, qy), 0.0f) - corner;
+				const float inside = std::clamp(0.5f - box / pixelSize, 0.0f, 1.0f);
+				const float frame = std::clamp(0.5f - (std::fabs(box) - 0.03f) / pixelSize, 0.0f, 1.0f);
+				alpha = std::max(0.2f * inside, frame);
+			}
+			else if (layer == kSelection) {
+
+				// a ring with four gaps, so that its rotation shows
+				const float ring = std::clamp(0.5f - (std::fabs(radius - 0.88f) - 0.06f) / pixelSize, 0.0f, 1.0f);
+				const float gaps = std::clamp((std::cos(4.0f * std::atan2(y, x)) + 0.6f) * 4.0f, 0.0f, 1.0f);
+				alpha = ring * gaps;
+			}
+			else if (layer == kSpark) {
+				const float falloff = std::max(1.0f - radius, 0.0f);
+				alpha = falloff * falloff;
+			}
+			pixels[row * SIZE + column] = Pixel(brightness, alpha);
+		}
+	}
+}
+
+//---
+
+void Load(SpriteBatch &batch)
+{
+	std::vector<uint32_t> pixels(size_t(SIZE) * SIZE);
+	for (int layer = 0; layer < LAYER_COUNT; layer++) {
+		Rasterize(layer, pixels.data());
+		batch.SetLayer(layer, pixels.data());
+	}
+}
+
+} // namespace GemSprites
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Board.h"
+
+class SpriteBatch;
+
+/**
+ * The game's sprite art, drawn procedurally (white, to be tinted): a gem
+ * shape per Board colour, so that colours can be told apart by shape too,
+ * and the board's cells and effects.
+ */
+namespace GemSprites {
+
+/// Layers of the sprite array.
+enum Layer {
+	kGem = 0,					///< First of Board::MAX_COLORS gem shapes.
+	kCell = Board::MAX_COLORS,	///< Rounded frame of a board cell.
+	kSelection,					///< Ring around the selected gem.
+	kSpark,						///< Soft glow, for effects.
+	LAYER_COUNT
+};
+
+/// Side of a layer in pixels.
+static const int SIZE = 64;
+
+/// Draws a layer into SIZE * SIZE RGBA8 pixels (straight alpha).
+void Rasterize(int layer, uint32_t* pixels);
+
+/// Draws all the layers into a batch made with SIZE and LAYER_COUNT.
+void Load(SpriteBatch &batch);
+
+} // namespace GemSprites
@@ -0,0 +1,309 @@
+#include "GlyphCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+GlyphCache::GlyphCache(const MappedFile &fontFile, float fontSize, int surfaceWidth, int surfaceHeight)
+{
+	fontSurface = std::make_unique<SDL::Surface>(surfaceWidth, surfaceHeight, 8, SDL_PIXELFORMAT_INDEX8);
+	if (!fontSurface->Ok()) {
+		SDL_SetError("Could not create surface: %s", SDL_GetError());
+		return;
+	}
+	fontSurface->SetGrayscalePalette();
+	ClearRect(0, 0, surfaceWidth, surfaceHeight);
+
+	if (!stbtt_InitFont(&fontInfo, fontFile.GetData(), 0)) {
+		SDL_SetError("stbtt_InitFont() failed");
+		return;
+	}
+	scale = stbtt_ScaleForPixelHeight(&fontInfo, fontSize);
+
+	// each glyph's space starts with its padding, so the right and bottom edges need their own
+	atlasWidth = surfaceWidth - GLYPH_PADDING;
+	atlasHeight = surfaceHeight - GLYPH_PADDING;
+
+	ok = true;
+}
+
+GlyphCache::~GlyphCache()
+{
+	ok = false;
+}
+
+bool GlyphCache::GetGlyphGeometry(char32_t codepoint, stbtt_packedchar &glyphGeometry)
+{
+	auto found = index.find(codepoint);
+	if (found != index.end()) {
+		Entry &entry = entries[found->second];
+		entry.lastUsedFrame = frame;
+		if (mostRecent != found->second) {
+			Unlink(found->second);
+			LinkFront(found->second);
+		}
+		glyphGeometry = entry.geometry;
+		return true;
+	}
+
+	missCount++;
+
+	int entryIndex;
+	if (!freeEntries.empty()) {
+		entryIndex = freeEntries.back();
+		freeEntries.pop_back();
+	}
+	else {
+		entryIndex = int(entries.size());
+		entries.emplace_back();
+	}
+
+	Entry &entry = entries[entryIndex];
+	entry = Entry();
+	entry.codepoint = codepoint;
+	entry.lastUsedFrame = frame;
+	if (!Rasterize(codepoint, entries[entryIndex])) {
+		freeEntries.push_back(entryIndex);
+		return false;
+	}
+
+	index.emplace(codepoint, entryIndex);
+	LinkFront(entryIndex);
+	glyphGeometry = entries[entryIndex].geometry;
+	return true;
+}
+
+bool GlyphCache::Rasterize(char32_t codepoint, Entry &entry)
+{
+	const int glyph = stbtt_FindGlyphIndex(&fontInfo, int(codepoint));
+
+	int advance, leftSideBearing, x0, y0, x1, y1;
+	stbtt_GetGlyphHMetrics(&fontInfo, glyph, &advance, &leftSideBearing);
+	stbtt_GetGlyphBitmapBox(&fontInfo, glyph, scale, scale, &x0, &y0, &x1, &y1);
+
+	stbtt_packedchar &geometry = entry.geometry;
+	geometry.xadvance = scale * advance;
+	geometry.xoff = float(x0);
+	geometry.yoff = float(y0);
+	geometry.xoff2 = float(x1);
+	geometry.yoff2 = float(y1);
+
+	const int w = x1 - x0, h = y1 - y0;
+	if (w <= 0 || h <= 0) {
+
+		// nothing to draw (e.g. a space), no atlas space needed
+		geometry.x0 = geometry.y0 = geometry.x1 = geometry.y1 = 0;
+		return true;
+	}
+
+	// freed space is kept cleared, so only the glyph and its padding have to be uploaded
+	int x, y;
+	const uint64_t evictedBefore = evictionCount;
+	bool placed;
+	while (!(placed = Allocate(w + GLYPH_PADDING, h + GLYPH_PADDING, x, y)) && EvictLeastRecent()) {}
+	if (evictionCount != evictedBefore) generation++;
+	if (!placed) return false;
+
+	x += GLYPH_PADDING;
+	y += GLYPH_PADDING;
+
+	const int pitch = fontSurface->GetPitch();
+	uint8_t* pixels = static_cast<uint8_t*>(fontSurface->GetPixels());
+	stbtt_MakeGlyphBitmap(&fontInfo, pixels + x + y * pitch, w, h, pitch, scale, scale, glyph);
+
+	geometry.x0 = x;
+	geometry.y0 = y;
+	geometry.x1 = x + w;
+	geometry.y1 = y + h;
+	AddDirtyRect(SDL_Rect{ x - GLYPH_PADDING, y - GLYPH_PADDING, w + 2 * GLYPH_PADDING, h + 2 * GLYPH_PADDING });
+	return true;
+}
+
+bool GlyphCache::Allocate(int width, int height, int &x, int &y)
+{
+	// the lowest shelf the glyph fits in without wasting more than a third of it
+	Shelf* best = nullptr;
+	for (Shelf &shelf : shelves) {
+		if (shelf.height < height || shelf.height > height + height / 2 || IsEmpty(shelf)) continue;
+		if (best && best->height <= shelf.height) continue;
+		for (const Span &span : shelf.freeSpans) {
+			if (span.width >= width) {
+				best = &shelf;
+				break;
+			}
+		}
+	}
+	if (best && TakeSpan(*best, width, x)) {
+		y = best->y;
+		return true;
+	}
+
+	// then an empty shelf, cut down to the glyph's height
+	for (size_t i = 0; i < shelves.size(); i++) {
+		if (shelves[i].height < height || !IsEmpty(shelves[i])) continue;
+		if (shelves[i].height > height) {
+			Shelf rest;
+			rest.y = shelves[i].y + height;
+			rest.height = shelves[i].height - height;
+			rest.freeSpans.push_back(Span{ 0, atlasWidth });
+			shelves[i].height = height;
+			shelves.insert(shelves.begin() + i + 1, std::move(rest));
+		}
+		TakeSpan(shelves[i], width, x);
+		y = shelves[i].y;
+		return true;
+	}
+
+	// then a new shelf
+	if (width <= atlasWidth && shelvesEnd + height <= atlasHeight) {
+		Shelf shelf;
+		shelf.y = shelvesEnd;
+		shelf.height = height;
+		shelf.freeSpans.push_back(Span{ 0, atlasWidth });
+		shelves.push_back(std::move(shelf));
+		shelvesEnd += height;
+		TakeSpan(shelves.back(), width, x);
+		y = shelves.back().y;
+		return true;
+	}
+
+	// and last, any shelf with room, however tall
+	for (Shelf &shelf : shelves) {
+		if (shelf.height >= height && TakeSpan(shelf, width, x)) {
+			y = shelf.y;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool GlyphCache::TakeSpan(Shelf &shelf, int width, int &x)
+{
+	for (size_t i = 0; i < shelf.freeSpans.size(); i++) {
+		Span &span = shelf.freeSpans[i];
+		if (span.width < width) continue;
+		x = span.x;
+		span.x += width;
+		span.width -= width;
+		if (span.width == 0) {
+			shelf.freeSpans.erase(shelf.freeSpans.begin() + i);
+		}
+		return true;
+	}
+	return false;
+}
+
+void GlyphCache::Free(int x, int y, int width)
+{
+	auto shelf = std::lower_bound(shelves.begin(), shelves.end(), y,
+		[](const Shelf &s, int shelfY) { return s.y < shelfY; });
+	if (shelf == shelves.end() || shelf->y != y) return;
+
+	// put the span back, joined with the free spans it touches
+	std::vector<Span> &spans = shelf->freeSpans;
+	auto next = std::lower_bound(spans.begin(), spans.end(), x,
+		[](const Span &s, int spanX) { return s.x < spanX; });
+	if (next != spans.begin() && (next - 1)->x + (next - 1)->width == x) {
+		auto prev = next - 1;
+		prev->width += width;
+		if (next != spans.end() && prev->x + prev->width == next->x) {
+			prev->width += next->width;
+			spans.erase(next);
+		}
+	}
+	else if (next != spans.end() && x + width == next->x) {
+		next->x = x;
+		next->width += width;
+	}
+	else {
+		spans.insert(next, Span{ x, width });
+	}
+	if (!IsEmpty(*shelf)) return;
+
+	// an empty shelf is joined with the empty shelves around it, so that taller glyphs fit
+	size_t i = size_t(shelf - shelves.begin());
+	if (i + 1 < shelves.size() && IsEmpty(shelves[i + 1])) {
+		shelves[i].height += shelves[i + 1].height;
+		shelves.erase(shelves.begin() + i + 1);
+	}
+	if (i > 0 && IsEmpty(shelves[i - 1])) {
+		shelves[i - 1].height += shelves[i].height;
+		shelves.erase(shelves.begin() + i);
+		i--;
+	}
+	if (i + 1 == shelves.size()) {
+		shelvesEnd = shelves[i].y;
+		shelves.pop_back();
+	}
+}
+
+bool GlyphCache::EvictLeastRecent()
+{
+	// entries are ordered by use, so if this one was used in the current frame, all were
+	const int victim = leastRecent;
+	if (victim == kNone || entries[victim].lastUsedFrame == frame) return false;
+
+	Entry &entry = entries[victim];
+	if (HasPixels(entry)) {
+		const stbtt_packedchar &geometry = entry.geometry;
+		const int w = geometry.x1 - geometry.x0, h = geometry.y1 - geometry.y0;
+		ClearRect(geometry.x0, geometry.y0, w, h);
+		Free(geometry.x0 - GLYPH_PADDING, geometry.y0 - GLYPH_PADDING, w + GLYPH_PADDING);
+	}
+	Unlink(victim);
+	index.erase(entry.codepoint);
+	freeEntries.push_back(victim);
+	evictionCount++;
+	return true;
+}
+
+void GlyphCache::ClearRect(int x, int y, int w, int h)
+{
+	const int pitch = fontSurface->GetPitch();
+	uint8_t* pixels = static_cast<uint8_t*>(fontSurface->GetPixels());
+	for (int row = y; row < y + h; row++) {
+		memset(pixels + x + row * pitch, 0, w);
+	}
+}
+
+void GlyphCache::AddDirtyRect(const SDL_Rect &rect)
+{
+	if (dirtyRects.size() < MAX_DIRTY_RECTS) {
+		dirtyRects.push_back(rect);
+		return;
+	}
+
+	// too many small uploads; merge everything into the bounding box
+	int x0 = rect.x, y0 = rect.y, x1 = rect.x + rect.w, y1 = rect.y + rect.h;
+	for (const SDL_Rect &r : dirtyRects) {
+		x0 = std::min(x0, r.x);
+		y0 = std::min(y0, r.y);
+		x1 = std::max(x1, r.x + r.w);
+		y1 = std::max(y1, r.y + r.h);
+	}
+	dirtyRects.clear();
+	dirtyRects.push_back(SDL_Rect{ x0, y0, x1 - x0, y1 - y0 });
+}
+
+void GlyphCache::LinkFront(int entryIndex)
+{
+	Entry &entry = entries[entryIndex];
+	entry.prev = kNone;
+	entry.next = mostRecent;
+	if (mostRecent != kNone) {
+		entries[mostRecent].prev = entryIndex;
+	}
+	mostRecent = entryIndex;
+	if (leastRecent == kNone) {
+		leastRecent = entryIndex;
+	}
+}
+
+void GlyphCache::Unlink(int entryIndex)
+{
+	Entry &entry = entries[entryIndex];
+	if (entry.prev != kNone) entries[entry.prev].next = entry.next;
+	else mostRecent = entry.next;
+	if (entry.next != kNone) entries[entry.next].prev = entry.prev;
+	else leastRecent = entry.prev;
+	entry.prev = entry.next = kNone;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+#include "SDLWrapper.h"
+#include "MapFile.h"
+
+#include "stb_truetype.h"
+
+/**
+ * Glyph atlas covering the whole Unicode range.
+ * Unlike Font, which rasterizes a fixed range up front, glyphs are rasterized
+ * on first use into free atlas space, in shelves (rows of glyphs of about the
+ * same height). When the atlas is full, the least recently used glyphs are
+ * evicted one by one until the new glyph fits in the space they leave; the
+ * other glyphs never move. The glyphs written to the atlas are reported as
+ * dirty rectangles, so that the GPU copy of the atlas can be updated incrementally.
+ */
+class GlyphCache {
+public:
+
+	static const int DEFAULT_SURFACE_WIDTH = 1024;
+	static const int DEFAULT_SURFACE_HEIGHT = 1024;
+
+	/// Empty pixels kept around each glyph (prevents bleeding when sampling).
+	static const int GLYPH_PADDING = 1;
+
+	/// Beyond this many dirty rectangles, they are merged into their bounding box.
+	static const size_t MAX_DIRTY_RECTS = 64;
+
+	GlyphCache(const MappedFile &fontFile, float fontSize,
+		int surfaceWidth = DEFAULT_SURFACE_WIDTH, int surfaceHeight = DEFAULT_SURFACE_HEIGHT);
+	GlyphCache(const GlyphCache&) = delete;
+	~GlyphCache();
+	bool Ok() const { return ok; }
+
+	/// Starts a new frame. Glyphs used during the current frame are never evicted.
+	void BeginFrame() { frame++; }
+
+	/// Incremented whenever glyphs are evicted; the geometry of a glyph obtained
+	/// under an older generation may no longer be valid (its space may hold another glyph).
+	uint64_t GetGeneration() const { return generation; }
+
+	/**
+	 * Returns the geometry of the glyph (in the format of Font::GetGlyphGeometry()),
+	 * rasterizing it if it is not in the atlas yet.
+	 * \return False if the glyph does not fit even after evicting everything
+	 * not used in the current frame.
+	 */
+	bool GetGlyphGeometry(char32_t codepoint, stbtt_packedchar &glyphGeometry);
+
+	/// Returns the internal surface that holds the glyphs.
+	SDL::Surface& GetSurface() { return *(fontSurface.get()); }
+
+	/// Returns the regions of the surface changed since the last ClearDirtyRects().
+	const std::vector<SDL_Rect>& GetDirtyRects() const { return dirtyRects; }
+	void ClearDirtyRects() { dirtyRects.clear(); }
+
+	size_t GetGlyphCount() const { return index.size(); }
+	uint64_t GetMissCount() const { return missCount; }
+	uint64_t GetEvictionCount() const { return evictionCount; }
+
+private:
+
+	static const int kNone = -1;
+
+	struct Entry {
+		char32_t codepoint = 0;
+		stbtt_packedchar geometry = {};
+		uint64_t lastUsedFrame = 0;
+		int prev = kNone;		///< Towards the most recently used entry.
+		int next = kNone;		///< Towards the least recently used entry.
+	};
+
+	struct Span {
+		int x;
+		int width;
+	};
+
+	/// A row of the atlas; glyphs of up to its height are placed side by side in it.
+	struct Shelf {
+		int y = 0;
+		int height = 0;
+		std::vector<Span> freeSpans;	///< Sorted by x, never touching each other.
+	};
+
+	bool Rasterize(char32_t codepoint, Entry &entry);
+	bool Allocate(int width, int height, int &x, int &y);
+	bool TakeSpan(Shelf &shelf, int width, int &x);
+	void Free(int x, int y, int width);
+	bool IsEmpty(const Shelf &shelf) const { return shelf.freeSpans.size() == 1 && shelf.freeSpans[0].width == atlasWidth; }
+	bool EvictLeastRecent();
+	void ClearRect(int x, int y, int w, int h);
+	void AddDirtyRect(const SDL_Rect &rect);
+	void LinkFront(int entryIndex);
+	void Unlink(int entryIndex);
+	bool HasPixels(const Entry &entry) const { return entry.geometry.x1 > entry.geometry.x0; }
+
+	bool ok = false;
+	float scale = 0.0f;
+	uint64_t frame = 1;
+	uint64_t generation = 0;
+	uint64_t missCount = 0;
+	uint64_t evictionCount = 0;
+	std::unique_ptr<SDL::Surface> fontSurface = nullptr;
+	stbtt_fontinfo fontInfo = { 0 };
+
+	/// Sorted by y, one above the other from the top of the atlas; never ends with an empty shelf.
+	std::vector<Shelf> shelves;
+	int shelvesEnd = 0;
+	int atlasWidth = 0;
+	int atlasHeight = 0;
+
+	/// Codepoint -> index into entries.
+	std::unordered_map<char32_t, int> index;
+	std::vector<Entry> entries;
+	std::vector<int> freeEntries;
+	int mostRecent = kNone;
+	int leastRecent = kNone;
+
+	std::vector<SDL_Rect> dirtyRects;
+};
@@ -0,0 +1,212 @@
+#include "GpuProfiler.h"
+#include "LoadFont.h"
+#include "TextRenderer.h"
+
+#include "SDL.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string_view>
+
+namespace {
+
+const char* const kPassNames[GpuProfiler::PASS_COUNT] = { "clear", "board", "particles", "text", "post" };
+
+} // namespace
+
+//---
+
+GpuProfiler::GpuProfiler()
+{
+	GLint counterBits = 0;
+	glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &counterBits);
+	supported = (counterBits > 0);
+	if (!supported) return;
+
+	glCreateQueries(GL_TIMESTAMP, BUFFERED_FRAMES * PASS_COUNT * 2, &queries[0][0][0]);
+	history.reserve(HISTORY_FRAMES);
+}
+
+//---
+
+GpuProfiler::~GpuProfiler()
+{
+	if (supported) {
+		glDeleteQueries(BUFFERED_FRAMES * PASS_COUNT * 2, &queries[0][0][0]);
+	}
+}
+
+//---
+
+const char* GpuProfiler::GetPassName(Pass pass)
+{
+	return (pass >= 0 && pass < PASS_COUNT) ? kPassNames[pass] : "?";
+}
+
+//---
+
+void GpuProfiler::BeginFrame()
+{
+	if (!supported) return;
+
+	set = (set + 1) % BUFFERED_FRAMES;
+	if (recorded[set]) {
+		FrameTimes times;
+		if (Collect(set, times)) {
+			AddFrame(times);
+		}
+		else {
+			lateFrames++;
+		}
+	}
+	recorded[set] = 0;
+}
+
+//---
+
+void GpuProfiler::BeginPass(Pass pass)
+{
+	if (!supported) return;
+	glQueryCounter(queries[set][pass][0], GL_TIMESTAMP);
+}
+
+//---
+
+void GpuProfiler::EndPass(Pass pass)
+{
+	if (!supported) return;
+	glQueryCounter(queries[set][pass][1], GL_TIMESTAMP);
+	recorded[set] |= (1u << pass);
+}
+
+//---
+
+bool GpuProfiler::Collect(int set_, FrameTimes &times)
+{
+	// a pass's end is written after its start, so the ends tell
+	for (int pass = 0; pass < PASS_COUNT; pass++) {
+		if (!(recorded[set_] & (1u << pass))) continue;
+		GLint available = GL_FALSE;
+		glGetQueryObjectiv(queries[set_][pass][1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) return false;
+	}
+
+	for (int pass = 0; pass < PASS_COUNT; pass++) {
+		times[pass] = NAN;
+		if (!(recorded[set_] & (1u << pass))) continue;
+		GLuint64 start = 0, end = 0;
+		glGetQueryObjectui64v(queries[set_][pass][0], GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(queries[set_][pass][1], GL_QUERY_RESULT, &end);
+		times[pass] = (end > start) ? float(double(end - start) * 1e-6) : 0.0f;
+	}
+	return true;
+}
+
+//---
+
+void GpuProfiler::AddFrame(const FrameTimes &times)
+{
+	window[measuredFrames % WINDOW_FRAMES] = times;
+	if (history.size() < size_t(HISTORY_FRAMES)) {
+		history.push_back(times);
+	}
+	else {
+		history[measuredFrames % HISTORY_FRAMES] = times;
+	}
+	measuredFrames++;
+
+	// a pass that did not run in a frame (e.g. the particles with no gem selected) has no sample there
+	const int count = int(std::min<uint64_t>(measuredFrames, WINDOW_FRAMES));
+	for (int pass = 0; pass < PASS_COUNT; pass++) {
+		PassStats &passStats = stats[pass];
+		if (!std::isnan(times[pass])) passStats.lastMs = times[pass];
+		passStats.samples = 0;
+		passStats.averageMs = passStats.minMs = passStats.maxMs = 0.0f;
+		float sum = 0.0f;
+		for (int i = 0; i < count; i++) {
+			const float ms = window[i][pass];
+			if (std::isnan(ms)) continue;
+			passStats.minMs = passStats.samples ? std::min(passStats.minMs, ms) : ms;
+			passStats.maxMs = passStats.samples ? std::max(passStats.maxMs, ms) : ms;
+			sum += ms;
+			passStats.samples++;
+		}
+		if (passStats.samples) passStats.averageMs = sum / float(passStats.samples);
+	}
+
+	float frameSum = 0.0f;
+	for (int i = 0; i < count; i++) {
+		for (float ms : window[i]) {
+			if (!std::isnan(ms)) frameSum += ms;
+		}
+	}
+	averageFrameMs = frameSum / float(count);
+}
+
+//---
+
+void GpuProfiler::AddOverlay(TextRenderer &textRenderer, const Font &font, float x, float y, uint32_t color) const
+{
+	char line[80];
+	auto addLine = [&](int length) {
+		y += font.GetAscent();
+		textRenderer.AddText(std::u8string_view(reinterpret_cast<const char8_t*>(line), size_t(std::max(length, 0))), x, y, color);
+		y += font.GetLineHeight() - font.GetAscent();
+	};
+
+	if (!supported) {
+		addLine(snprintf(line, sizeof(line), "GPU: no timer queries"));
+		return;
+	}
+	for (int pass = 0; pass < PASS_COUNT; pass++) {
+		const PassStats &passStats = stats[pass];
+		if (passStats.samples) {
+			addLine(snprintf(line, sizeof(line), "%-9s %6.3f ms (max %.3f)", kPassNames[pass], passStats.averageMs, passStats.maxMs));
+		}
+		else {
+			addLine(snprintf(line, sizeof(line), "%-9s      -", kPassNames[pass]));
+		}
+	}
+	addLine(snprintf(line, sizeof(line), "GPU frame %6.3f ms", GetAverageFrameMs()));
+}
+
+//---
+
+bool GpuProfiler::WriteCsv(const char* fileName) const
+{
+	FILE* f = fopen(fileName, "w");
+	if (!f) {
+		SDL_SetError("GpuProfiler::WriteCsv(): could not create %s", fileName);
+		return false;
+	}
+
+	bool written = (fprintf(f, "frame") > 0);
+	for (const char* name : kPassNames) {
+		written = written && (fprintf(f, ",%s_ms", name) > 0);
+	}
+	written = written && (fprintf(f, ",total_ms\n") > 0);
+
+	// the history is a ring once full; the oldest frame is the one to be overwritten next
+	const uint64_t first = measuredFrames - history.size();
+	for (uint64_t frame = first; frame < measuredFrames && written; frame++) {
+		const FrameTimes &times = history[frame % HISTORY_FRAMES];
+		float total = 0.0f;
+		written = (fprintf(f, "%llu", (unsigned long long) frame) > 0);
+		for (float ms : times) {
+			if (std::isnan(ms)) {
+				written = written && (fputc(',', f) != EOF);
+				continue;
+			}
+			written = written && (fprintf(f, ",%.4f", ms) > 0);
+			total += ms;
+		}
+		written = written && (fprintf(f, ",%.4f\n", total) > 0);
+	}
+
+	if (fclose(f) != 0 || !written) {
+		SDL_SetError("GpuProfiler::WriteCsv(): could not write %s", fileName);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <vector>
+
+#include "GLWrapper.h"
+
+class Font;
+class TextRenderer;
+
+/**
+ * Measures the GPU time of the render passes of each frame with timestamp
+ * queries (glQueryCounter() at the start and the end of each pass). The
+ * queries of a frame are read back BUFFERED_FRAMES frames later, and only
+ * if the GPU has already written them, so the profiler never makes the CPU
+ * wait; a frame whose results are not ready by then is dropped (counted in
+ * GetLateFrames()). Works wherever GL_TIMESTAMP has counter bits, Mesa's
+ * llvmpipe included. Requires a current GL 4.5 context for its whole lifetime.
+ */
+class GpuProfiler
+{
+public:
+
+	enum Pass {
+		kClear,
+		kBoard,
+		kParticles,
+		kText,
+		kPost,			///< Whatever is drawn over the finished scene (e.g. this profiler's overlay).
+		PASS_COUNT
+	};
+
+	/// Sets of queries in flight (the frame being recorded, and the one being read back).
+	static const int BUFFERED_FRAMES = 2;
+
+	/// Number of the latest frames that GetStats() covers.
+	static const int WINDOW_FRAMES = 120;
+
+	/// Number of the latest frames kept for WriteCsv() (ten minutes at 60 fps).
+	static const int HISTORY_FRAMES = 36000;
+
+	/// GPU time of a pass over the frames it ran in, of the latest WINDOW_FRAMES (all 0 if none).
+	struct PassStats {
+		int samples = 0;				///< Frames of the window that ran the pass.
+		float lastMs = 0.0f;			///< In the latest frame that ran it.
+		float averageMs = 0.0f;
+		float minMs = 0.0f;
+		float maxMs = 0.0f;
+	};
+
+	/// Times a pass for as long as it exists; does nothing if the profiler is null.
+	class Scope
+	{
+	public:
+
+		Scope(GpuProfiler* profiler_, Pass pass_) : profiler(profiler_), pass(pass_) { if (profiler) profiler->BeginPass(pass); }
+		Scope(const Scope&) = delete;
+		~Scope() { if (profiler) profiler->EndPass(pass); }
+
+	protected:
+
+		GpuProfiler* profiler;
+		Pass pass;
+	};
+
+	/// Creates the query objects (none if timestamps are not supported, see IsSupported()).
+	GpuProfiler();
+	GpuProfiler(const GpuProfiler&) = delete;
+	~GpuProfiler();
+
+	/// Whether the context has timestamp queries; if not, the profiler measures nothing.
+	bool IsSupported() const { return supported; }
+
+	static const char* GetPassName(Pass pass);
+
+	/// Starts a frame: collects the results of the frame that last used this set of queries.
+	void BeginFrame();
+
+	/// Passes must not overlap; each one may be timed once per frame.
+	void BeginPass(Pass pass);
+	void EndPass(Pass pass);
+
+	const PassStats& GetStats(Pass pass) const { return stats[pass]; }
+
+	/// Average GPU time of the frames of the window, all passes they ran.
+	float GetAverageFrameMs() const { return averageFrameMs; }
+
+	/// Frames measured so far, and frames dropped as their results came too late.
+	uint64_t GetMeasuredFrames() const { return measuredFrames; }
+	uint64_t GetLateFrames() const { return lateFrames; }
+
+	/// Appends the statistics (a line per pass, then the frame) at (x, y), the top left corner.
+	void AddOverlay(TextRenderer &textRenderer, const Font &font, float x, float y, uint32_t color = 0xffffffff) const;
+
+	/**
+	 * Writes the per-frame times of the latest HISTORY_FRAMES frames as CSV
+	 * (a column per pass, in milliseconds, empty where the pass did not run,
+	 * and the frame's total).
+	 * \return False on failure (see SDL_GetError()).
+	 */
+	bool WriteCsv(const char* fileName) const;
+
+protected:
+
+	/// Milliseconds per pass, NaN for the passes a frame did not run.
+	using FrameTimes = std::array<float, PASS_COUNT>;
+
+	/// Reads back set `set`, if all its results are available. \return False if they are not.
+	bool Collect(int set, FrameTimes &times);
+
+	/// Adds a measured frame to the window and the history, and updates the stats.
+	void AddFrame(const FrameTimes &times);
+
+	bool supported = false;
+
+	/// [set][pass][0 = start, 1 = end]
+	GLuint queries[BUFFERED_FRAMES][PASS_COUNT][2] = {};
+
+	/// Passes recorded with each set (a bit per pass), 0 if it has not been used yet.
+	uint32_t recorded[BUFFERED_FRAMES] = {};
+
+	int set = 0;
+	uint64_t measuredFrames = 0;
+	uint64_t lateFrames = 0;
+
+	PassStats stats[PASS_COUNT];
+	float averageFrameMs = 0.0f;
+	std::array<FrameTimes, WINDOW_FRAMES> window = {};
+	std::vector<FrameTimes> history;		///< Ring of HISTORY_FRAMES frames, allocated up front.
+};
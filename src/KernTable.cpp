@@ -0,0 +1,36 @@
+#include "KernTable.h"
+
+const KernTable::Slot KernTable::emptySlot = { KernTable::EMPTY_PAIR, 0.0f };
+
+//---
+
+void KernTable::Build(const std::vector<Slot> &pairs)
+{
+	// keep the load factor at most 1/2, so that misses (the common case) stop early
+	uint32_t slotCount = 1;
+	while (slotCount < 2 * pairs.size() + 1) slotCount *= 2;
+
+	ownedSlots.assign(slotCount, emptySlot);
+	slots = ownedSlots.data();
+	mask = slotCount - 1;
+	pairCount = uint32_t(pairs.size());
+
+	for (const Slot &entry : pairs) {
+		uint32_t i = Hash(entry.pair) & mask;
+		while (ownedSlots[i].pair != EMPTY_PAIR) i = (i + 1) & mask;
+		ownedSlots[i] = entry;
+	}
+}
+
+//---
+
+void KernTable::Attach(const Slot* slots_, uint32_t slotCount)
+{
+	ownedSlots.clear();
+	slots = slots_;
+	mask = slotCount - 1;
+	pairCount = 0;
+	for (uint32_t i = 0; i < slotCount; i++) {
+		if (slots[i].pair != EMPTY_PAIR) pairCount++;
+	}
+}
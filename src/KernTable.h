@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Kerning adjustments of character pairs, extracted from the font once
+ * so that looking up a pair costs a hash probe instead of a walk through
+ * the font's kern/GPOS tables (stbtt_GetCodepointKernAdvance()).
+ *
+ * The table is a flat open-addressing hash (linear probing, at most half
+ * full) holding only the pairs with a non-zero adjustment. The slots are
+ * plain data, so Font can store them in its atlas cache and use them
+ * straight from the mapping.
+ */
+class KernTable {
+public:
+
+	/// Key of an unused slot.
+	static const uint32_t EMPTY_PAIR = 0xffffffffu;
+
+	struct Slot {
+		uint32_t pair;		///< MakePair() of the two characters, or EMPTY_PAIR.
+		float advance;		///< Adjustment in pixels.
+	};
+
+	/// Characters must be below 0x10000 (Font covers far fewer).
+	static uint32_t MakePair(int first, int second) { return (uint32_t(first) << 16) | uint32_t(second); }
+
+	/// Builds the table from a list of (pair, advance) entries with distinct pairs.
+	void Build(const std::vector<Slot> &pairs);
+
+	/**
+	 * Uses slots stored elsewhere (e.g. in a mapped file), which must outlive the table.
+	 * slotCount must be a power of two and at least one slot must be empty.
+	 */
+	void Attach(const Slot* slots_, uint32_t slotCount);
+
+	/// Returns the adjustment between two characters (0 if the pair is not kerned).
+	float Get(int first, int second) const
+	{
+		const uint32_t pair = MakePair(first, second);
+		for (uint32_t i = Hash(pair) & mask; ; i = (i + 1) & mask) {
+			if (slots[i].pair == pair) return slots[i].advance;
+			if (slots[i].pair == EMPTY_PAIR) return 0.0f;
+		}
+	}
+
+	/// Returns the slots (e.g. to store them), GetSlotCount() entries.
+	const Slot* GetSlots() const { return slots; }
+	uint32_t GetSlotCount() const { return mask + 1; }
+
+	/// Number of kerned pairs in the table.
+	uint32_t GetPairCount() const { return pairCount; }
+
+protected:
+
+	static uint32_t Hash(uint32_t pair) { return (pair * 0x9e3779b1u) >> 7; }
+
+	/// A single empty slot, so that an empty table needs no special case in Get().
+	static const Slot emptySlot;
+
+	std::vector<Slot> ownedSlots;
+	const Slot* slots = &emptySlot;
+	uint32_t mask = 0;
+	uint32_t pairCount = 0;
+};
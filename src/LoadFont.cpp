@@ -1,35 +1,147 @@
 #include "LoadFont.h"
+#include "ToUnicode.h"
+#include "Profiler.h"
 
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "stb_rect_pack.h"
 #define STB_TRUETYPE_IMPLEMENTATION
 #include "stb_truetype.h"
 
 #include <iostream>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
 
 Font::Font(const MappedFile &fontFile, float fontSize)
+	: Font(fontFile, Settings{ fontSize })
 {
+}
+
+Font::Font(const MappedFile &fontFile, const Settings &settings_)
+	: Font(std::span<const uint8_t>(fontFile.GetData(), fontFile.GetSize()), settings_)
+{
+}
+
+Font::Font(std::span<const uint8_t> fontData, const Settings &settings_)
+	: settings(settings_)
+{
+	PROFILE_ZONE("Font::Font");
+	if (fontData.empty()) {
+		SDL_SetError("Font: no font data");
+		return;
+	}
+	if (!stbtt_InitFont(&fontInfo, fontData.data(), 0)) { /*stbtt_GetFontOffsetForIndex(fontData.data(), 0) */
+		SDL_SetError("stbtt_InitFont() failed");
+		return;
+	}
+
+	int unscaledAscent, unscaledDescent, unscaledLineGap;
+	stbtt_GetFontVMetrics(&fontInfo, &unscaledAscent, &unscaledDescent, &unscaledLineGap);
+	scale = stbtt_ScaleForPixelHeight(&fontInfo, settings.size);
+	ascent = scale * unscaledAscent;
+	descent = scale * unscaledDescent;
+	lineGap = scale * unscaledLineGap;
+
+	uint64_t fontHash = 0;
+	if (settings.cacheFileName) {
+		fontHash = FontCache::HashBytes(fontData.data(), fontData.size());
+		if (LoadFromCache(settings.cacheFileName, fontHash)) {
+			ok = true;
+			return;
+		}
+	}
+
+	if (!Rasterize()) return;
+	BuildKernTable();
+
+	if (settings.cacheFileName) {
+
+		// failing to store the cache only costs time on the next start
+		if (!FontCache::Write(settings.cacheFileName, MakeCacheKey(fontHash), rasterizedChars, kernTable,
+			static_cast<const uint8_t*>(fontSurface->GetPixels()), fontSurface->GetPitch())
+		) {
+			std::cerr << "Font: could not store the atlas cache: " << SDL_GetError() << std::endl;
+		}
+	}
+
+	ok = true;
+}
+
+Font::~Font()
+{
+	ok = false;
+
+	// the surface refers to the cache mapping, so it must go first
+	fontSurface.reset();
+	cacheFile.reset();
+}
+
+void Font::GetSurfaceSize(int &width, int &height) const
+{
+	width = settings.sdf ? SDF_FONT_SURFACE_WIDTH : DEFAULT_FONT_SURFACE_WIDTH;
+	height = settings.sdf ? SDF_FONT_SURFACE_HEIGHT : DEFAULT_FONT_SURFACE_HEIGHT;
+}
+
+FontCache::Key Font::MakeCacheKey(uint64_t fontHash) const
+{
+	int width, height;
+	GetSurfaceSize(width, height);
+
+	FontCache::Key key;
+	key.fontHash = fontHash;
+	key.fontSize = settings.size;
+	key.oversampling = settings.sdf ? 1 : uint32_t(settings.oversampling);
+	key.width = uint32_t(width);
+	key.height = uint32_t(height);
+	key.charCount = NUMBER_OF_CHARS;
+	key.sdf = settings.sdf ? 1 : 0;
+	return key;
+}
+
+bool Font::LoadFromCache(const char* cacheFileName, uint64_t fontHash)
+{
+	auto mapped = std::make_unique<MappedFile>(cacheFileName);
+	if (!mapped->Ok()) return false;
+
+	const FontCache::Key key = MakeCacheKey(fontHash);
+	const FontCache::Header* header = FontCache::Validate(*mapped, key);
+	if (!header) return false;
+
+	// the surface only reads the pixels, so the private read-only mapping is enough
 	fontSurface = std::make_unique<SDL::Surface>(
-		DEFAULT_FONT_SURFACE_WIDTH, DEFAULT_FONT_SURFACE_HEIGHT,
-		8, SDL_PIXELFORMAT_INDEX8
+		const_cast<uint8_t*>(FontCache::GetPixels(*mapped, *header)),
+		int(key.width), int(key.height),
+		8, int(header->pitch), SDL_PIXELFORMAT_INDEX8
 	);
+	fontSurface->SetGrayscalePalette();
+
+	packedChars = FontCache::GetChars(*mapped, *header);
+	kernTable.Attach(FontCache::GetKernSlots(*mapped, *header), header->kernSlotCount);
+	cacheFile = std::move(mapped);
+	return true;
+}
+
+bool Font::Rasterize()
+{
+	int width, height;
+	GetSurfaceSize(width, height);
+	fontSurface = std::make_unique<SDL::Surface>(width, height, 8, SDL_PIXELFORMAT_INDEX8);
 	if (!fontSurface->Ok()) {
 		SDL_SetError("Could not create surface: %s", SDL_GetError());
-		return;
+		return false;
 	}
+	fontSurface->SetGrayscalePalette();
 
-	SDL_Color colorRamp[256];
-	for (int i = 0; i < 256; i++) {
-		colorRamp[i].r = i;
-		colorRamp[i].g = i;
-		colorRamp[i].b = i;
-		colorRamp[i].a = 255;
-	}
-	SDL_SetPaletteColors(fontSurface->GetFormat()->palette, colorRamp, 0, 256);
+	memset(rasterizedChars, 0, sizeof(rasterizedChars));
+	if (!(settings.sdf ? RasterizeSDF() : RasterizeBitmaps())) return false;
 
-	if (!stbtt_InitFont(&fontInfo, fontFile.GetData(), 0)) { /*stbtt_GetFontOffsetForIndex(fontFile.GetData(), 0) */
-		SDL_SetError("stbtt_InitFont() failed");
-		return;
-	}
+	packedChars = rasterizedChars;
+	return true;
+}
 
+bool Font::RasterizeBitmaps()
+{
 	stbtt_pack_context packContext = { 0 };
 	if (!stbtt_PackBegin(
 		&packContext,
@@ -38,31 +150,283 @@ Font::Font(const MappedFile &fontFile, float fontSize)
 		1, nullptr)
 	) {
 		SDL_SetError("stbtt_PackBegin() failed");
-		return;
+		return false;
 	}
+	stbtt_PackSetOversampling(&packContext, settings.oversampling, settings.oversampling);
 
-	if (!stbtt_PackFontRange(&packContext, fontFile.GetData(), 0, fontSize,
-		0x0000, NUMBER_OF_CHARS,
-		packedChars)
-	) {
-		SDL_SetError("stbtt_PackFontRange() failed");
-		stbtt_PackEnd(&packContext);
-		return;
-	}
+	// the steps of stbtt_PackFontRange(), split so that rendering can run in parallel
+	stbtt_pack_range range = { 0 };
+	range.font_size = settings.size;
+	range.first_unicode_codepoint_in_range = 0x0000;
+	range.num_chars = NUMBER_OF_CHARS;
+	range.chardata_for_range = rasterizedChars;
+
+	std::vector<stbrp_rect> rects(NUMBER_OF_CHARS);
+	int rectCount = stbtt_PackFontRangesGatherRects(&packContext, &fontInfo, &range, 1, rects.data());
+	stbtt_PackFontRangesPackRects(&packContext, rects.data(), rectCount);
+
+	// Rendering temporarily modifies the pack context, hence every slice works on its own copy.
+	bool rendered = RenderSlices([&](int first, int count) {
+		stbtt_pack_range slice = range;
+		slice.first_unicode_codepoint_in_range += first;
+		slice.num_chars = count;
+		slice.chardata_for_range += first;
+
+		stbtt_pack_context sliceContext = packContext;
+		return stbtt_PackFontRangesRenderIntoRects(&sliceContext, &fontInfo, &slice, 1, rects.data() + first) != 0;
+	});
 
 	stbtt_PackEnd(&packContext);
 
-	ok = true;
+	if (!rendered) {
+		SDL_SetError("stbtt_PackFontRangesRenderIntoRects() failed");
+		return false;
+	}
+	return true;
 }
 
-Font::~Font()
+bool Font::RasterizeSDF()
 {
-	ok = false;
+	// the SDF of a glyph covers its bitmap box extended by the padding on all sides
+	// (as computed by stbtt_GetGlyphSDF()), plus one pixel of spacing in the atlas
+	std::vector<int> glyphs(NUMBER_OF_CHARS);
+	std::vector<stbrp_rect> rects(NUMBER_OF_CHARS);
+	for (int c = 0; c < NUMBER_OF_CHARS; c++) {
+		int x0, y0, x1, y1;
+		glyphs[c] = stbtt_FindGlyphIndex(&fontInfo, c);
+		stbtt_GetGlyphBitmapBoxSubpixel(&fontInfo, glyphs[c], scale, scale, 0.0f, 0.0f, &x0, &y0, &x1, &y1);
+		const bool empty = (x0 == x1 || y0 == y1);
+		rects[c].id = c;
+		rects[c].w = empty ? 0 : x1 - x0 + 2 * SDF_PADDING + 1;
+		rects[c].h = empty ? 0 : y1 - y0 + 2 * SDF_PADDING + 1;
+	}
+
+	stbrp_context packer;
+	std::vector<stbrp_node> packerNodes(fontSurface->GetWidth());
+	stbrp_init_target(&packer, fontSurface->GetWidth() - 1, fontSurface->GetHeight() - 1,
+		packerNodes.data(), int(packerNodes.size()));
+	if (!stbrp_pack_rects(&packer, rects.data(), NUMBER_OF_CHARS)) {
+		SDL_SetError("Font::RasterizeSDF(): the glyphs do not fit in the atlas");
+		return false;
+	}
+
+	const float pixelDistScale = float(SDF_ONEDGE_VALUE) / float(SDF_PADDING);
+	const int pitch = fontSurface->GetPitch();
+	uint8_t* pixels = static_cast<uint8_t*>(fontSurface->GetPixels());
+
+	return RenderSlices([&](int first, int count) {
+		for (int c = first; c < first + count; c++) {
+			stbtt_packedchar &geometry = rasterizedChars[c];
+			int advance, leftSideBearing;
+			stbtt_GetGlyphHMetrics(&fontInfo, glyphs[c], &advance, &leftSideBearing);
+			geometry.xadvance = scale * advance;
+			if (rects[c].w == 0) continue;	// nothing to draw (e.g. a space)
+
+			int w = 0, h = 0, xoff = 0, yoff = 0;
+			uint8_t* sdf = stbtt_GetGlyphSDF(&fontInfo, scale, glyphs[c], SDF_PADDING,
+				SDF_ONEDGE_VALUE, pixelDistScale, &w, &h, &xoff, &yoff);
+			if (!sdf) continue;
+
+			// the rows of the SDF are `stride` apart; only what fits in the rect is copied
+			const int x = rects[c].x + 1, y = rects[c].y + 1;
+			const int stride = w;
+			w = std::min(w, int(rects[c].w) - 1);
+			h = std::min(h, int(rects[c].h) - 1);
+			for (int row = 0; row < h; row++) {
+				memcpy(pixels + x + (y + row) * pitch, sdf + row * stride, w);
+			}
+			stbtt_FreeSDF(sdf, fontInfo.userdata);
+
+			geometry.x0 = x;
+			geometry.y0 = y;
+			geometry.x1 = x + w;
+			geometry.y1 = y + h;
+			geometry.xoff = float(xoff);
+			geometry.yoff = float(yoff);
+			geometry.xoff2 = float(xoff + w);
+			geometry.yoff2 = float(yoff + h);
+		}
+		return true;
+	});
+}
+
+bool Font::RenderSlices(const std::function<bool(int, int)> &renderSlice)
+{
+	if (!settings.threadPool) {
+		return renderSlice(0, NUMBER_OF_CHARS);
+	}
+
+	// The slices cover disjoint rects of the atlas, so they can be rendered
+	// concurrently straight into the shared pixels.
+	std::atomic<bool> allRendered = true;
+	const int taskCount = (NUMBER_OF_CHARS + GLYPHS_PER_TASK - 1) / GLYPHS_PER_TASK;
+	settings.threadPool->ParallelFor(taskCount, [&](int task) {
+		const int first = task * GLYPHS_PER_TASK;
+		if (!renderSlice(first, std::min(GLYPHS_PER_TASK, NUMBER_OF_CHARS - first))) {
+			allRendered = false;
+		}
+	});
+	return allRendered;
+}
+
+namespace {
+
+/**
+ * The pair kerning of a font in font units, between glyphs of a given set
+ * (by their index in the set): advances[first * size + second].
+ */
+struct GlyphPairAdvances {
+	std::vector<int> glyphs;			///< The set.
+	std::vector<int> indexOfGlyph;		///< Index in the set by glyph id (-1 if not in it).
+	std::vector<int> advances;
+
+	int GetIndex(int glyph) const { return (glyph < int(indexOfGlyph.size())) ? indexOfGlyph[glyph] : -1; }
+};
+
+/**
+ * Adds the pairs of the GPOS pair adjustment lookups, read straight from the
+ * table. Follows stbtt__GetGlyphGPOSInfoAdvance() (the subtable formats it
+ * supports, and its quirks): a pair takes the value of the first subtable
+ * that has one for it, and none if the first subtable covering its first
+ * glyph has value formats other than an x advance alone.
+ */
+void AddGposAdvances(const stbtt_fontinfo &fontInfo, GlyphPairAdvances &pairs)
+{
+	stbtt_uint8* data = fontInfo.data + fontInfo.gpos;
+	if (ttUSHORT(data) != 1 || ttUSHORT(data + 2) != 0) return;
+
+	const int size = int(pairs.glyphs.size());
+	std::vector<uint8_t> decided(pairs.advances.size(), 0);
+	std::vector<int> classes(size);
+
+	stbtt_uint8* lookupList = data + ttUSHORT(data + 8);
+	const int lookupCount = ttUSHORT(lookupList);
+	for (int lookup = 0; lookup < lookupCount; lookup++) {
+		stbtt_uint8* lookupTable = lookupList + ttUSHORT(lookupList + 2 + 2 * lookup);
+		if (ttUSHORT(lookupTable) != 2) continue;		// not pair adjustment
+
+		const int subtableCount = ttUSHORT(lookupTable + 4);
+		for (int subtable = 0; subtable < subtableCount; subtable++) {
+			stbtt_uint8* table = lookupTable + ttUSHORT(lookupTable + 6 + 2 * subtable);
+			const int format = ttUSHORT(table);
+			if (format != 1 && format != 2) continue;
+			stbtt_uint8* coverage = table + ttUSHORT(table + 2);
+			const bool supported = (ttUSHORT(table + 4) == 4 && ttUSHORT(table + 6) == 0);
+			if (format == 2 && supported) {
+				for (int second = 0; second < size; second++) {
+					classes[second] = stbtt__GetGlyphClass(table + ttUSHORT(table + 10), pairs.glyphs[second]);
+				}
+			}
+
+			for (int first = 0; first < size; first++) {
+				const int coverageIndex = stbtt__GetCoverageIndex(coverage, pairs.glyphs[first]);
+				if (coverageIndex < 0) continue;
+				int* advances = &pairs.advances[size_t(first) * size];
+				uint8_t* rowDecided = &decided[size_t(first) * size];
+
+				if (!supported) {
+					for (int second = 0; second < size; second++) rowDecided[second] = 1;
+				}
+				else if (format == 1) {
+					// pair value records: the second glyph, then its x advance
+					stbtt_uint8* pairSet = table + ttUSHORT(table + 10 + 2 * coverageIndex);
+					const int recordCount = ttUSHORT(pairSet);
+					for (int record = 0; record < recordCount; record++) {
+						stbtt_uint8* pairValue = pairSet + 2 + 4 * record;
+						const int second = pairs.GetIndex(ttUSHORT(pairValue));
+						if (second < 0 || rowDecided[second]) continue;
+						advances[second] += ttSHORT(pairValue + 2);
+						rowDecided[second] = 1;
+					}
+				}
+				else {
+					const int class1 = stbtt__GetGlyphClass(table + ttUSHORT(table + 8), pairs.glyphs[first]);
+					const int class1Count = ttUSHORT(table + 12);
+					const int class2Count = ttUSHORT(table + 14);
+					if (class1 < 0 || class1 >= class1Count) continue;
+					stbtt_uint8* class2Records = table + 16 + 2 * class1 * class2Count;
+					for (int second = 0; second < size; second++) {
+						if (classes[second] < 0 || classes[second] >= class2Count || rowDecided[second]) continue;
+						advances[second] += ttSHORT(class2Records + 2 * classes[second]);
+						rowDecided[second] = 1;
+					}
+				}
+			}
+		}
+	}
+}
+
+/// Adds the pairs of the kern table: its first subtable, if horizontal (as stbtt__GetGlyphKernInfoAdvance()).
+void AddKernAdvances(const stbtt_fontinfo &fontInfo, GlyphPairAdvances &pairs)
+{
+	stbtt_uint8* data = fontInfo.data + fontInfo.kern;
+	if (ttUSHORT(data + 2) < 1 || ttUSHORT(data + 8) != 1) return;
+
+	// (first, second, value) records, sorted by the pair
+	const int size = int(pairs.glyphs.size());
+	const int recordCount = ttUSHORT(data + 10);
+	for (int record = 0; record < recordCount; record++) {
+		stbtt_uint8* pair = data + 18 + 6 * record;
+		if (record > 0 && ttULONG(pair) == ttULONG(pair - 6)) continue;	// a lookup finds one of duplicates
+		const int first = pairs.GetIndex(ttUSHORT(pair));
+		const int second = pairs.GetIndex(ttUSHORT(pair + 2));
+		if (first < 0 || second < 0) continue;
+		pairs.advances[size_t(first) * size + second] += ttSHORT(pair + 4);
+	}
+}
+
+} // namespace
+
+/**
+ * Extracts the kerning of all pairs of covered characters, walking the
+ * font's kern and GPOS pair tables once (stb_truetype only looks pairs up,
+ * which for all pairs of a few hundred glyphs takes tens of milliseconds).
+ * The result is what stbtt_GetGlyphKernAdvance() returns for each pair.
+ */
+void Font::BuildKernTable()
+{
+	std::vector<KernTable::Slot> pairs;
+	if (!fontInfo.kern && !fontInfo.gpos) {
+		kernTable.Build(pairs);
+		return;
+	}
+
+	// characters without a glyph cannot be kerned; several characters may share a glyph
+	std::vector<int> charCodes, charGlyphs;
+	GlyphPairAdvances glyphPairs;
+	glyphPairs.indexOfGlyph.assign(size_t(std::max(fontInfo.numGlyphs, 0)), -1);
+	for (int c = 0; c < NUMBER_OF_CHARS; c++) {
+		const int glyph = stbtt_FindGlyphIndex(&fontInfo, c);
+		if (glyph == 0 || glyph >= int(glyphPairs.indexOfGlyph.size())) continue;
+		if (glyphPairs.indexOfGlyph[glyph] < 0) {
+			glyphPairs.indexOfGlyph[glyph] = int(glyphPairs.glyphs.size());
+			glyphPairs.glyphs.push_back(glyph);
+		}
+		charCodes.push_back(c);
+		charGlyphs.push_back(glyphPairs.indexOfGlyph[glyph]);
+	}
+	const size_t glyphCount = glyphPairs.glyphs.size();
+	glyphPairs.advances.assign(glyphCount * glyphCount, 0);
+
+	if (fontInfo.gpos) AddGposAdvances(fontInfo, glyphPairs);
+	if (fontInfo.kern) AddKernAdvances(fontInfo, glyphPairs);
+
+	const int count = int(charCodes.size());
+	for (int first = 0; first < count; first++) {
+		const int* advances = &glyphPairs.advances[size_t(charGlyphs[first]) * glyphCount];
+		for (int second = 0; second < count; second++) {
+			const int advance = advances[charGlyphs[second]];
+			if (advance != 0) {
+				pairs.push_back(KernTable::Slot{ KernTable::MakePair(charCodes[first], charCodes[second]), scale * advance });
+			}
+		}
+	}
+	kernTable.Build(pairs);
 }
 
 bool Font::GetGlyphRect(int charCode, SDL_Rect& result) const
 {
-	if (charCode > NUMBER_OF_CHARS) return false;
+	if (charCode < 0 || charCode >= NUMBER_OF_CHARS) return false;
 
 	const stbtt_packedchar& packedChar = packedChars[charCode];
 	result.x = packedChar.x0;
@@ -74,28 +438,50 @@ bool Font::GetGlyphRect(int charCode, SDL_Rect& result) const
 
 bool Font::GetGlyphGeometry(int charCode, stbtt_packedchar &glyphGeometry) const
 {
-	if (charCode > NUMBER_OF_CHARS) return false;
+	if (charCode < 0 || charCode >= NUMBER_OF_CHARS) return false;
 	glyphGeometry = packedChars[charCode];
 	return true;
 }
 
-SDL_Rect Font::ComputeTextSize(const std::wstring &text)
+template <typename Codepoints>
+SDL_Rect Font::ComputeTextSizeOf(const Codepoints &text) const
 {
-	int x = 0, maxY = 0;
-	for (wchar_t c : text) {
+	float x = 0.0f;
+	int maxY = 0;
+	int previous = -1;
+	for (auto c : text) {
 		stbtt_packedchar glyphGeometry;
 		if (GetGlyphGeometry(int(c), glyphGeometry)) {
+			if (previous >= 0) {
+				x += GetKernAdvance(previous, int(c));
+			}
 			x += glyphGeometry.xadvance;
 			if (glyphGeometry.y1 - glyphGeometry.y0 > maxY) {
 				maxY = glyphGeometry.y1 - glyphGeometry.y0;
 			}
+			previous = int(c);
 		}
 	}
 
 	SDL_Rect result;
 	result.x = 0;
 	result.y = 0;
-	result.w = x;
-	result.y = maxY;
+	result.w = int(x + 0.5f);
+	result.h = maxY;
 	return result;
-}
\ No newline at end of file
+}
+
+SDL_Rect Font::ComputeTextSize(std::wstring_view text) const
+{
+	return ComputeTextSizeOf(text);
+}
+
+SDL_Rect Font::ComputeTextSize(std::u32string_view text) const
+{
+	return ComputeTextSizeOf(text);
+}
+
+SDL_Rect Font::ComputeTextSize(std::u8string_view text) const
+{
+	return ComputeTextSizeOf(Utf8Codepoints(text));
+}
@@ -1,11 +1,18 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <memory>
+#include <functional>
+#include <span>
 
 #include "SDLWrapper.h"
 #include "MapFile.h"
+#include "ThreadPool.h"
+#include "FontCache.h"
+#include "KernTable.h"
 
+#include "stb_rect_pack.h"
 #include "stb_truetype.h"
 
 class Font {
@@ -14,23 +21,129 @@ public:
 	static const int NUMBER_OF_CHARS = 0x1ff;
 	static const int DEFAULT_FONT_SURFACE_WIDTH = 2048;
 	static const int DEFAULT_FONT_SURFACE_HEIGHT = 512;
+	static const int DEFAULT_OVERSAMPLING = 1;
+
+	/// Atlas size in the SDF mode; one SDF atlas replaces a bitmap atlas per size.
+	static const int SDF_FONT_SURFACE_WIDTH = 1024;
+	static const int SDF_FONT_SURFACE_HEIGHT = 512;
+
+	/// Distance (in atlas pixels) covered by the SDF around each glyph outline.
+	static const int SDF_PADDING = 4;
+
+	/// SDF value of the outline; inside is above, outside below.
+	static const int SDF_ONEDGE_VALUE = 128;
+
+	/// Parameters of the glyph atlas.
+	struct Settings {
+		float size = 0.0f;
+
+		/// Oversampling factor, used both horizontally and vertically.
+		int oversampling = DEFAULT_OVERSAMPLING;
+
+		/// If set, the rasterized atlas is loaded from this file when it matches
+		/// the font and the settings; otherwise it is rebuilt and saved there.
+		const char* cacheFileName = nullptr;
+
+		/// If set, glyphs are rendered in parallel on this pool;
+		/// the result is identical to the serial rendering.
+		ThreadPool* threadPool = nullptr;
+
+		/// If true, the atlas holds signed distance fields (stbtt_GetGlyphSDF())
+		/// rasterized at `size`, which can be drawn crisply at any scale using
+		/// TextShaders::kSdfFragmentShader. Oversampling does not apply.
+		bool sdf = false;
+	};
+
+	/// Number of glyphs rendered by one task when rendering in parallel.
+	static const int GLYPHS_PER_TASK = 16;
 
 	Font(const MappedFile &fontFile, float fontSize);
+	Font(const MappedFile &fontFile, const Settings &settings);
+
+	/// Loads the font from memory (e.g. an AssetPack entry), which must outlive the Font.
+	Font(std::span<const uint8_t> fontData, const Settings &settings);
 	~Font();
 	bool Ok() const { return ok; }
 	bool GetGlyphRect(int charCode, SDL_Rect& glyphRect) const;
 	bool GetGlyphGeometry(int charCode, stbtt_packedchar &glyphGeometry) const;
 
+	/// Returns true if the atlas was mapped from the cache file instead of being rasterized.
+	bool IsFromCache() const { return cacheFile != nullptr; }
+
+	/// Returns the whole glyph table (NUMBER_OF_CHARS entries), e.g. for stbtt_GetPackedQuad().
+	const stbtt_packedchar* GetPackedChars() const { return packedChars; }
+
+	/// Returns true if the atlas holds signed distance fields (see Settings::sdf).
+	bool IsSDF() const { return settings.sdf; }
+
+	/// Returns the pixel size the atlas was rasterized for.
+	float GetSize() const { return settings.size; }
+
+	/// Returns the factor that scales glyph geometry to the given pixel size
+	/// (only meaningful for SDF fonts; bitmap fonts look right at 1.0 only).
+	float GetScaleForSize(float pixelSize) const { return pixelSize / settings.size; }
+
 	/// Returns the internal surface that holds the glyphs.
 	/// Use GetGlyphGeometry() to find out coordinates of a glyph image in this surface.
+	/// If IsFromCache(), the pixels are a read-only mapping and must not be modified.
 	SDL::Surface& GetSurface() { return *(fontSurface.get()); }
 
-	SDL_Rect ComputeTextSize(const std::wstring &text);
+	/// Returns the horizontal kerning adjustment (in pixels) between two characters;
+	/// a lookup in the table extracted from the font on load.
+	float GetKernAdvance(int charCode1, int charCode2) const
+	{
+		if (charCode1 < 0 || charCode1 >= NUMBER_OF_CHARS || charCode2 < 0 || charCode2 >= NUMBER_OF_CHARS) return 0.0f;
+		return kernTable.Get(charCode1, charCode2);
+	}
+
+	/// Returns the table of kerned pairs within the covered range.
+	const KernTable& GetKernTable() const { return kernTable; }
+
+	/// Vertical metrics in pixels at the font's size: ascent above the baseline,
+	/// descent below it (negative) and the baseline-to-baseline distance.
+	float GetAscent() const { return ascent; }
+	float GetDescent() const { return descent; }
+	float GetLineHeight() const { return ascent - descent + lineGap; }
+
+	/// Returns the size of a single line of text (advances including kerning,
+	/// height of the tallest glyph). For wrapping and positioning, see TextLayout.
+	/// Does not allocate; UTF-8 is decoded on the fly.
+	SDL_Rect ComputeTextSize(std::wstring_view text) const;
+	SDL_Rect ComputeTextSize(std::u32string_view text) const;
+	SDL_Rect ComputeTextSize(std::u8string_view text) const;
 
 private:
 
+	bool LoadFromCache(const char* cacheFileName, uint64_t fontHash);
+	void GetSurfaceSize(int &width, int &height) const;
+	FontCache::Key MakeCacheKey(uint64_t fontHash) const;
+	bool Rasterize();
+	bool RasterizeBitmaps();
+	bool RasterizeSDF();
+	bool RenderSlices(const std::function<bool(int, int)> &renderSlice);
+	void BuildKernTable();
+
+	template <typename Codepoints>
+	SDL_Rect ComputeTextSizeOf(const Codepoints &text) const;
+
 	bool ok = false;
+	Settings settings;
 	std::unique_ptr<SDL::Surface> fontSurface = nullptr;
 	stbtt_fontinfo fontInfo = { 0 };
-	stbtt_packedchar packedChars[NUMBER_OF_CHARS];
+
+	/// Scale from font units to pixels, and the vertical metrics in pixels.
+	float scale = 0.0f;
+	float ascent = 0.0f;
+	float descent = 0.0f;
+	float lineGap = 0.0f;
+
+	/// The mapped cache file (if the atlas was loaded from it).
+	std::unique_ptr<MappedFile> cacheFile = nullptr;
+
+	/// Glyph geometry; points either to rasterizedChars or into the cache file.
+	const stbtt_packedchar* packedChars = nullptr;
+	stbtt_packedchar rasterizedChars[NUMBER_OF_CHARS];
+
+	/// Kerned pairs; its slots live either in the table itself or in the cache file.
+	KernTable kernTable;
 };
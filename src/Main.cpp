@@ -1,8 +1,20 @@
 #include "MapFile.h"
+#include "AssetPack.h"
 #include "LoadFont.h"
 #include "ToUnicode.h"
 #include "SDL.h"
 #include "SDLWrapper.h"
+#include "TextRenderer.h"
+#include "SpriteBatch.h"
+#include "GemSprites.h"
+#include "GLDevice.h"
+#include "GameView.h"
+#include "GpuProfiler.h"
+#include "Profiler.h"
+#include "AllocCounter.h"
+#include "Bench.h"
+#include "Game.h"
+#include "Replay.h"
 
 #include "GL/gl.h"
 
@@ -10,35 +22,366 @@
 #include <array>
 #include <iostream>
 #include <string.h>
-#include <locale>
 #include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <optional>
+#include <string_view>
 
 const char* kDefWindowTitle = "Midnight Jewels";
 const int kDefWindowWidth = 1280;
 const int kDefWindowHeight = 1024;
+const char* kDefAssetPack = "mjewels.pack";
+const char* kDefFontAsset = "fonts/hud.ttf";
+const char* kDefFontFile = "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf";
+const float kDefFontSize = 32.0f;
+const int kDefBenchFrames = 600;
+const char* kDefGpuProfileFile = "mjewels-gpu.csv";
+
+//---
+
+/**
+ * Queues the scripted input of one benchmark frame: the mouse moving
+ * over the board, clicks and key presses now and then, and an expose
+ * of the window so that every frame is drawn. The stream depends only
+ * on the frame number, so every run sees the same events.
+ */
+static void PushScriptedEvents(SDL::Window &window, int frame)
+{
+	SDL_Event event = {};
+	event.type = SDL_MOUSEMOTION;
+	event.motion.windowID = window.getID();
+	event.motion.x = (frame * 7) % kDefWindowWidth;
+	event.motion.y = (frame * 13) % kDefWindowHeight;
+	event.motion.xrel = 7;
+	event.motion.yrel = 13;
+	SDL_PushEvent(&event);
+
+	if (frame % 10 == 0) {
+		event = {};
+		event.type = SDL_MOUSEBUTTONDOWN;
+		event.button.windowID = window.getID();
+		event.button.button = SDL_BUTTON_LEFT;
+		event.button.state = SDL_PRESSED;
+		event.button.clicks = 1;
+		event.button.x = (frame * 7) % kDefWindowWidth;
+		event.button.y = (frame * 13) % kDefWindowHeight;
+		SDL_PushEvent(&event);
+	}
+	if (frame % 30 == 0) {
+		event = {};
+		event.type = SDL_KEYDOWN;
+		event.key.windowID = window.getID();
+		event.key.state = SDL_PRESSED;
+		event.key.keysym.scancode = SDL_SCANCODE_SPACE;
+		event.key.keysym.sym = SDLK_SPACE;
+		SDL_PushEvent(&event);
+	}
+
+	event = {};
+	event.type = SDL_WINDOWEVENT;
+	event.window.windowID = window.getID();
+	event.window.event = SDL_WINDOWEVENT_EXPOSED;
+	SDL_PushEvent(&event);
+}
+
+//---
+
+/**
+ * Runs the event loop headlessly for the given number of frames of scripted
+ * input, then prints frame time percentiles, heap allocations (in builds
+ * with COUNT_ALLOCATIONS) and GL calls per frame as counted by `device`
+ * (one "name value" pair per line, as mjbench does).
+ */
+static int RunBenchmark(SDL::EventLoop &eventLoop, SDL::Window &window, const GL::Device &device, int frameCount)
+{
+	// the first frame compiles shaders and allocates driver state; do not count it
+	PushScriptedEvents(window, 0);
+	eventLoop.RunOnce(false);
+	glFinish();
+
+	std::vector<double> frameMs;
+	frameMs.reserve(frameCount);
+#ifdef COUNT_ALLOCATIONS
+	const uint64_t allocationsBefore = AllocCounter::GetCount();
+#endif
+	const GL::Device::Counters glCallsBefore = device.GetRunningTotal();
+	Bench::Stopwatch total;
+	for (int frame = 1; frame <= frameCount; frame++) {
+		PushScriptedEvents(window, frame);
+		Bench::Stopwatch stopwatch;
+		if (!eventLoop.RunOnce(false)) break;
+		glFinish();		// include the GPU work in the frame time
+		frameMs.push_back(stopwatch.ElapsedMs());
+	}
+	const double totalMs = total.ElapsedMs();
+	const double frames = double(frameMs.size());
+	const uint64_t glCalls = device.GetRunningTotal().issued - glCallsBefore.issued;
+	const uint64_t glCallsSkipped = device.GetRunningTotal().skipped - glCallsBefore.skipped;
+
+	printf("mjewels.renderer %s\n", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+	printf("mjewels.frames %zu\n", frameMs.size());
+	printf("mjewels.frame_ms_p50 %.3f\n", Bench::Percentile(frameMs, 50.0));
+	printf("mjewels.frame_ms_p95 %.3f\n", Bench::Percentile(frameMs, 95.0));
+	printf("mjewels.frame_ms_p99 %.3f\n", Bench::Percentile(frameMs, 99.0));
+	printf("mjewels.total_ms %.3f\n", totalMs);
+#ifdef COUNT_ALLOCATIONS
+	const uint64_t allocations = AllocCounter::GetCount() - allocationsBefore;
+	printf("mjewels.allocations %llu\n", (unsigned long long) allocations);
+	printf("mjewels.allocations_per_frame %.2f\n", frames > 0 ? double(allocations) / frames : 0.0);
+#endif
+	printf("mjewels.gl_calls %llu\n", (unsigned long long) glCalls);
+	printf("mjewels.gl_calls_per_frame %.2f\n", frames > 0 ? double(glCalls) / frames : 0.0);
+	printf("mjewels.gl_calls_skipped_per_frame %.2f\n", frames > 0 ? double(glCallsSkipped) / frames : 0.0);
+	return frameMs.size() == size_t(frameCount) ? 0 : 1;
+}
+
+//---
+
+/**
+ * Re-simulates a replay log without opening a window and prints the outcome.
+ * \return The exit code: 0 if the replay reproduced the recorded game exactly.
+ */
+static int RunReplayFile(const char* fileName)
+{
+	MappedFile log(fileName, MappedFile::Options{ .access = MappedFile::Access::kSequential });
+	if (!log.Ok()) {
+		std::cerr << "Could not map " << fileName << ": " << SDL_GetError() << std::endl;
+		return 1;
+	}
+	Bench::Stopwatch stopwatch;
+	const ReplayResult result = RunReplay(std::span<const uint8_t>(log.GetData(), log.GetSize()));
+	const double ms = stopwatch.ElapsedMs();
+	if (!result.ok) {
+		std::cerr << fileName << ": " << SDL_GetError() << std::endl;
+		return 1;
+	}
+
+	printf("replay.seed %llu\n", (unsigned long long) result.seed);
+	printf("replay.ticks %llu\n", (unsigned long long) result.ticks);
+	printf("replay.inputs %llu\n", (unsigned long long) result.inputs);
+	printf("replay.score %d\n", result.score);
+	printf("replay.ms %.3f\n", ms);
+	printf("replay.identical %d\n", result.identical ? 1 : 0);
+	return result.identical ? 0 : 1;
+}
+
+//---
+
+/// Queues an expose event, so that the event-driven mode redraws the window.
+static void RequestRedraw(SDL::Window &window)
+{
+	SDL_Event event = {};
+	event.type = SDL_WINDOWEVENT;
+	event.window.windowID = window.getID();
+	event.window.event = SDL_WINDOWEVENT_EXPOSED;
+	SDL_PushEvent(&event);
+}
 
 //---
 
 int main(int argc, const char** argv)
 {
+	// --bench [frames]: headless run with scripted input, printing frame statistics
+	// --record <file>: records the games played into a replay log
+	// --replay <file>: re-simulates a replay log headlessly and checks that it comes out the same
+	// --seed <number>: seed of the game (default: from the clock)
+	// --gpu-profile [file]: times the render passes on the GPU, with an overlay (F3 toggles it),
+	//   and writes the per-frame times as CSV at exit
+	// --trace <file>: writes the CPU zones recorded (in a build with PROFILE_ZONES) as Chrome trace JSON at exit
+	PROFILE_THREAD_NAME("main");
+	bool benchmark = false;
+	int benchFrames = kDefBenchFrames;
+	const char* recordFileName = nullptr;
+	const char* replayFileName = nullptr;
+	std::optional<uint64_t> seed;
+	const char* gpuProfileFileName = nullptr;
+	const char* traceFileName = nullptr;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--bench") == 0) {
+			benchmark = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-') benchFrames = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+			recordFileName = argv[++i];
+		}
+		else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+			replayFileName = argv[++i];
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			seed = strtoull(argv[++i], nullptr, 10);
+		}
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+			traceFileName = argv[++i];
+		}
+		else if (strcmp(argv[i], "--gpu-profile") == 0) {
+			gpuProfileFileName = (i + 1 < argc && argv[i + 1][0] != '-') ? argv[++i] : kDefGpuProfileFile;
+		}
+		else {
+			std::cerr << "usage: " << argv[0] << " [--bench [frames]] [--record file] [--replay file] [--seed number]"
+				" [--gpu-profile [file]] [--trace file]" << std::endl;
+			return 1;
+		}
+	}
+
+	if (replayFileName) {
+		const int replayExitCode = RunReplayFile(replayFileName);
+		if (traceFileName && !Profiler::WriteChromeTrace(traceFileName)) {
+			std::cerr << SDL_GetError() << std::endl;
+			return 1;
+		}
+		return replayExitCode;
+	}
+	if (benchmark) {
+		Bench::UseHeadlessVideo();
+	}
+
 	SDL::Library libSDL;
 
-	// set locale (important otherwise the default is C and we don't have Unicode!)
-	std::locale::global(std::locale("en_US.UTF-8"));
+	// The assets are read in on a background thread while the window and GL context are created.
+	// The font comes from the asset pack if there is one, otherwise from the system fonts.
+	const MappedFile::Options prefetchOptions{ .access = MappedFile::Access::kRandom, .prefetch = true };
+	AssetPack assets(kDefAssetPack, prefetchOptions);
+	std::unique_ptr<MappedFile> fontFile;
+	std::span<const uint8_t> fontData;
+	if (!assets.Ok() || !assets.Find(kDefFontAsset, fontData)) {
+		fontFile = std::make_unique<MappedFile>(kDefFontFile, prefetchOptions);
+		if (!fontFile->Ok()) {
+			std::cerr << "Could not map " << kDefFontFile << ": " << SDL_GetError() << std::endl;
+			return 1;
+		}
+		fontData = std::span<const uint8_t>(fontFile->GetData(), fontFile->GetSize());
+	}
+
+	SDL::Window window(kDefWindowTitle, kDefWindowWidth, kDefWindowHeight, benchmark ? SDL_WINDOW_HIDDEN : 0);
+
+	assets.GetFile().WaitForPrefetch();
+	if (fontFile) fontFile->WaitForPrefetch();
+	Font font(fontData, Font::Settings{ .size = kDefFontSize });
+	if (!font.Ok()) {
+		std::cerr << "Could not load the font: " << SDL_GetError() << std::endl;
+		return 1;
+	}
+	GL::Device device;
+	TextRenderer textRenderer(device, font);
+	SpriteBatch sprites(device, GemSprites::SIZE, GemSprites::LAYER_COUNT, 4096);
+	GemSprites::Load(sprites);
+	std::optional<GpuProfiler> gpuProfiler;
+	bool gpuOverlay = true;
+	if (gpuProfileFileName) {
+		gpuProfiler.emplace();
+	}
 
-	SDL::Window window(kDefWindowTitle, kDefWindowWidth, kDefWindowHeight);
+	// the game runs (and is recorded) only while it is on screen; the title screen waits for events
+	Game game(seed ? *seed : SDL_GetPerformanceCounter());
+	std::optional<ReplayRecorder> recorder;
+	if (recordFileName) {
+		recorder.emplace(game.GetSeed(), game.GetColorCount());
+	}
+	auto deliver = [&game, &recorder](const GameInput &input) {
+		if (recorder) recorder->Record(game.GetTick(), input);
+		game.Apply(input);
+	};
 
 	SDL::EventLoop eventLoop(libSDL);
-	eventLoop.OnKey = [&eventLoop](const SDL_KeyboardEvent &event) {
+	auto startGame = [&eventLoop, &window]() {
+		eventLoop.SetFixedStepMode(window.getWindow(), Game::TICK_RATE);
+	};
+	eventLoop.OnKey = [&](const SDL_KeyboardEvent &event) {
+		const bool playing = (eventLoop.GetMode() == SDL::EventLoop::Mode::kFixedStep);
 		if (event.keysym.scancode == SDL_SCANCODE_ESCAPE) {
-			eventLoop.quitRequested = true;
+			if (playing) {
+				eventLoop.SetEventDrivenMode();
+				RequestRedraw(window);
+			}
+			else {
+				eventLoop.quitRequested = true;
+			}
+		}
+		else if (!playing && (event.keysym.sym == SDLK_SPACE || event.keysym.sym == SDLK_RETURN)) {
+			startGame();
+		}
+		else if (event.keysym.scancode == SDL_SCANCODE_F3) {
+			gpuOverlay = !gpuOverlay;
+		}
+	};
+
+	// the game takes its input once per frame: the clicks and key presses in order, then where the mouse ended up;
+	// OnKey has already seen the batch, so the mode it was taken in tells whether the game was on screen
+	eventLoop.OnInput = [&](const SDL::InputBatch &input) {
+		if (!input.fixedStep) return;
+		for (const SDL::InputEvent &event : input.events) {
+			if (event.type == SDL::InputEvent::Type::kKeyDown && event.scancode != SDL_SCANCODE_ESCAPE) {
+				deliver(GameInput{ GameInput::Type::kKey, event.key });
+			}
+			else if (event.type == SDL::InputEvent::Type::kButtonDown) {
+				deliver(GameInput{ GameInput::Type::kMouseButton, int32_t(event.button), event.x, event.y });
+			}
+		}
+		if (input.mouseMoved) {
+			deliver(GameInput{ GameInput::Type::kMouseMotion, 0, input.mouseX, input.mouseY });
 		}
 	};
-	eventLoop.OnRedraw = []() {
-		glClearColor(0.0f, 0.0f, 0.3f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
+	eventLoop.OnTick = [&game](double) {
+		game.Tick();
+	};
+	eventLoop.OnRender = [&](float) {
+		device.BeginFrame();
+		GpuProfiler* profiler = gpuProfiler ? &*gpuProfiler : nullptr;
+		if (profiler) profiler->BeginFrame();
+		GameView::Draw(device, game, font, textRenderer, sprites, kDefWindowWidth, kDefWindowHeight, profiler, gpuOverlay);
+	};
+	eventLoop.OnRedraw = [&device, &font, &textRenderer]() {
+		device.BeginFrame();
+		device.Viewport(0, 0, kDefWindowWidth, kDefWindowHeight);
+		device.ClearColor(0.0f, 0.0f, 0.3f, 1.0f);
+		device.Clear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
+
+		const std::u8string_view title = u8"Midnight Jewels";
+		const SDL_Rect titleSize = font.ComputeTextSize(title);
+		textRenderer.Begin(kDefWindowWidth, kDefWindowHeight);
+		textRenderer.AddText(title, float((kDefWindowWidth - titleSize.w) / 2), font.GetAscent() + 16.0f);
+		const std::u8string_view prompt = u8"Press Space to play";
+		const SDL_Rect promptSize = font.ComputeTextSize(prompt);
+		textRenderer.AddText(prompt, float((kDefWindowWidth - promptSize.w) / 2), float(kDefWindowHeight / 2));
+		textRenderer.Flush();
 	};
-	eventLoop.Run();
 
-	return 0;
+	int exitCode = 0;
+	if (benchmark) {
+		// straight into the game, with frame pacing off (as fast as it goes)
+		eventLoop.SetFixedStepMode(window.getWindow(), Game::TICK_RATE, 1000000);
+		exitCode = RunBenchmark(eventLoop, window, device, benchFrames);
+		printf("mjewels.game_ticks %llu\n", (unsigned long long) game.GetTick());
+		printf("mjewels.game_score %d\n", game.GetScore());
+		if (gpuProfiler) {
+			for (int pass = 0; pass < GpuProfiler::PASS_COUNT; pass++) {
+				const GpuProfiler::Pass passId = GpuProfiler::Pass(pass);
+				printf("mjewels.gpu_%s_ms %.4f\n", GpuProfiler::GetPassName(passId), gpuProfiler->GetStats(passId).averageMs);
+			}
+			printf("mjewels.gpu_frames_measured %llu\n", (unsigned long long) gpuProfiler->GetMeasuredFrames());
+			printf("mjewels.gpu_frames_late %llu\n", (unsigned long long) gpuProfiler->GetLateFrames());
+		}
+	}
+	else {
+		eventLoop.Run();
+	}
+
+	if (traceFileName && !Profiler::WriteChromeTrace(traceFileName)) {
+		std::cerr << SDL_GetError() << std::endl;
+		exitCode = 1;
+	}
+	if (gpuProfiler && !gpuProfiler->WriteCsv(gpuProfileFileName)) {
+		std::cerr << SDL_GetError() << std::endl;
+		exitCode = 1;
+	}
+	if (recorder) {
+		recorder->Finish(game.GetTick(), game.GetStateHash());
+		if (!recorder->Save(recordFileName)) {
+			std::cerr << SDL_GetError() << std::endl;
+			return 1;
+		}
+	}
+	return exitCode;
 }
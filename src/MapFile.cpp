@@ -1,4 +1,5 @@
 #include "MapFile.h"
+#include "Profiler.h"
 #include "SDL.h"
 #include <sys/mman.h>
 #include <sys/stat.h>
@@ -6,7 +7,13 @@
 #include <unistd.h>
 
 MappedFile::MappedFile(const char* fileName)
+	: MappedFile(fileName, Options())
 {
+}
+
+MappedFile::MappedFile(const char* fileName, const Options &options)
+{
+	PROFILE_ZONE("MappedFile::MappedFile");
 	int f = open(fileName, O_RDONLY);
 	if (f < 0) {
 		SDL_SetError("open() failed");
@@ -22,8 +29,9 @@ MappedFile::MappedFile(const char* fileName)
 
 	size_t mappedSize = fileMetadata.st_size;
 
-	data = static_cast<uint8_t*>(mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, f, 0));
-	if (data == MAP_FAILED) {
+	const int flags = MAP_PRIVATE | (options.populate ? MAP_POPULATE : 0);
+	void* mapped = mmap(nullptr, mappedSize, PROT_READ, flags, f, 0);
+	if (mapped == MAP_FAILED) {
 		SDL_SetError("mmap() failed");
 		close(f);
 		return;
@@ -31,8 +39,20 @@ MappedFile::MappedFile(const char* fileName)
 
 	close(f);	// no more needed, mapping persists
 
-	data = data;
+	data = static_cast<uint8_t*>(mapped);
 	byteSize = mappedSize;
+
+#ifdef MADV_HUGEPAGE
+	if (options.hugePages) {
+		madvise(data, byteSize, MADV_HUGEPAGE);	// a hint only, failure is fine
+	}
+#endif
+	if (options.access != Access::kNormal) {
+		Advise(options.access);
+	}
+	if (options.prefetch) {
+		PrefetchAsync();
+	}
 }
 
 MappedFile::~MappedFile()
@@ -42,9 +62,61 @@ MappedFile::~MappedFile()
 
 void MappedFile::Unmap()
 {
-	if (!data) {
+	if (prefetchThread.joinable()) {
+		prefetchCancelled = true;
+		prefetchThread.join();
+	}
+	if (data) {
 		munmap(data, byteSize);
 	}
 	data = nullptr;
 	byteSize = 0;
+	prefetched = false;
+	prefetchCancelled = false;
+}
+
+void MappedFile::Advise(Access access)
+{
+	if (!data) return;
+
+	int advice = MADV_NORMAL;
+	switch (access) {
+		case Access::kNormal: advice = MADV_NORMAL; break;
+		case Access::kSequential: advice = MADV_SEQUENTIAL; break;
+		case Access::kRandom: advice = MADV_RANDOM; break;
+		case Access::kWillNeed: advice = MADV_WILLNEED; break;
+	}
+	madvise(data, byteSize, advice);
+}
+
+void MappedFile::PrefetchAsync()
+{
+	if (!data || prefetchThread.joinable()) return;
+	prefetchThread = std::thread(&MappedFile::Prefetch, this);
+}
+
+void MappedFile::WaitForPrefetch()
+{
+	PROFILE_ZONE("MappedFile::WaitForPrefetch");
+	if (prefetchThread.joinable()) {
+		prefetchThread.join();
+	}
+}
+
+void MappedFile::Prefetch()
+{
+	PROFILE_THREAD_NAME("prefetch");
+	PROFILE_ZONE("MappedFile::Prefetch");
+	// let the kernel read ahead the whole file, then take the page faults
+	// here instead of on the thread that uses the data
+	madvise(data, byteSize, MADV_WILLNEED);
+
+	const size_t pageSize = size_t(sysconf(_SC_PAGESIZE));
+	uint8_t sum = 0;
+	for (size_t offset = 0; offset < byteSize; offset += pageSize) {
+		if (prefetchCancelled.load(std::memory_order_relaxed)) return;
+		sum += *static_cast<volatile const uint8_t*>(data + offset);
+	}
+	(void) sum;
+	prefetched.store(true, std::memory_order_release);
 }
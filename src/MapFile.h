@@ -1,17 +1,45 @@
 #pragma once
 #include <cstdint>
 #include <cstddef>
+#include <atomic>
+#include <thread>
 
 class MappedFile
 {
 public:
 
+	/// Expected access pattern, passed to the kernel with madvise().
+	enum class Access {
+		kNormal,		///< No hint (MADV_NORMAL).
+		kSequential,	///< Read front to back, aggressive readahead (MADV_SEQUENTIAL).
+		kRandom,		///< Scattered reads, no readahead (MADV_RANDOM).
+		kWillNeed,		///< Start reading the whole file in now (MADV_WILLNEED).
+	};
+
+	/// How the file is mapped.
+	struct Options {
+		Access access = Access::kNormal;
+
+		/// Fault in all pages within mmap() (MAP_POPULATE), so that the
+		/// constructor returns only after the whole file has been read.
+		bool populate = false;
+
+		/// Start PrefetchAsync() right away.
+		bool prefetch = false;
+
+		/// Ask for transparent huge pages (MADV_HUGEPAGE), reducing TLB misses
+		/// on big files. Only a hint; most filesystems ignore it for file mappings.
+		bool hugePages = false;
+	};
+
 	/**
 	 * Maps the contents of the file to memory.
 	 * On error, the resulting object is invalid, and a terse error description
 	 * is stored using SDL_SetError().
 	 */
 	MappedFile(const char* fileName);
+	MappedFile(const char* fileName, const Options &options);
+	MappedFile(const MappedFile&) = delete;
 
 	/**
 	 * Calls Unmap().
@@ -20,15 +48,39 @@ public:
 
 	/**
 	 * Unmaps the file from memory, invalidating the object.
+	 * A running prefetch is stopped first.
 	 */
 	void Unmap();
 
+	/// Changes the access pattern hint for the whole file.
+	void Advise(Access access);
+
+	/**
+	 * Starts reading the whole file into the page cache and faulting in its
+	 * pages on a background thread, so that the caller can do other startup
+	 * work (e.g. create the window and the GL context) in the meantime.
+	 * Does nothing if a prefetch was already started.
+	 */
+	void PrefetchAsync();
+
+	/// Waits until the prefetch started by PrefetchAsync() is done (returns at once if there is none).
+	void WaitForPrefetch();
+
+	/// Returns true when all pages have been touched by the prefetch.
+	bool IsPrefetched() const { return prefetched.load(std::memory_order_acquire); }
+
 	bool Ok() const { return (data != nullptr); }
 	uint8_t* GetData() { return data; }
 	const uint8_t* GetData() const { return data; }
 	size_t GetSize() const { return byteSize; }
 
 protected:
+
+	void Prefetch();
+
 	uint8_t* data = nullptr;
 	size_t byteSize = 0;
+	std::thread prefetchThread;
+	std::atomic<bool> prefetched = false;
+	std::atomic<bool> prefetchCancelled = false;
 };
@@ -0,0 +1,201 @@
+#include "MoveSearch.h"
+
+#include <cstring>
+#include <new>
+
+namespace {
+
+/// Positions evaluated between two looks at the clock.
+const uint64_t kDeadlineCheckInterval = 32;
+
+//---
+
+/// Seed of a sampled refill: different for every sample of every position.
+uint64_t SampleSeed(uint64_t positionHash, int sample)
+{
+	return positionHash + 0x9e3779b97f4a7c15ull * uint64_t(sample + 1);
+}
+
+//---
+
+uint64_t PackEntry(int depth, float value)
+{
+	uint32_t valueBits;
+	memcpy(&valueBits, &value, sizeof(valueBits));
+	return (uint64_t(valueBits) << 32) | uint64_t(depth);
+}
+
+} // namespace
+
+//---
+
+MoveSearch::MoveSearch(ThreadPool &threadPool_, size_t tableSize)
+	: threadPool(threadPool_)
+{
+	for (int i = 0; i <= threadPool.GetThreadCount(); i++) {
+		workers.push_back(std::make_unique<Worker>());
+	}
+
+	size_t size = 1;
+	while (size < tableSize) size <<= 1;
+	table = std::make_unique<Entry[]>(size);
+	tableMask = size - 1;
+}
+
+//---
+
+void MoveSearch::ClearTable()
+{
+	for (size_t i = 0; i <= tableMask; i++) {
+		table[i].check.store(0, std::memory_order_relaxed);
+		table[i].data.store(0, std::memory_order_relaxed);
+	}
+}
+
+//---
+
+MoveSearch::Result MoveSearch::Search(const Board &board, const Settings &settings_)
+{
+	const Clock::time_point start = Clock::now();
+	if (settings_.samples != settings.samples || settings_.futureWeight != settings.futureWeight) {
+		ClearTable();
+	}
+	settings = settings_;
+	if (settings.samples < 1) settings.samples = 1;
+	deadline = start + std::chrono::duration_cast<Clock::duration>(
+		std::chrono::duration<double, std::milli>(settings.timeBudgetMs));
+	aborted.store(false);
+	for (auto &worker : workers) {
+		worker->arena.Reset();
+		worker->nodes = worker->tableHits = 0;
+	}
+
+	Result result;
+	Board::Move moves[Board::MAX_MOVES];
+	const int moveCount = board.FindMoves(moves);
+	result.found = (moveCount > 0);
+
+	const int samples = settings.samples;
+	std::vector<float> sampleValues(size_t(moveCount) * samples);
+	for (int depth = 1; depth <= settings.maxDepth && moveCount > 0; depth++) {
+
+		// the first round is cheap and always completes, so that there is an answer
+		checkDeadline = (depth > 1 && settings.timeBudgetMs > 0.0);
+		threadPool.ParallelFor(moveCount * samples, [&](int task) {
+			sampleValues[task] = EvaluateSample(board, moves[task / samples], task % samples, depth, GetWorker());
+		});
+		if (aborted.load()) break;
+
+		int best = 0;
+		float bestValue = -1.0f;
+		for (int m = 0; m < moveCount; m++) {
+			float value = 0.0f;
+			for (int s = 0; s < samples; s++) {
+				value += sampleValues[size_t(m) * samples + s];
+			}
+			value /= float(samples);
+			if (value > bestValue) {
+				best = m;
+				bestValue = value;
+			}
+		}
+		result.move = moves[best];
+		result.value = bestValue;
+		result.completedDepth = depth;
+	}
+
+	for (const auto &worker : workers) {
+		result.nodes += worker->nodes;
+		result.tableHits += worker->tableHits;
+	}
+	result.elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	return result;
+}
+
+//---
+
+MoveSearch::Worker& MoveSearch::GetWorker()
+{
+	const int index = threadPool.GetCurrentWorker();
+	return *workers[(index >= 0) ? index : workers.size() - 1];
+}
+
+//---
+
+float MoveSearch::Evaluate(const Board &board, int depth, Worker &worker)
+{
+	if (aborted.load(std::memory_order_relaxed)) return 0.0f;
+
+	const uint64_t hash = board.GetHash();
+	float best = 0.0f;
+	if (Probe(hash, depth, best)) {
+		worker.tableHits++;
+		return best;
+	}
+
+	const Arena::Marker marker = worker.arena.GetMarker();
+	Board::Move* moves = worker.arena.Allocate<Board::Move>(Board::MAX_MOVES);
+	const int moveCount = board.FindMoves(moves);
+	for (int m = 0; m < moveCount; m++) {
+		float value = 0.0f;
+		for (int s = 0; s < settings.samples; s++) {
+			value += EvaluateSample(board, moves[m], s, depth, worker);
+		}
+		value /= float(settings.samples);
+		if (value > best) best = value;
+	}
+	worker.arena.Release(marker);
+
+	// a value cut short by the deadline is not worth keeping
+	if (!aborted.load(std::memory_order_relaxed)) {
+		Store(hash, depth, best);
+	}
+	return best;
+}
+
+//---
+
+float MoveSearch::EvaluateSample(const Board &board, const Board::Move &move, int sample, int depth, Worker &worker)
+{
+	worker.nodes++;
+	if (checkDeadline && worker.nodes % kDeadlineCheckInterval == 0 && Clock::now() >= deadline) {
+		aborted.store(true, std::memory_order_relaxed);
+	}
+	if (aborted.load(std::memory_order_relaxed)) return 0.0f;
+
+	const Arena::Marker marker = worker.arena.GetMarker();
+	Board* child = new (worker.arena.Allocate<Board>()) Board(board);
+	child->Apply(move);
+
+	Random random(SampleSeed(child->GetHash(), sample));
+	float value = float(child->Resolve(random).score);
+	if (depth > 1) {
+		value += settings.futureWeight * Evaluate(*child, depth - 1, worker);
+	}
+	worker.arena.Release(marker);
+	return value;
+}
+
+//---
+
+bool MoveSearch::Probe(uint64_t hash, int depth, float &value) const
+{
+	const Entry &entry = table[hash & tableMask];
+	const uint64_t data = entry.data.load(std::memory_order_relaxed);
+	const uint64_t check = entry.check.load(std::memory_order_relaxed);
+	if ((check ^ data) != hash || int(data & 0xff) != depth) return false;
+
+	const uint32_t valueBits = uint32_t(data >> 32);
+	memcpy(&value, &valueBits, sizeof(value));
+	return true;
+}
+
+//---
+
+void MoveSearch::Store(uint64_t hash, int depth, float value)
+{
+	Entry &entry = table[hash & tableMask];
+	const uint64_t data = PackEntry(depth, value);
+	entry.data.store(data, std::memory_order_relaxed);
+	entry.check.store(hash ^ data, std::memory_order_relaxed);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "Board.h"
+#include "Arena.h"
+#include "ThreadPool.h"
+
+/**
+ * Looks for the best swap on a board, for hints and the bot player:
+ * expectimax over the valid swaps, where the gems falling in after a swap
+ * are unknown and averaged over a few sampled refills. Searches one move
+ * deeper at a time until the time budget runs out, and answers with the
+ * deepest search that completed. The (move, sample) pairs at the root are
+ * spread over a ThreadPool; positions are cached in a transposition table
+ * keyed by Board::GetHash() and shared by all threads without locks.
+ *
+ * The samples are seeded from the position, so a position always gets the
+ * same value (whatever the thread count), which is what makes caching it valid.
+ */
+class MoveSearch
+{
+public:
+
+	static const size_t DEFAULT_TABLE_SIZE = size_t(1) << 20;
+
+	struct Settings {
+		int maxDepth = 4;				///< Moves to look ahead, at most.
+		int samples = 3;				///< Refills averaged after each swap.
+		double timeBudgetMs = 50.0;		///< Time to answer in; 0 means search to maxDepth (one move is always searched fully).
+		float futureWeight = 0.9f;		///< Weight of the points of each following move.
+	};
+
+	struct Result {
+		bool found = false;				///< False if there is no valid move.
+		Board::Move move {};
+		float value = 0.0f;				///< Expected (weighted) points of the move over completedDepth moves.
+		int completedDepth = 0;
+		uint64_t nodes = 0;				///< Positions reached by a swap and a sampled refill.
+		uint64_t tableHits = 0;			///< Positions whose value came from the table.
+		double elapsedMs = 0.0;
+	};
+
+	/// tableSize (entries, 16 bytes each) is rounded up to a power of two.
+	explicit MoveSearch(ThreadPool &threadPool, size_t tableSize = DEFAULT_TABLE_SIZE);
+	MoveSearch(const MoveSearch&) = delete;
+
+	/// Searches the board. Not reentrant: one search at a time per MoveSearch.
+	Result Search(const Board &board, const Settings &settings);
+
+	/// Forgets the cached positions (done automatically when the settings change).
+	void ClearTable();
+
+protected:
+
+	using Clock = std::chrono::steady_clock;
+
+	/// Scratch and counters of one thread, on a cache line of its own.
+	struct alignas(64) Worker {
+		Arena arena;
+		uint64_t nodes = 0;
+		uint64_t tableHits = 0;
+	};
+
+	/// Transposition table entry; `check` is the hash xor `data`, so that a torn write is seen as a miss.
+	struct Entry {
+		std::atomic<uint64_t> check { 0 };
+		std::atomic<uint64_t> data { 0 };
+	};
+
+	Worker& GetWorker();
+
+	/// Expected points of the best move over `depth` moves.
+	float Evaluate(const Board &board, int depth, Worker &worker);
+
+	/// Points of the move after one sampled refill, plus (weighted) the value of the position it leads to.
+	float EvaluateSample(const Board &board, const Board::Move &move, int sample, int depth, Worker &worker);
+
+	bool Probe(uint64_t hash, int depth, float &value) const;
+	void Store(uint64_t hash, int depth, float value);
+
+	ThreadPool &threadPool;
+	std::vector<std::unique_ptr<Worker>> workers;	///< One per pool thread, the last for the thread calling Search().
+	std::unique_ptr<Entry[]> table;
+	size_t tableMask;
+
+	Settings settings;
+	Clock::time_point deadline;
+	bool checkDeadline = false;
+	std::atomic<bool> aborted { false };
+};
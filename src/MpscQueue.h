@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <type_traits>
+
+/**
+ * Bounded lock-free queue for many producer threads and one consumer
+ * (D. Vyukov's bounded queue): every slot carries a sequence number that
+ * says whether it is free for the producer at a given position or holds
+ * a value for the consumer. Producers claim positions with one CAS, the
+ * consumer takes values without any atomic read-modify-write. Neither
+ * side locks or allocates; the memory is allocated once, on construction.
+ */
+template <typename T>
+class MpscQueue
+{
+public:
+
+	static_assert(std::is_nothrow_copy_assignable_v<T>, "values are copied into place, which must not throw");
+
+	/// capacity is rounded up to a power of two.
+	explicit MpscQueue(size_t capacity)
+	{
+		size_t size = 2;
+		while (size < capacity) size <<= 1;
+		slots = std::make_unique<Slot[]>(size);
+		for (size_t i = 0; i < size; i++) {
+			slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+		mask = size - 1;
+	}
+
+	MpscQueue(const MpscQueue&) = delete;
+
+	size_t GetCapacity() const { return mask + 1; }
+
+	/// Adds a value; callable from any thread. \return False if the queue is full.
+	bool TryPush(const T &value)
+	{
+		size_t position = tail.load(std::memory_order_relaxed);
+		Slot* slot;
+		while (1) {
+			slot = &slots[position & mask];
+			const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+			const intptr_t difference = intptr_t(sequence) - intptr_t(position);
+			if (difference == 0) {
+				if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+			}
+			else if (difference < 0) {
+				return false;	// the slot still holds the value from a lap ago
+			}
+			else {
+				position = tail.load(std::memory_order_relaxed);
+			}
+		}
+		slot->value = value;
+		slot->sequence.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Takes the oldest value; only the consumer thread may call this.
+	 * \return False if the queue is empty (or the oldest value is still being written).
+	 */
+	bool TryPop(T &value)
+	{
+		Slot &slot = slots[head & mask];
+		if (slot.sequence.load(std::memory_order_acquire) != head + 1) return false;
+		value = slot.value;
+		slot.sequence.store(head + mask + 1, std::memory_order_release);
+		head++;
+		return true;
+	}
+
+	/// True if there seems to be nothing to pop (exact only on the consumer thread with no producers active).
+	bool IsEmpty() const
+	{
+		return slots[head & mask].sequence.load(std::memory_order_acquire) != head + 1;
+	}
+
+protected:
+
+	struct Slot {
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	std::unique_ptr<Slot[]> slots;
+	size_t mask = 0;
+
+	// on separate cache lines: the producers contend on the tail, the consumer owns the head
+	alignas(64) std::atomic<size_t> tail { 0 };
+	alignas(64) size_t head = 0;
+};
@@ -0,0 +1,44 @@
+#include "AssetPack.h"
+#include "SDL.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// mjpack: builds an AssetPack.
+// Each file is stored under its path as given, or under NAME for NAME=PATH.
+
+//---
+
+int main(int argc, const char** argv)
+{
+	if (argc < 3) {
+		printf("usage: %s <output.pack> <file | name=file>...\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<AssetPack::Source> sources;
+	for (int i = 2; i < argc; i++) {
+		const char* separator = strchr(argv[i], '=');
+		if (separator) {
+			sources.push_back(AssetPack::Source{ std::string(argv[i], separator), std::string(separator + 1) });
+		}
+		else {
+			sources.push_back(AssetPack::Source{ argv[i], argv[i] });
+		}
+	}
+
+	if (!AssetPack::Write(argv[1], sources)) {
+		fprintf(stderr, "%s: %s\n", argv[0], SDL_GetError());
+		return 1;
+	}
+
+	AssetPack pack(argv[1]);
+	if (!pack.Ok()) {
+		fprintf(stderr, "%s: the written pack does not validate: %s\n", argv[0], SDL_GetError());
+		return 1;
+	}
+	printf("%s: %zu assets, %zu bytes\n", argv[1], pack.GetEntryCount(), pack.GetFile().GetSize());
+	return 0;
+}
@@ -0,0 +1,230 @@
+#include "Profiler.h"
+
+#include "SDL.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Profiler {
+
+namespace {
+
+/**
+ * Part of a thread's buffer. Only the owning thread writes; it publishes
+ * each event by the release store of `count`, and each new chunk by that
+ * of `next`, so that the exporter can read along without locks.
+ */
+struct Chunk {
+	Event events[CHUNK_EVENTS];
+	std::atomic<uint32_t> count{ 0 };
+	std::atomic<Chunk*> next{ nullptr };
+};
+
+/// A thread's buffer: a list of chunks, kept after the thread ends (until the process does).
+struct ThreadBuffer {
+	explicit ThreadBuffer(uint32_t trackId_) : trackId(trackId_), head(new Chunk), current(head) {}
+	~ThreadBuffer()
+	{
+		for (Chunk* chunk = head; chunk; ) {
+			Chunk* next = chunk->next.load();
+			delete chunk;
+			chunk = next;
+		}
+	}
+
+	uint32_t trackId;
+	std::string name;				///< Guarded by the registry's mutex.
+	Chunk* head;
+	Chunk* current;					///< Owning thread only.
+	int chunkCount = 1;				///< Owning thread only.
+	std::atomic<uint64_t> dropped{ 0 };
+};
+
+/// All the threads' buffers; the mutex is taken only when a thread records its first zone, and to export.
+struct Registry {
+	std::mutex mutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+};
+
+Registry& GetRegistry()
+{
+	static Registry registry;
+	return registry;
+}
+
+std::atomic<const char*> names[MAX_NAMES] = { };
+std::atomic<uint32_t> nameCount{ 1 };	// 0 is "?"
+
+thread_local ThreadBuffer* threadBuffer = nullptr;
+thread_local bool threadNamed = false;
+
+//---
+
+ThreadBuffer& GetThreadBuffer()
+{
+	if (!threadBuffer) {
+		Registry &registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		registry.buffers.push_back(std::make_unique<ThreadBuffer>(uint32_t(registry.buffers.size() + 1)));
+		threadBuffer = registry.buffers.back().get();
+	}
+	return *threadBuffer;
+}
+
+//---
+
+/// Writes a string as a JSON string literal.
+void WriteJsonString(FILE* f, const char* text)
+{
+	fputc('"', f);
+	for (const char* c = text; *c; c++) {
+		if (*c == '"' || *c == '\\') fputc('\\', f);
+		if (uint8_t(*c) < 0x20) continue;
+		fputc(*c, f);
+	}
+	fputc('"', f);
+}
+
+} // namespace
+
+//---
+
+uint32_t RegisterName(const char* name)
+{
+	const uint32_t id = nameCount.fetch_add(1);
+	if (id >= uint32_t(MAX_NAMES)) return 0;
+	names[id].store(name, std::memory_order_release);
+	return id;
+}
+
+//---
+
+void SetThreadName(const char* name)
+{
+	// called on every timer callback, for one: only the first call takes the lock
+	if (threadNamed) return;
+	threadNamed = true;
+	ThreadBuffer &buffer = GetThreadBuffer();
+	std::lock_guard<std::mutex> lock(GetRegistry().mutex);
+	if (buffer.name.empty()) buffer.name = name;
+}
+
+//---
+
+void Record(uint32_t nameId, uint64_t startNs, uint64_t endNs)
+{
+	ThreadBuffer &buffer = GetThreadBuffer();
+	Chunk* chunk = buffer.current;
+	uint32_t count = chunk->count.load(std::memory_order_relaxed);
+	if (count == uint32_t(CHUNK_EVENTS)) {
+		if (buffer.chunkCount == MAX_CHUNKS_PER_THREAD) {
+			buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		Chunk* next = new Chunk;
+		buffer.chunkCount++;
+		chunk->next.store(next, std::memory_order_release);
+		buffer.current = chunk = next;
+		count = 0;
+	}
+	chunk->events[count] = Event{ startNs, uint32_t(std::min<uint64_t>(endNs - startNs, UINT32_MAX)), nameId };
+	chunk->count.store(count + 1, std::memory_order_release);
+}
+
+//---
+
+uint64_t GetEventCount()
+{
+	Registry &registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	uint64_t count = 0;
+	for (const auto &buffer : registry.buffers) {
+		for (const Chunk* chunk = buffer->head; chunk; chunk = chunk->next.load(std::memory_order_acquire)) {
+			count += chunk->count.load(std::memory_order_acquire);
+		}
+	}
+	return count;
+}
+
+//---
+
+uint64_t GetDroppedCount()
+{
+	Registry &registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	uint64_t count = 0;
+	for (const auto &buffer : registry.buffers) {
+		count += buffer->dropped.load(std::memory_order_relaxed);
+	}
+	return count;
+}
+
+//---
+
+bool WriteChromeTrace(const char* fileName)
+{
+	FILE* f = fopen(fileName, "w");
+	if (!f) {
+		SDL_SetError("Profiler::WriteChromeTrace(): could not create %s", fileName);
+		return false;
+	}
+
+	const uint32_t knownNames = std::min(nameCount.load(), uint32_t(MAX_NAMES));
+	auto nameOf = [knownNames](uint32_t nameId) {
+		const char* name = (nameId < knownNames) ? names[nameId].load(std::memory_order_acquire) : nullptr;
+		return name ? name : "?";
+	};
+
+	// the buffers stay as long as the process, but the list may grow meanwhile
+	Registry &registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	// times count from the earliest zone
+	uint64_t epochNs = UINT64_MAX;
+	for (const auto &buffer : registry.buffers) {
+		for (const Chunk* chunk = buffer->head; chunk; chunk = chunk->next.load(std::memory_order_acquire)) {
+			const uint32_t count = chunk->count.load(std::memory_order_acquire);
+			for (uint32_t i = 0; i < count; i++) {
+				epochNs = std::min(epochNs, chunk->events[i].startNs);
+			}
+		}
+	}
+
+	fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	bool first = true;
+	for (const auto &buffer : registry.buffers) {
+		char fallbackName[32];
+		snprintf(fallbackName, sizeof(fallbackName), "thread %u", buffer->trackId);
+		fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+			first ? "" : ",\n", buffer->trackId);
+		WriteJsonString(f, buffer->name.empty() ? fallbackName : buffer->name.c_str());
+		fprintf(f, "}}");
+		first = false;
+
+		for (const Chunk* chunk = buffer->head; chunk; chunk = chunk->next.load(std::memory_order_acquire)) {
+			const uint32_t count = chunk->count.load(std::memory_order_acquire);
+			for (uint32_t i = 0; i < count; i++) {
+				const Event &event = chunk->events[i];
+				fprintf(f, ",\n{\"name\":");
+				WriteJsonString(f, nameOf(event.nameId));
+				fprintf(f, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+					buffer->trackId, double(event.startNs - epochNs) * 1e-3, double(event.durationNs) * 1e-3);
+			}
+		}
+	}
+	fprintf(f, "\n]}\n");
+
+	const bool failed = (ferror(f) != 0);
+	if (fclose(f) != 0 || failed) {
+		SDL_SetError("Profiler::WriteChromeTrace(): could not write %s", fileName);
+		return false;
+	}
+	return true;
+}
+
+} // namespace Profiler
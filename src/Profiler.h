@@ -0,0 +1,93 @@
+#pragma once
+
+// Timing zones for CPU profiling: PROFILE_ZONE("name") times the rest of the
+// enclosing scope on the calling thread. Each thread records into buffers of
+// its own, without locks, and WriteChromeTrace() exports everything recorded
+// as Chrome trace-event JSON (for chrome://tracing or ui.perfetto.dev), a
+// track per thread. The macros compile to nothing unless PROFILE_ZONES is
+// defined (make PROFILE=1); the functions below are always there, so a build
+// without zones simply exports an empty trace.
+
+#include <cstdint>
+#include <chrono>
+
+namespace Profiler {
+
+/**
+ * A recorded zone, as stored in the per-thread buffers: 16 bytes.
+ * Zones longer than about 4.29 s are recorded as that long.
+ */
+struct Event {
+	uint64_t startNs;		///< See NowNs().
+	uint32_t durationNs;
+	uint32_t nameId;		///< See RegisterName().
+};
+
+/// Events per chunk of a thread's buffer (64 KiB), and chunks per thread at most.
+static const int CHUNK_EVENTS = 4096;
+static const int MAX_CHUNKS_PER_THREAD = 256;
+
+/// Most distinct zone names.
+static const int MAX_NAMES = 1024;
+
+/// Steady clock time in nanoseconds (from an arbitrary point; the export counts from the first zone).
+inline uint64_t NowNs()
+{
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * Registers a zone name (which must outlive the profiler, e.g. a string
+ * literal); thread-safe. \return Its id, or 0 ("?") once MAX_NAMES are taken.
+ */
+uint32_t RegisterName(const char* name);
+
+/// Names the calling thread's track in the trace (copied). The first name given wins; later calls only check a thread-local flag.
+void SetThreadName(const char* name);
+
+/// Appends a zone to the calling thread's buffer; drops it if the buffer is full.
+void Record(uint32_t nameId, uint64_t startNs, uint64_t endNs);
+
+/// Zones recorded and dropped so far, over all threads.
+uint64_t GetEventCount();
+uint64_t GetDroppedCount();
+
+/**
+ * Writes all zones recorded so far as Chrome trace-event JSON. Threads may
+ * keep recording meanwhile (what they add may or may not make it in).
+ * \return False on failure (see SDL_GetError()).
+ */
+bool WriteChromeTrace(const char* fileName);
+
+//---
+
+/// Records a zone from construction to destruction; see PROFILE_ZONE().
+class Zone
+{
+public:
+
+	explicit Zone(uint32_t nameId_) : nameId(nameId_), startNs(NowNs()) {}
+	Zone(const Zone&) = delete;
+	~Zone() { Record(nameId, startNs, NowNs()); }
+
+protected:
+
+	uint32_t nameId;
+	uint64_t startNs;
+};
+
+} // namespace Profiler
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#ifdef PROFILE_ZONES
+#define PROFILE_ZONE(name) \
+	static const uint32_t PROFILE_CONCAT(profileNameId, __LINE__) = ::Profiler::RegisterName(name); \
+	::Profiler::Zone PROFILE_CONCAT(profileZone, __LINE__)(PROFILE_CONCAT(profileNameId, __LINE__))
+#define PROFILE_THREAD_NAME(name) ::Profiler::SetThreadName(name)
+#else
+#define PROFILE_ZONE(name) ((void) 0)
+#define PROFILE_THREAD_NAME(name) ((void) 0)
+#endif
@@ -0,0 +1,212 @@
+#include "Replay.h"
+
+#include "SDL.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace {
+
+enum RecordType {
+	kKeyRecord = 0,
+	kButtonRecord = 1,
+	kMotionRecord = 2,
+	kEndRecord = 3
+};
+
+const size_t kHeaderSize = 24;
+
+//---
+
+/// Reads the log; each read fails (returns false) at the end of the data instead of reading past it.
+class LogReader
+{
+public:
+
+	explicit LogReader(std::span<const uint8_t> data_) : data(data_) {}
+
+	bool ReadVarint(uint64_t &value) {
+		value = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			if (position >= data.size()) return false;
+			const uint8_t byte = data[position++];
+			value |= uint64_t(byte & 0x7f) << shift;
+			if (!(byte & 0x80)) return true;
+		}
+		return false;	// too long to be a varint
+	}
+
+	bool ReadSigned(int64_t &value) {
+		uint64_t encoded;
+		if (!ReadVarint(encoded)) return false;
+		value = int64_t(encoded >> 1) ^ -int64_t(encoded & 1);
+		return true;
+	}
+
+	bool ReadFixed(void* out, size_t size) {
+		if (data.size() - position < size) return false;
+		memcpy(out, data.data() + position, size);
+		position += size;
+		return true;
+	}
+
+	bool AtEnd() const { return position == data.size(); }
+
+protected:
+
+	std::span<const uint8_t> data;
+	size_t position = 0;
+};
+
+} // namespace
+
+//---
+
+ReplayRecorder::ReplayRecorder(uint64_t seed, int colorCount)
+{
+	data.reserve(4096);
+	data.insert(data.end(), kMagic, kMagic + sizeof(kMagic));
+	const uint32_t header[2] = { kVersion, uint32_t(colorCount) };
+	const uint8_t* headerBytes = reinterpret_cast<const uint8_t*>(header);
+	data.insert(data.end(), headerBytes, headerBytes + sizeof(header));
+	const uint8_t* seedBytes = reinterpret_cast<const uint8_t*>(&seed);
+	data.insert(data.end(), seedBytes, seedBytes + sizeof(seed));
+}
+
+//---
+
+void ReplayRecorder::Record(uint64_t tick, const GameInput &input)
+{
+	if (finished) return;
+
+	WriteVarint(((tick - lastTick) << 2) | uint64_t(input.type));
+	lastTick = tick;
+	if (input.type == GameInput::Type::kKey) {
+		WriteVarint(uint32_t(input.code));
+		return;
+	}
+	if (input.type == GameInput::Type::kMouseButton) {
+		WriteVarint(uint32_t(input.code));
+	}
+	WriteSigned(int64_t(input.x) - lastX);
+	WriteSigned(int64_t(input.y) - lastY);
+	lastX = input.x;
+	lastY = input.y;
+}
+
+//---
+
+void ReplayRecorder::Finish(uint64_t tick, uint64_t stateHash)
+{
+	if (finished) return;
+
+	WriteVarint(((tick - lastTick) << 2) | kEndRecord);
+	lastTick = tick;
+	const uint8_t* hashBytes = reinterpret_cast<const uint8_t*>(&stateHash);
+	data.insert(data.end(), hashBytes, hashBytes + sizeof(stateHash));
+	finished = true;
+}
+
+//---
+
+bool ReplayRecorder::Save(const char* fileName) const
+{
+	FILE* f = fopen(fileName, "wb");
+	if (!f) {
+		SDL_SetError("ReplayRecorder::Save(): could not create %s", fileName);
+		return false;
+	}
+	const bool written = (fwrite(data.data(), 1, data.size(), f) == data.size());
+	if (fclose(f) != 0 || !written) {
+		SDL_SetError("ReplayRecorder::Save(): could not write %s", fileName);
+		return false;
+	}
+	return true;
+}
+
+//---
+
+void ReplayRecorder::WriteVarint(uint64_t value)
+{
+	while (value >= 0x80) {
+		data.push_back(uint8_t(value) | 0x80);
+		value >>= 7;
+	}
+	data.push_back(uint8_t(value));
+}
+
+//---
+
+ReplayResult RunReplay(std::span<const uint8_t> log)
+{
+	ReplayResult result;
+	LogReader reader(log);
+
+	char magic[sizeof(ReplayRecorder::kMagic)];
+	uint32_t header[2];
+	if (!reader.ReadFixed(magic, sizeof(magic)) || !reader.ReadFixed(header, sizeof(header))
+		|| !reader.ReadFixed(&result.seed, sizeof(result.seed))) {
+		SDL_SetError("RunReplay(): the log is shorter than its header (%zu bytes)", kHeaderSize);
+		return result;
+	}
+	if (memcmp(magic, ReplayRecorder::kMagic, sizeof(magic)) != 0 || header[0] != ReplayRecorder::kVersion) {
+		SDL_SetError("RunReplay(): not a replay log, or of an unsupported version");
+		return result;
+	}
+
+	Game game(result.seed, int(header[1]));
+	int32_t x = 0, y = 0;
+	while (1) {
+		uint64_t tag;
+		if (!reader.ReadVarint(tag)) {
+			SDL_SetError("RunReplay(): the log is truncated (no end record)");
+			return result;
+		}
+		// checked before ticking: a damaged tick count would otherwise keep the replay going for ages
+		const uint64_t ticks = tag >> 2;
+		if (ticks > ReplayRecorder::MAX_TICKS - game.GetTick()) {
+			SDL_SetError("RunReplay(): the log is damaged (it goes on past %llu ticks)", (unsigned long long)ReplayRecorder::MAX_TICKS);
+			return result;
+		}
+		for (uint64_t tick = 0; tick < ticks; tick++) {
+			game.Tick();
+		}
+
+		const int type = int(tag & 3);
+		if (type == kEndRecord) break;
+
+		GameInput input { GameInput::Type(type) };
+		uint64_t code = 0;
+		int64_t dx = 0, dy = 0;
+		bool valid = true;
+		if (type == kKeyRecord || type == kButtonRecord) {
+			valid = reader.ReadVarint(code);
+		}
+		if (type == kButtonRecord || type == kMotionRecord) {
+			valid = valid && reader.ReadSigned(dx) && reader.ReadSigned(dy);
+		}
+		if (!valid) {
+			SDL_SetError("RunReplay(): the log is truncated after %llu inputs", (unsigned long long)result.inputs);
+			return result;
+		}
+		x = int32_t(x + dx);
+		y = int32_t(y + dy);
+		input.code = int32_t(code);
+		input.x = x;
+		input.y = y;
+		game.Apply(input);
+		result.inputs++;
+	}
+
+	if (!reader.ReadFixed(&result.recordedHash, sizeof(result.recordedHash)) || !reader.AtEnd()) {
+		SDL_SetError("RunReplay(): the end record is damaged");
+		return result;
+	}
+	result.ok = true;
+	result.ticks = game.GetTick();
+	result.score = game.GetScore();
+	result.stateHash = game.GetStateHash();
+	result.identical = (result.stateHash == result.recordedHash);
+	return result;
+}
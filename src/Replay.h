@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "Game.h"
+
+/*
+ * Replay logs: the seed of a game and every input with the tick it came at,
+ * enough to re-simulate the game exactly (see Game). All little endian:
+ *
+ *   header   "MJREPLAY", uint32 version, uint32 colour count, uint64 seed
+ *   records  varint (ticks since the previous record << 2 | type), then
+ *              key (0):     varint key code
+ *              button (1):  varint button, zigzag varint dx, dy
+ *              motion (2):  zigzag varint dx, dy
+ *              end (3):     uint64 state hash after the last tick
+ *
+ * Mouse positions are relative to the previous one, so the usual small
+ * motion fits in two bytes and a whole record in three or four.
+ */
+
+/// Writes a replay log while a game is played.
+class ReplayRecorder
+{
+public:
+
+	static constexpr char kMagic[8] = { 'M', 'J', 'R', 'E', 'P', 'L', 'A', 'Y' };
+	static const uint32_t kVersion = 1;
+
+	/// Longest game a log can be replayed for (a day); RunReplay() rejects a log that goes on longer as damaged.
+	static const uint64_t MAX_TICKS = uint64_t(Game::TICK_RATE) * 60 * 60 * 24;
+
+	ReplayRecorder(uint64_t seed, int colorCount);
+
+	/// Records an input applied when the game was at the given tick (ticks must not decrease).
+	void Record(uint64_t tick, const GameInput &input);
+
+	/// Ends the log with the final tick and the game's state hash, which a replay must reproduce.
+	void Finish(uint64_t tick, uint64_t stateHash);
+
+	const std::vector<uint8_t>& GetData() const { return data; }
+
+	/**
+	 * Writes the log to a file.
+	 * \return True on success; on error, SDL_SetError() is used.
+	 */
+	bool Save(const char* fileName) const;
+
+protected:
+
+	void WriteVarint(uint64_t value);
+	void WriteSigned(int64_t value) { WriteVarint((uint64_t(value) << 1) ^ uint64_t(value >> 63)); }
+
+	std::vector<uint8_t> data;
+	uint64_t lastTick = 0;
+	int32_t lastX = 0;
+	int32_t lastY = 0;
+	bool finished = false;
+};
+
+//---
+
+struct ReplayResult
+{
+	bool ok = false;				///< The log was read to its end record; if not, SDL_GetError() says why.
+	bool identical = false;			///< The final state hash is the recorded one.
+	uint64_t seed = 0;
+	uint64_t ticks = 0;
+	uint64_t inputs = 0;
+	int score = 0;
+	uint64_t stateHash = 0;
+	uint64_t recordedHash = 0;
+};
+
+/**
+ * Re-simulates a recorded game as fast as the CPU allows (nothing is drawn).
+ * Thread-safe: any number of replays can run at once.
+ */
+ReplayResult RunReplay(std::span<const uint8_t> log);
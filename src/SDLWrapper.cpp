@@ -1,4 +1,9 @@
 #include "SDLWrapper.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
 
 namespace SDL {
 
@@ -23,6 +28,14 @@ Library::~Library()
 EventLoop::EventLoop(Library &libSDL_)
 	: libSDL(libSDL_)
 {
+	// the first type registered is SDL_USEREVENT itself, which PushUserEvent() uses
+	wakeupEventType = SDL_RegisterEvents(1);
+	if (wakeupEventType == SDL_USEREVENT) {
+		wakeupEventType = SDL_RegisterEvents(1);
+	}
+	if (wakeupEventType == uint32_t(-1)) {
+		throw Error("SDL::EventLoop::EventLoop(): SDL_RegisterEvents() failed");
+	}
 }
 
 //---
@@ -35,58 +48,384 @@ EventLoop::~EventLoop()
 
 void EventLoop::Run()
 {
-	bool redrawNeeded = false;
-	bool haveEvent = false;
-	std::vector<SDL_Window*> windowsToRedraw;
+	while (RunOnce()) {}
+}
+
+//---
+
+bool EventLoop::RunOnce(bool wait)
+{
+	if (mode == Mode::kFixedStep) {
+		return RunFrame();
+	}
+
+	windowsToRedraw.clear();
+	DrainCommands();
+
+	// wait for any incoming events, then handle the whole batch
 	SDL_Event event;
-	while (1) {
-		windowsToRedraw.clear();
+	bool haveEvent = false;
+	if (wait) {
+		PROFILE_ZONE("EventLoop wait");
+
+		// announced before looking at the queue: a command posted meanwhile is either seen here, or wakes us up
+		waiting.store(true);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (commands.IsEmpty()) {
+			haveEvent = WaitEvent(event);
+		}
+		waiting.store(false);
+	}
+	{
+		PROFILE_ZONE("EventLoop events");
+		input.fixedStep = false;
+		DispatchPending(haveEvent ? &event : nullptr);
+		FlushInput();
+	}
+	{
+		PROFILE_ZONE("EventLoop commands and timers");
+		DrainCommands();
+		timers.Advance();
+	}
 
-		// wait for any incoming events, then handle the whole batch
-		SDL_WaitEvent(&event);
-		do {
-			if (event.type == SDL_QUIT) {	// closing button pressed
-				quitRequested = true;
-			}
-			else if (event.type == SDL_KEYDOWN) {
-				if (OnKey)
-					OnKey(event.key);
-			}
-			else if (event.type == SDL_MOUSEBUTTONDOWN) {
-				if (OnMouseButton)
-					OnMouseButton(event.button);
-			}
-			else if (event.type == SDL_MOUSEMOTION) {
-				if (OnMouseMotion)
-					OnMouseMotion(event.motion);
-			}
-			else if (event.type == SDL_WINDOWEVENT) {
-				if (event.window.event == SDL_WINDOWEVENT_EXPOSED) {
-					redrawNeeded = true;
-					windowsToRedraw.push_back(SDL_GetWindowFromID(event.window.windowID));
-				}
-				if (event.window.event == SDL_WINDOWEVENT_RESIZED) {
-					if (OnWindowResized)
-						OnWindowResized(int(event.window.data1), int(event.window.data2));
-				}
-			}
-			else if (event.type == SDL_USEREVENT) {
-				if (OnUserEvent)
-					OnUserEvent(event.user);
-			}
-		} while (SDL_PollEvent(&event));
+	if (quitRequested) return false;
 
-		if (quitRequested) break;
+	for (auto window : windowsToRedraw) {
+		PROFILE_ZONE("EventLoop redraw");
+		if (OnRedraw) {
+			OnRedraw();
+		}
+		SDL_GL_SwapWindow(window);
+	}
+	return true;
+}
+
+//---
 
-		if (redrawNeeded) {
-			for (auto window : windowsToRedraw) {
-				if (OnRedraw) {
-					OnRedraw();
+bool EventLoop::WaitEvent(SDL_Event &event)
+{
+	const uint64_t deadline = timers.GetNextDeadline();
+	if (deadline == UINT64_MAX) {
+		return SDL_WaitEvent(&event);
+	}
+
+	// rounded up: waking a little late fires the timer, waking early would only wait again
+	const uint64_t now = TimerWheel::NowNs();
+	if (deadline <= now) {
+		return SDL_PollEvent(&event);
+	}
+	const uint64_t ms = std::min<uint64_t>((deadline - now + 999999) / 1000000, INT32_MAX);
+	return SDL_WaitEventTimeout(&event, int(ms));
+}
+
+//---
+
+void EventLoop::SetFixedStepMode(SDL_Window* window, int tickRate, int frameRate)
+{
+	if (!window || tickRate <= 0) {
+		throw Error("SDL::EventLoop::SetFixedStepMode(): a window and a positive tick rate are required");
+	}
+	if (frameRate <= 0) {
+		SDL_DisplayMode displayMode;
+		if (SDL_GetWindowDisplayMode(window, &displayMode) == 0) {
+			frameRate = displayMode.refresh_rate;
+		}
+		if (frameRate <= 0) frameRate = FALLBACK_FRAME_RATE;
+	}
+
+	// adaptive vsync (late frames tear instead of waiting a whole interval), else plain vsync
+	vsync = (SDL_GL_SetSwapInterval(-1) == 0 || SDL_GL_SetSwapInterval(1) == 0);
+
+	const uint64_t frequency = SDL_GetPerformanceFrequency();
+	mode = Mode::kFixedStep;
+	fixedStepWindow = window;
+	tickLength = frequency / uint64_t(tickRate);
+	frameLength = frequency / uint64_t(frameRate);
+	accumulator = 0;
+	sleepMargin = frequency / 1000;
+	stats = FrameStats();
+	frameStart = SDL_GetPerformanceCounter();
+}
+
+//---
+
+bool EventLoop::RunFrame()
+{
+	// the previous frame lasted from its start to now
+	const uint64_t now = SDL_GetPerformanceCounter();
+	const uint64_t elapsed = now - frameStart;
+	frameStart = now;
+
+	const double intervals = double(elapsed) / double(frameLength);
+	if (intervals > 1.2) {
+		stats.lateFrames++;
+		stats.droppedFrames += uint64_t(std::ceil(intervals - 0.2)) - 1;
+	}
+	stats.maxFrameMs = std::max(stats.maxFrameMs, double(elapsed) * 1000.0 / double(SDL_GetPerformanceFrequency()));
+
+	{
+		PROFILE_ZONE("EventLoop events");
+		input.fixedStep = true;
+		DispatchPending(nullptr);
+		FlushInput();
+	}
+	{
+		PROFILE_ZONE("EventLoop commands and timers");
+		DrainCommands();
+		timers.Advance();
+	}
+	windowsToRedraw.clear();	// everything is redrawn anyway
+	if (quitRequested) return false;
+
+	const double tickSeconds = double(tickLength) / double(SDL_GetPerformanceFrequency());
+	accumulator += elapsed;
+	int ticks = 0;
+	while (accumulator >= tickLength) {
+		if (ticks == MAX_TICKS_PER_FRAME) {
+			stats.droppedTicks += accumulator / tickLength;
+			accumulator %= tickLength;
+			break;
+		}
+		if (OnTick) {
+			PROFILE_ZONE("EventLoop tick");
+			OnTick(tickSeconds);
+		}
+		accumulator -= tickLength;
+		ticks++;
+	}
+	stats.ticks += ticks;
+
+	{
+		PROFILE_ZONE("EventLoop render");
+		if (OnRender) {
+			OnRender(float(double(accumulator) / double(tickLength)));
+		}
+		else if (OnRedraw) {
+			OnRedraw();
+		}
+	}
+	{
+		PROFILE_ZONE("EventLoop swap");
+		SDL_GL_SwapWindow(fixedStepWindow);
+	}
+	stats.frames++;
+
+	// with working vsync the swap has already waited for the display; a swap that
+	// returned well before the interval ended means the driver ignores the swap interval
+	const uint64_t deadline = frameStart + frameLength;
+	if (!vsync || SDL_GetPerformanceCounter() - frameStart < frameLength / 2) {
+		PROFILE_ZONE("EventLoop wait");
+		WaitUntil(deadline);
+	}
+	return !quitRequested;
+}
+
+//---
+
+void EventLoop::WaitUntil(uint64_t deadline)
+{
+	const uint64_t frequency = SDL_GetPerformanceFrequency();
+	uint64_t now = SDL_GetPerformanceCounter();
+	if (now >= deadline) return;
+
+	// SDL_Delay() may oversleep by a millisecond or more, so it sleeps only
+	// up to the recently seen oversleep before the deadline
+	if (deadline - now > sleepMargin) {
+		const uint32_t ms = uint32_t((deadline - now - sleepMargin) * 1000 / frequency);
+		if (ms > 0) {
+			SDL_Delay(ms);
+			const uint64_t woken = SDL_GetPerformanceCounter();
+			const uint64_t requested = uint64_t(ms) * frequency / 1000;
+			const uint64_t oversleep = (woken - now > requested) ? woken - now - requested : 0;
+
+			// jump up to a longer oversleep at once, decay slowly after shorter ones
+			sleepMargin = std::max(oversleep, sleepMargin - sleepMargin / 16);
+			now = woken;
+		}
+	}
+	while (now < deadline) {
+		std::this_thread::yield();
+		now = SDL_GetPerformanceCounter();
+	}
+}
+
+//---
+
+void EventLoop::DispatchPending(const SDL_Event* first)
+{
+	const bool collectInput = WantsInput();
+	int count = 0;
+	if (first) {
+		batch[count++] = *first;
+	}
+
+	// one SDL_PeepEvents() takes many events under one lock, where SDL_PollEvent() takes one
+	SDL_PumpEvents();
+	while (1) {
+		const int fetched = SDL_PeepEvents(&batch[count], EVENT_BATCH_SIZE - count, SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT);
+		const int end = count + std::max(fetched, 0);
+
+		// merge runs of mouse motion into their last event, summing up the relative motion
+		for (int i = count; i < end; i++) {
+			const SDL_Event &event = batch[i];
+			if (event.type == SDL_MOUSEMOTION && count > 0) {
+				SDL_MouseMotionEvent &previous = batch[count - 1].motion;
+				if (previous.type == SDL_MOUSEMOTION && previous.windowID == event.motion.windowID
+						&& previous.which == event.motion.which) {
+					const int xrel = previous.xrel + event.motion.xrel;
+					const int yrel = previous.yrel + event.motion.yrel;
+					previous = event.motion;
+					previous.xrel = xrel;
+					previous.yrel = yrel;
+					continue;
 				}
-				SDL_GL_SwapWindow(window);
 			}
-			windowsToRedraw.clear();
+			batch[count++] = event;
+		}
+
+		if (fetched <= 0) break;
+		if (count == EVENT_BATCH_SIZE) {
+			HandleBatch(count, collectInput);
+			count = 0;
+		}
+	}
+	if (count > 0) {
+		HandleBatch(count, collectInput);
+	}
+}
+
+//---
+
+void EventLoop::HandleBatch(int count, bool collectInput)
+{
+	if (collectInput) {
+		for (int i = 0; i < count; i++) {
+			CollectInput(batch[i]);
+		}
+	}
+	DispatchBatch(batch.data(), count);
+}
+
+//---
+
+void EventLoop::DispatchBatch(const SDL_Event* events, int count)
+{
+	for (int i = 0; i < count; i++) {
+		Dispatch(events[i]);
+	}
+}
+
+//---
+
+void EventLoop::CollectInput(const SDL_Event &event)
+{
+	switch (event.type) {
+	case SDL_MOUSEMOTION:
+		input.mouseX = event.motion.x;
+		input.mouseY = event.motion.y;
+		input.mouseDeltaX += event.motion.xrel;
+		input.mouseDeltaY += event.motion.yrel;
+		input.buttons = event.motion.state;
+		input.mouseMoved = true;
+		break;
+	case SDL_MOUSEBUTTONDOWN:
+	case SDL_MOUSEBUTTONUP: {
+		const bool down = (event.type == SDL_MOUSEBUTTONDOWN);
+		const uint32_t mask = (event.button.button >= 1 && event.button.button <= 32) ? 1u << (event.button.button - 1) : 0;
+		input.buttons = down ? (input.buttons | mask) : (input.buttons & ~mask);
+		input.mouseX = event.button.x;
+		input.mouseY = event.button.y;
+		inputEvents.push_back(InputEvent{ down ? InputEvent::Type::kButtonDown : InputEvent::Type::kButtonUp,
+			event.button.button, 0, 0, event.button.x, event.button.y });
+		break;
+	}
+	case SDL_KEYDOWN:
+	case SDL_KEYUP: {
+		const bool down = (event.type == SDL_KEYDOWN);
+		const SDL_Scancode scancode = event.key.keysym.scancode;
+		if (unsigned(scancode) < input.keys.size()) {
+			input.keys.set(scancode, down);
 		}
+		const InputEvent::Type type = !down ? InputEvent::Type::kKeyUp
+			: event.key.repeat ? InputEvent::Type::kKeyRepeat : InputEvent::Type::kKeyDown;
+		inputEvents.push_back(InputEvent{ type, 0, uint16_t(scancode), int32_t(event.key.keysym.sym), input.mouseX, input.mouseY });
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+//---
+
+void EventLoop::FlushInput()
+{
+	if (inputEvents.empty() && !input.mouseMoved) return;
+
+	input.events = inputEvents;
+	DeliverInput(input);
+	input.events = {};
+	inputEvents.clear();
+	input.mouseDeltaX = input.mouseDeltaY = 0;
+	input.mouseMoved = false;
+}
+
+//---
+
+bool EventLoop::WantsInput() const
+{
+	return bool(OnInput);
+}
+
+//---
+
+void EventLoop::DeliverInput(const InputBatch &batch)
+{
+	if (OnInput)
+		OnInput(batch);
+}
+
+//---
+
+void EventLoop::HandleWindowEvent(const SDL_WindowEvent &event)
+{
+	if (event.event == SDL_WINDOWEVENT_EXPOSED) {
+		SDL_Window* window = SDL_GetWindowFromID(event.windowID);
+		if (std::find(windowsToRedraw.begin(), windowsToRedraw.end(), window) == windowsToRedraw.end()) {
+			windowsToRedraw.push_back(window);
+		}
+	}
+}
+
+//---
+
+void EventLoop::Dispatch(const SDL_Event &event)
+{
+	if (event.type == SDL_QUIT) {	// closing button pressed
+		quitRequested = true;
+	}
+	else if (event.type == SDL_KEYDOWN) {
+		if (OnKey)
+			OnKey(event.key);
+	}
+	else if (event.type == SDL_MOUSEBUTTONDOWN) {
+		if (OnMouseButton)
+			OnMouseButton(event.button);
+	}
+	else if (event.type == SDL_MOUSEMOTION) {
+		if (OnMouseMotion)
+			OnMouseMotion(event.motion);
+	}
+	else if (event.type == SDL_WINDOWEVENT) {
+		HandleWindowEvent(event.window);
+		if (event.window.event == SDL_WINDOWEVENT_RESIZED) {
+			if (OnWindowResized)
+				OnWindowResized(int(event.window.data1), int(event.window.data2));
+		}
+	}
+	else if (event.type == SDL_USEREVENT) {
+		if (OnUserEvent)
+			OnUserEvent(event.user);
 	}
 }
 
@@ -106,6 +445,32 @@ void EventLoop::PushUserEvent(int code, void* data1, void* data2)
 
 //---
 
+bool EventLoop::PostCommand(const Command &command)
+{
+	if (!commands.TryPush(command)) return false;
+
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (waiting.exchange(false)) {
+		SDL_Event event = {};
+		event.type = wakeupEventType;
+		SDL_PushEvent(&event);
+	}
+	return true;
+}
+
+//---
+
+void EventLoop::DrainCommands()
+{
+	Command command;
+	while (commands.TryPop(command)) {
+		if (OnCommand)
+			OnCommand(command);
+	}
+}
+
+//---
+
 Surface::Surface(int width, int height, int depth, uint32_t format)
 {
 	if (width < 0 || height < 0 || depth < 0) {
@@ -119,6 +484,19 @@ Surface::Surface(int width, int height, int depth, uint32_t format)
 
 //---
 
+Surface::Surface(void* pixels, int width, int height, int depth, int pitch, uint32_t format)
+{
+	if (width < 0 || height < 0 || depth < 0 || pitch < 0) {
+		throw Error("SDL::Surface::Surface(): Surface dimensions must be >= 0");
+	}
+	wrapped = SDL_CreateRGBSurfaceWithFormatFrom(pixels, width, height, depth, pitch, format);
+	if (!wrapped) {
+		throw Error("SDL::Surface::Surface(): SDL_CreateRGBSurfaceWithFormatFrom() failed: " + Library::getError());
+	}
+}
+
+//---
+
 Surface::~Surface()
 {
 	if (wrapped)
@@ -127,6 +505,20 @@ Surface::~Surface()
 
 //---
 
+void Surface::SetGrayscalePalette()
+{
+	SDL_Color colorRamp[256];
+	for (int i = 0; i < 256; i++) {
+		colorRamp[i].r = i;
+		colorRamp[i].g = i;
+		colorRamp[i].b = i;
+		colorRamp[i].a = 255;
+	}
+	SDL_SetPaletteColors(GetFormat()->palette, colorRamp, 0, 256);
+}
+
+//---
+
 void Surface::blit(const SDL::Rect& rect, SDL::Surface& dest, SDL::Rect& destRect) const
 {
 	if (SDL_BlitSurface(wrapped, rect, dest.GetWrapped(), destRect) != 0)
@@ -169,8 +561,9 @@ Renderer::~Renderer()
 //---
 
 Timer::Timer(Type type_, uint32_t interval_, std::function<void(void)> payload_)
-	: type(type_), interval(interval_), payload(payload_)
+	: interval(interval_), type(type_), payload(payload_)
 {
+	dueTicks = SDL_GetTicks64() + interval;
 	timerId = SDL_AddTimer(interval, CallPayload, this);
 }
 
@@ -183,31 +576,30 @@ Timer::~Timer()
 
 //---
 
-uint32_t Timer::CallPayload(uint32_t timePassed, void* indirectThis)
+uint32_t Timer::CallPayload(uint32_t interval, void* indirectThis)
 {
 	Timer* theThis = reinterpret_cast<Timer*>(indirectThis);
 
+	PROFILE_THREAD_NAME("SDL timer");
+	PROFILE_ZONE("Timer::CallPayload");
 	theThis->payload();
-
-	if (theThis->type == Timer::Type::kOneShot) {
-
-		// do not call multiple times
-		return 0;
-	}
-	else {
-
-		// how much we are delayed in comparison with the interval
-		// (positive - we are delayed, negative - we are earlier)
-		int32_t delay = timePassed - theThis->interval;
-
-		// schedule next call, trying to compensate for delays
-		return uint32_t(int32_t(theThis->interval) - delay);
+	if (theThis->type == Timer::Type::kOneShot) return 0;
+
+	// SDL schedules the next call from when it got to this one, so the interval returned
+	// is shortened by how late this call is; periods missed altogether are skipped.
+	// (`interval` is only the value returned last time, not the timer's period.)
+	const uint64_t period = std::max<uint64_t>(theThis->interval, 1);
+	const uint64_t now = SDL_GetTicks64();
+	theThis->dueTicks += period;
+	if (theThis->dueTicks <= now) {
+		theThis->dueTicks += ((now - theThis->dueTicks) / period + 1) * period;
 	}
+	return uint32_t(theThis->dueTicks - now);
 }
 
 //---
 
-Window::Window(const std::string& title, int width, int height)
+Window::Window(const std::string& title, int width, int height, uint32_t extraFlags)
 {
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 5);
@@ -222,7 +614,7 @@ Window::Window(const std::string& title, int width, int height)
 		title.c_str(),
 		SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
 		width, height,
-		SDL_WINDOW_OPENGL|SDL_WINDOW_ALLOW_HIGHDPI);
+		SDL_WINDOW_OPENGL|SDL_WINDOW_ALLOW_HIGHDPI|extraFlags);
 	if (!wnd) {
 		throw Error("SDL::Window::Window(): SDL_CreateWindow() failed: " + Library::getError());
 	}
@@ -9,6 +9,14 @@
 #include <stdexcept>
 #include <optional>
 #include <functional>
+#include <vector>
+#include <array>
+#include <bitset>
+#include <span>
+#include <atomic>
+
+#include "MpscQueue.h"
+#include "TimerWheel.h"
 
 namespace SDL {
 
@@ -46,30 +54,346 @@ public:
 
 //---
 
+/// A key or mouse button transition, decoded from an SDL event (see InputBatch).
+struct InputEvent
+{
+	enum class Type : uint8_t {
+		kKeyDown = 0,
+		kKeyRepeat = 1,		///< Auto-repeat of a held key.
+		kKeyUp = 2,
+		kButtonDown = 3,
+		kButtonUp = 4
+	};
+
+	Type type;
+	uint8_t button;		///< SDL_BUTTON_LEFT etc., for the button types.
+	uint16_t scancode;	///< For the key types.
+	int32_t key;		///< SDL_Keycode, for the key types.
+	int32_t x, y;		///< Mouse position at the time.
+};
+
+//---
+
+/**
+ * The input of one RunOnce() (one frame in the fixed-step mode), to be
+ * processed in one go: the key and button transitions in order, the state
+ * they leave behind, and the mouse motion summed up.
+ */
+struct InputBatch
+{
+	/// Key and button transitions, in order (valid during EventLoop::OnInput only).
+	std::span<const InputEvent> events;
+
+	/// Keys held at the end of the batch, by scancode.
+	std::bitset<SDL_NUM_SCANCODES> keys;
+
+	/// Mouse buttons held at the end of the batch, as SDL_BUTTON() bits.
+	uint32_t buttons = 0;
+
+	int32_t mouseX = 0;
+	int32_t mouseY = 0;
+
+	/// Relative mouse motion over the batch.
+	int32_t mouseDeltaX = 0;
+	int32_t mouseDeltaY = 0;
+
+	bool mouseMoved = false;
+
+	/**
+	 * Whether the loop was in the fixed-step mode when the batch was taken,
+	 * i.e. whether the input is meant for the simulation. The per-event
+	 * callbacks, which run first, may have switched the mode since.
+	 */
+	bool fixedStep = false;
+
+	bool IsKeyDown(SDL_Scancode scancode) const { return keys.test(scancode); }
+	bool IsButtonDown(int button) const { return (buttons & (1u << (button - 1))) != 0; }
+};
+
+//---
+
 class EventLoop
 {
 public:
 
+	/// How Run() and RunOnce() drive the windows.
+	enum class Mode {
+		kEventDriven = 0,	///< Sleeps until an event comes, redraws exposed windows only (idle menus).
+		kFixedStep = 1		///< Simulates at a fixed rate and renders every frame (gameplay).
+	};
+
+	/// Counters of the fixed-step mode, reset by SetFixedStepMode().
+	struct FrameStats {
+		uint64_t frames = 0;
+		uint64_t ticks = 0;
+		uint64_t lateFrames = 0;		///< Frames that took noticeably longer than the frame interval.
+		uint64_t droppedFrames = 0;		///< Frame intervals that passed without a new frame.
+		uint64_t droppedTicks = 0;		///< Simulation ticks skipped to recover from a stall.
+		double maxFrameMs = 0.0;
+	};
+
+	static const int DEFAULT_TICK_RATE = 120;
+
+	/// Most ticks simulated before one frame; after a longer stall the
+	/// simulation skips the time instead of spiralling into ever longer frames.
+	static const int MAX_TICKS_PER_FRAME = 8;
+
+	/// Frame rate assumed when the display does not report its refresh rate.
+	static const int FALLBACK_FRAME_RATE = 60;
+
+	/// Events taken from SDL's queue at once; runs of mouse motion within them are merged.
+	static const int EVENT_BATCH_SIZE = 64;
+
 	EventLoop(Library &libSDL_);
-	~EventLoop();
+	virtual ~EventLoop();
+
+	/// Handles events (and, in the fixed-step mode, simulates and renders) until quitRequested is set.
 	void Run();
 
+	/**
+	 * In the event-driven mode, handles one batch of events: waits for the first
+	 * one (if `wait` is false and there is none, returns at once), dispatches it
+	 * and all pending ones, then redraws the windows that were exposed.
+	 * Consecutive mouse motion events (of the same window and mouse) are
+	 * merged into one: the last position, with the relative motions summed.
+	 * In the fixed-step mode, runs one frame (see SetFixedStepMode()); `wait` is ignored.
+	 * \return False once quitRequested is set.
+	 */
+	bool RunOnce(bool wait = true);
+
+	/**
+	 * Switches to the fixed-step mode: each frame handles the pending events,
+	 * calls OnTick() as many times as the elapsed time calls for (tickRate per
+	 * second), then OnRender() with the fraction of a tick left over, and swaps
+	 * `window`. Frames are paced to frameRate (0: the display's refresh rate)
+	 * by vsync when the driver allows it, otherwise by sleeping.
+	 * The window's GL context must be current.
+	 */
+	void SetFixedStepMode(SDL_Window* window, int tickRate = DEFAULT_TICK_RATE, int frameRate = 0);
+
+	/// Switches back to waiting for events, which lets the CPU sleep while nothing happens.
+	void SetEventDrivenMode() { mode = Mode::kEventDriven; }
+
+	Mode GetMode() const { return mode; }
+	const FrameStats& GetFrameStats() const { return stats; }
+
 	/// Pushes a user event (with user-defined meaning) to the event stream.
 	void PushUserEvent(int code, void* data1 = nullptr, void* data2 = nullptr);
 
+	/// A message to the loop's thread, see PostCommand().
+	struct Command {
+		int code = 0;			///< What to do (defined by the application).
+		int64_t value = 0;
+		void* data = nullptr;
+	};
+
+	static const size_t COMMAND_QUEUE_CAPACITY = 1024;
+
+	/**
+	 * Queues a command for OnCommand, which the loop calls on its own thread
+	 * once per iteration, in the order the commands were posted. Callable from
+	 * any thread (timer payloads, ThreadPool tasks); lock-free, and does not
+	 * allocate. Goes through SDL's event queue only to wake up a loop that
+	 * waits for events.
+	 * \return False if the queue is full (the command is dropped).
+	 */
+	bool PostCommand(const Command &command);
+
+	/**
+	 * Timers whose callbacks the loop runs on its own thread, once per
+	 * iteration after the events and commands. In the event-driven mode,
+	 * the loop sleeps no longer than until the next deadline (to the
+	 * millisecond); in the fixed-step mode, timers fire with frame precision.
+	 */
+	TimerWheel& GetTimers() { return timers; }
+
 	/// Flag to set to true to leave Run().
 	bool quitRequested = false;
 
+	/// Event-driven mode: draws an exposed window. Also used by the fixed-step mode if OnRender is not set.
 	std::function<void(void)> OnRedraw;
+
+	/// Fixed-step mode: advances the simulation by one tick of the given length in seconds.
+	std::function<void(double)> OnTick;
+
+	/// Fixed-step mode: draws the state `alpha` (0 to 1) of the way from the second-to-last tick to the last one.
+	std::function<void(float)> OnRender;
+
 	std::function<void(const SDL_KeyboardEvent&)> OnKey;
 	std::function<void(const SDL_MouseMotionEvent&)> OnMouseMotion;
 	std::function<void(const SDL_MouseButtonEvent&)> OnMouseButton;
 	std::function<void(const SDL_UserEvent&)> OnUserEvent;
+
+	/**
+	 * The batch API: called once per RunOnce() (before OnTick in the fixed-step
+	 * mode) with the input since the last call, if there was any. Works along
+	 * with the per-event callbacks above, which may be left unset.
+	 */
+	std::function<void(const InputBatch&)> OnInput;
+
+	std::function<void(const Command&)> OnCommand;
 	std::function<void(int, int)> OnWindowResized;
 
 protected:
 
+	void Dispatch(const SDL_Event &event);
+
+	/// Takes all pending events (after `first`, if any) in batches, merges the motion, and dispatches them.
+	void DispatchPending(const SDL_Event* first);
+
+	/// Adds the first `count` events of `batch` to the input batch (if `collectInput`), then dispatches them.
+	void HandleBatch(int count, bool collectInput);
+
+	/// Dispatches a batch through the std::function callbacks; StaticEventLoop dispatches to its handler instead.
+	virtual void DispatchBatch(const SDL_Event* events, int count);
+
+	/// Adds an (already merged) event to the input batch.
+	void CollectInput(const SDL_Event &event);
+
+	/// Hands the input batch to DeliverInput() if there is any input, and starts a new one.
+	void FlushInput();
+
+	/// Whether anyone takes InputBatches (OnInput is set); the input is collected only then.
+	virtual bool WantsInput() const;
+
+	/// Calls OnInput; StaticEventLoop hands the batch to its handler.
+	virtual void DeliverInput(const InputBatch &batch);
+
+	/// Notes exposed windows for redrawing.
+	void HandleWindowEvent(const SDL_WindowEvent &event);
+
+	/// SDL_WaitEvent(), but only until the next timer is due. \return False on timeout.
+	bool WaitEvent(SDL_Event &event);
+
+	/// Hands the queued commands to OnCommand.
+	void DrainCommands();
+
+	/// One frame of the fixed-step mode.
+	bool RunFrame();
+
+	/// Sleeps until the performance counter reaches `deadline`, spinning for the last part.
+	void WaitUntil(uint64_t deadline);
+
 	Library &libSDL;
+
+	/// Windows exposed in the current batch (kept to avoid reallocating every frame).
+	std::vector<SDL_Window*> windowsToRedraw;
+
+	std::array<SDL_Event, EVENT_BATCH_SIZE> batch;
+
+	/// The input batch being collected, and the storage of its events (reused from frame to frame).
+	InputBatch input;
+	std::vector<InputEvent> inputEvents;
+
+	MpscQueue<Command> commands { COMMAND_QUEUE_CAPACITY };
+
+	/// Set while the loop sleeps in WaitEvent(), so that PostCommand() knows to wake it up.
+	std::atomic<bool> waiting { false };
+
+	/// Type of the (otherwise ignored) event that does the waking.
+	uint32_t wakeupEventType;
+
+	TimerWheel timers;
+
+	Mode mode = Mode::kEventDriven;
+
+	/// The window rendered by the fixed-step mode.
+	SDL_Window* fixedStepWindow = nullptr;
+
+	bool vsync = false;
+
+	// all in SDL_GetPerformanceCounter() units
+	uint64_t tickLength = 0;
+	uint64_t frameLength = 0;
+	uint64_t accumulator = 0;	///< Elapsed time not simulated yet.
+	uint64_t frameStart = 0;
+	uint64_t sleepMargin = 0;	///< Recent oversleep of SDL_Delay(), left to spinning.
+
+	FrameStats stats;
+};
+
+//---
+
+/**
+ * EventLoop that hands the input events to a Handler bound at compile time:
+ * one switch on the event type per event, with the handler's methods inlined
+ * into it, instead of an if/else chain and a std::function call. The Handler
+ * defines any of these (the others' events are ignored):
+ *
+ *     void OnKey(const SDL_KeyboardEvent&);
+ *     void OnMouseMotion(const SDL_MouseMotionEvent&);
+ *     void OnMouseButton(const SDL_MouseButtonEvent&);
+ *     void OnUserEvent(const SDL_UserEvent&);
+ *     void OnWindowResized(int width, int height);
+ *     void OnInput(const InputBatch&);
+ *
+ * The once-per-frame callbacks (OnTick, OnRender, OnRedraw, OnCommand) are
+ * still the std::function members; the per-event ones are not called.
+ */
+template <class Handler>
+class StaticEventLoop final : public EventLoop
+{
+public:
+
+	StaticEventLoop(Library &libSDL_, Handler &handler_) : EventLoop(libSDL_), handler(handler_) {}
+
+protected:
+
+	void DispatchBatch(const SDL_Event* events, int count) override
+	{
+		for (int i = 0; i < count; i++) {
+			const SDL_Event &event = events[i];
+			switch (event.type) {
+			case SDL_MOUSEMOTION:
+				if constexpr (requires { handler.OnMouseMotion(event.motion); }) {
+					handler.OnMouseMotion(event.motion);
+				}
+				break;
+			case SDL_MOUSEBUTTONDOWN:
+				if constexpr (requires { handler.OnMouseButton(event.button); }) {
+					handler.OnMouseButton(event.button);
+				}
+				break;
+			case SDL_KEYDOWN:
+				if constexpr (requires { handler.OnKey(event.key); }) {
+					handler.OnKey(event.key);
+				}
+				break;
+			case SDL_USEREVENT:
+				if constexpr (requires { handler.OnUserEvent(event.user); }) {
+					handler.OnUserEvent(event.user);
+				}
+				break;
+			case SDL_WINDOWEVENT:
+				HandleWindowEvent(event.window);
+				if constexpr (requires { handler.OnWindowResized(0, 0); }) {
+					if (event.window.event == SDL_WINDOWEVENT_RESIZED) {
+						handler.OnWindowResized(int(event.window.data1), int(event.window.data2));
+					}
+				}
+				break;
+			case SDL_QUIT:
+				quitRequested = true;
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	bool WantsInput() const override
+	{
+		return requires(const InputBatch &batch) { handler.OnInput(batch); };
+	}
+
+	void DeliverInput(const InputBatch &batch) override
+	{
+		if constexpr (requires { handler.OnInput(batch); }) {
+			handler.OnInput(batch);
+		}
+	}
+
+	Handler &handler;
 };
 
 //---
@@ -142,6 +466,10 @@ public:
 	/// Constructor, equivalent to SDL_CreateRGBSurfaceWithFormat().
 	Surface(int width, int height, int depth, uint32_t format);
 
+	/// Constructor, equivalent to SDL_CreateRGBSurfaceWithFormatFrom().
+	/// The pixels are used in place (not copied) and must outlive the surface.
+	Surface(void* pixels, int width, int height, int depth, int pitch, uint32_t format);
+
 	Surface(const Surface& surface) = delete;
 
 	/// Destructor, calls Discard().
@@ -156,6 +484,9 @@ public:
 	int GetHeight() const { return wrapped ? wrapped->h : 0; }
 	int GetPitch() const { return wrapped ? wrapped->pitch : 0; }
 
+	/// Sets a linear black-to-white palette (for 8-bit coverage surfaces such as font atlases).
+	void SetGrayscalePalette();
+
 	/// Blits a rectangle of pixels from this surface to the target surface.
 	void blit(const SDL::Rect& srcRect, SDL::Surface& dest, SDL::Rect& destRect) const;
 };
@@ -182,7 +513,12 @@ public:
 
 //---
 
-/// Wraps SDL_Timer, allows to use a C++ lambda as the payload function.
+/**
+ * Wraps SDL_Timer, allows to use a C++ lambda as the payload function.
+ * The payload runs on SDL's timer thread: to act on the main thread's
+ * state, it should post a command (EventLoop::PostCommand()), or the
+ * timer should be one of EventLoop::GetTimers() instead.
+ */
 class Timer
 {
 public:
@@ -207,6 +543,9 @@ protected:
 	/// The interval set in the constructor.
 	uint32_t interval = 0;
 
+	/// SDL_GetTicks64() at which the next call of a repeated timer is due.
+	uint64_t dueTicks = 0;
+
 	Timer::Type type;
 
 	/// The payload, called when the timer elapses (probably in a different thread).
@@ -219,10 +558,13 @@ class Window
 {
 public:
 
-	Window(const std::string& title, int width, int height);
+	/// Creates the window with a GL 4.5 core context; extraFlags are added
+	/// to the SDL_CreateWindow() flags (e.g. SDL_WINDOW_HIDDEN).
+	Window(const std::string& title, int width, int height, uint32_t extraFlags = 0);
 	Window(const Window&) = delete;
 	~Window();
 	uint32_t getID() { return SDL_GetWindowID(wnd); }
+	SDL_Window* getWindow() { return wnd; }
 
 private:
 
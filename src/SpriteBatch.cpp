@@ -0,0 +1,98 @@
+#include "SpriteBatch.h"
+#include "SpriteShaders.h"
+
+//---
+
+SpriteBatch::SpriteBatch(GL::Device &device_, int layerSize_, int layerCount_, int maxSprites_)
+	: device(device_), layerSize(layerSize_), layerCount(layerCount_), maxSprites(maxSprites_)
+{
+	if (layerSize <= 0 || layerCount <= 0 || maxSprites <= 0) {
+		throw GL::Error("SpriteBatch::SpriteBatch(): the layer size, layer count and sprite count must be positive");
+	}
+	// what may throw comes first, so that no GL name is left behind for a destructor that will not run
+	program = std::make_unique<GL::Program>(SpriteShaders::kVertexShader, SpriteShaders::kFragmentShader);
+	stream = std::make_unique<GL::StreamBuffer>(sizeof(Sprite) * size_t(maxSprites));
+
+	// mipmapped down to 1x1, as sprites are drawn at any size
+	int levels = 1;
+	while ((layerSize >> levels) > 0) levels++;
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &texture);
+	glTextureStorage3D(texture, levels, GL_RGBA8, layerSize, layerSize, layerCount);
+	for (int level = 0; level < levels; level++) {
+		glClearTexImage(texture, level, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	}
+	glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glCreateVertexArrays(1, &vertexArray);
+	glVertexArrayVertexBuffer(vertexArray, 0, stream->GetId(), 0, sizeof(Sprite));
+	glVertexArrayBindingDivisor(vertexArray, 0, 1);
+	glEnableVertexArrayAttrib(vertexArray, 0);
+	glVertexArrayAttribFormat(vertexArray, 0, 2, GL_FLOAT, GL_FALSE, offsetof(Sprite, center));
+	glVertexArrayAttribBinding(vertexArray, 0, 0);
+	glEnableVertexArrayAttrib(vertexArray, 1);
+	glVertexArrayAttribFormat(vertexArray, 1, 2, GL_FLOAT, GL_FALSE, offsetof(Sprite, size));
+	glVertexArrayAttribBinding(vertexArray, 1, 0);
+	glEnableVertexArrayAttrib(vertexArray, 2);
+	glVertexArrayAttribFormat(vertexArray, 2, 1, GL_FLOAT, GL_FALSE, offsetof(Sprite, rotation));
+	glVertexArrayAttribBinding(vertexArray, 2, 0);
+	glEnableVertexArrayAttrib(vertexArray, 3);
+	glVertexArrayAttribIFormat(vertexArray, 3, 1, GL_UNSIGNED_INT, offsetof(Sprite, layer));
+	glVertexArrayAttribBinding(vertexArray, 3, 0);
+	glEnableVertexArrayAttrib(vertexArray, 4);
+	glVertexArrayAttribFormat(vertexArray, 4, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(Sprite, color));
+	glVertexArrayAttribBinding(vertexArray, 4, 0);
+}
+
+//---
+
+SpriteBatch::~SpriteBatch()
+{
+	if (vertexArray) glDeleteVertexArrays(1, &vertexArray);
+	if (texture) glDeleteTextures(1, &texture);
+	device.Invalidate();	// the names may be bound, and will be reused
+}
+
+//---
+
+void SpriteBatch::SetLayer(int layer, const uint32_t* pixels)
+{
+	if (layer < 0 || layer >= layerCount) return;
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTextureSubImage3D(texture, 0, 0, 0, layer, layerSize, layerSize, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	glGenerateTextureMipmap(texture);
+}
+
+//---
+
+void SpriteBatch::Begin(int viewportWidth_, int viewportHeight_)
+{
+	viewportWidth = viewportWidth_;
+	viewportHeight = viewportHeight_;
+	spriteCount = 0;
+	flushedCount = 0;
+	stream->BeginFrame();
+	frame = stream->GetFree<Sprite>().first(size_t(maxSprites));
+}
+
+//---
+
+void SpriteBatch::Flush()
+{
+	if (spriteCount == flushedCount) return;
+
+	device.UseProgram(program->GetId());
+	device.ProgramUniform2f(program->GetId(), 0, float(viewportWidth), float(viewportHeight));
+	device.BindTextureUnit(0, texture);
+	device.BindVertexArray(vertexArray);
+	device.SetBlend(true);
+	device.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	const int count = spriteCount - flushedCount;
+	device.DrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, count, stream->Commit<Sprite>(size_t(count)));
+	flushedCount = spriteCount;
+	stream->Fence();
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+
+#include "GLWrapper.h"
+#include "GLDevice.h"
+#include "StreamBuffer.h"
+
+/**
+ * Draws sprites (gems, effects, UI) from the layers of one texture array
+ * with one instanced draw call per Flush(). Sprites are written straight
+ * into a GL::StreamBuffer of instances, in drawing order; as every
+ * sprite samples the same texture, a whole board takes a single draw.
+ * GL state is set through the GL::Device, which drops what is already set.
+ * Requires a current GL 4.5 context for its whole lifetime.
+ */
+class SpriteBatch
+{
+public:
+
+	/// Sprites per frame; the buffer holds GL::StreamBuffer::PARTITIONS frames of them.
+	static const int DEFAULT_MAX_SPRITES = 65536;
+
+	/// Per-sprite instance data, see SpriteShaders.h for the attribute layout.
+	struct Sprite {
+		float center[2];	///< x, y in pixels
+		float size[2];		///< width, height in pixels
+		float rotation;		///< radians, clockwise
+		uint32_t layer;
+		uint32_t color;		///< RGBA8 tint, R in the lowest byte
+	};
+
+	/**
+	 * Creates the texture array (layerCount square layers of layerSize
+	 * pixels, mipmapped) and the GL objects; throws GL::Error on failure.
+	 * The layers start out transparent, see SetLayer().
+	 */
+	SpriteBatch(GL::Device &device, int layerSize, int layerCount, int maxSprites = DEFAULT_MAX_SPRITES);
+	SpriteBatch(const SpriteBatch&) = delete;
+	~SpriteBatch();
+
+	/// Uploads a layer: layerSize * layerSize RGBA8 pixels (straight alpha), top row first.
+	void SetLayer(int layer, const uint32_t* pixels);
+
+	/// Starts a new frame of sprites for a viewport of the given size.
+	void Begin(int viewportWidth, int viewportHeight);
+
+	/// Appends a sprite centered at (x, y). Sprites that do not fit in the frame's buffer are dropped.
+	void Add(float x, float y, float width, float height, int layer,
+		uint32_t color = 0xffffffff, float rotation = 0.0f)
+	{
+		if (spriteCount >= int(frame.size())) {
+			stream->AddOverflow();
+			return;
+		}
+		Sprite &sprite = frame[spriteCount++];
+		sprite.center[0] = x;
+		sprite.center[1] = y;
+		sprite.size[0] = width;
+		sprite.size[1] = height;
+		sprite.rotation = rotation;
+		sprite.layer = uint32_t(layer);
+		sprite.color = color;
+	}
+
+	/// Draws the sprites added since Begin() (or the previous Flush()) with a single instanced draw call.
+	void Flush();
+
+	int GetLayerSize() const { return layerSize; }
+	int GetLayerCount() const { return layerCount; }
+
+	/// Number of sprites added since Begin().
+	int GetSpriteCount() const { return spriteCount; }
+
+	/// Stalls waiting for the GPU and sprites dropped for lack of room, see GL::StreamBuffer::Stats.
+	const GL::StreamBuffer::Stats& GetStreamStats() const { return stream->GetStats(); }
+
+protected:
+
+	GL::Device &device;
+	std::unique_ptr<GL::Program> program;
+	GLuint texture = 0;
+	GLuint vertexArray = 0;
+	std::unique_ptr<GL::StreamBuffer> stream;
+
+	/// The current frame's part of the stream, where sprites are written.
+	std::span<Sprite> frame;
+
+	int layerSize = 0;
+	int layerCount = 0;
+	int maxSprites = 0;
+	int spriteCount = 0;
+	int flushedCount = 0;		///< Sprites of this frame already drawn by Flush().
+	int viewportWidth = 0;
+	int viewportHeight = 0;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+// GLSL sources for drawing sprites from a texture array.
+//
+// Each sprite is one instance of a 4-vertex triangle strip; the corners
+// are derived from gl_VertexID. Per-instance attributes:
+//   location 0: vec2 center    - in window pixels (y down)
+//   location 1: vec2 size      - width, height in pixels
+//   location 2: float rotation - radians, clockwise on the screen
+//   location 3: uint layer     - layer of the texture array
+//   location 4: vec4 color     - normalized RGBA8 tint
+// Uniforms:
+//   location 0: vec2 viewportSize    - in pixels
+//   binding 0:  sampler2DArray atlas - RGBA8 layers, straight alpha
+
+namespace SpriteShaders {
+
+static const char* const kVertexShader = R"(
+#version 450 core
+layout(location = 0) in vec2 center;
+layout(location = 1) in vec2 size;
+layout(location = 2) in float rotation;
+layout(location = 3) in uint layer;
+layout(location = 4) in vec4 color;
+layout(location = 0) uniform vec2 viewportSize;
+out vec3 uvw;
+out vec4 tint;
+void main() {
+	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+	vec2 offset = (corner - 0.5) * size;
+	float c = cos(rotation), s = sin(rotation);
+	vec2 position = center + vec2(c * offset.x - s * offset.y, s * offset.x + c * offset.y);
+	uvw = vec3(corner, float(layer));
+	tint = color;
+	gl_Position = vec4(position / viewportSize * vec2(2.0, -2.0) + vec2(-1.0, 1.0), 0.0, 1.0);
+}
+)";
+
+static const char* const kFragmentShader = R"(
+#version 450 core
+layout(binding = 0) uniform sampler2DArray atlas;
+in vec3 uvw;
+in vec4 tint;
+out vec4 fragColor;
+void main() {
+	fragColor = texture(atlas, uvw) * tint;
+}
+)";
+
+} // namespace SpriteShaders
@@ -0,0 +1,75 @@
+#include "StreamBuffer.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace GL {
+
+//---
+
+StreamBuffer::StreamBuffer(size_t partitionSize_)
+	: partitionSize(partitionSize_)
+{
+	const GLbitfield mapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	const GLsizeiptr bufferSize = GLsizeiptr(partitionSize * PARTITIONS);
+	glCreateBuffers(1, &id);
+	glNamedBufferStorage(id, bufferSize, nullptr, mapFlags);
+	mapped = static_cast<uint8_t*>(glMapNamedBufferRange(id, 0, bufferSize, mapFlags));
+	if (!mapped) {
+		glDeleteBuffers(1, &id);
+		throw Error("GL::StreamBuffer::StreamBuffer(): glMapNamedBufferRange() failed");
+	}
+
+	// as if an empty frame had just ended in the last part, so that the first one starts at 0
+	partition = PARTITIONS - 1;
+	partitionEnd = partitionSize * PARTITIONS;
+	cursor = partitionEnd - partitionSize;
+}
+
+//---
+
+StreamBuffer::~StreamBuffer()
+{
+	for (GLsync fence : fences) {
+		if (fence) glDeleteSync(fence);
+	}
+	if (id) {
+		glUnmapNamedBuffer(id);
+		glDeleteBuffers(1, &id);
+	}
+}
+
+//---
+
+void StreamBuffer::BeginFrame()
+{
+	stats.peakBytes = std::max(stats.peakBytes, cursor - (partitionEnd - partitionSize));
+	stats.frames++;
+	partition = (partition + 1) % PARTITIONS;
+	cursor = partitionSize * partition;
+	partitionEnd = cursor + partitionSize;
+
+	// a signalled fence costs one query; only an unsignalled one is a stall
+	GLsync &fence = fences[partition];
+	if (fence) {
+		if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+			stats.stalls++;
+			const auto waitStart = std::chrono::steady_clock::now();
+			while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull) == GL_TIMEOUT_EXPIRED) {}
+			stats.waitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
+		}
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+}
+
+//---
+
+void StreamBuffer::Fence()
+{
+	GLsync &fence = fences[partition];
+	if (fence) glDeleteSync(fence);
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+} // namespace GL
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "GLWrapper.h"
+
+namespace GL {
+
+/**
+ * Buffer for streaming per-frame data (instances, vertices) to the GPU:
+ * a ring of PARTITIONS parts of a buffer that is mapped once, persistently
+ * and coherently, so that data is written straight into place, with no
+ * glBufferSubData() copies. A frame writes into one part while the GPU
+ * still reads the previous ones; each part is fenced after its last draw,
+ * and BeginFrame() waits only if the GPU has not finished with it yet.
+ * Requires a current GL 4.5 context for its whole lifetime.
+ */
+class StreamBuffer
+{
+public:
+
+	static const int PARTITIONS = 3;
+
+	/// Tells whether the ring is too small (overflows) or too short for the GPU's lag (stalls).
+	struct Stats {
+		uint64_t frames = 0;
+		uint64_t stalls = 0;		///< Frames whose part the GPU was still reading; BeginFrame() waited.
+		double waitMs = 0.0;		///< Time waited in those.
+		uint64_t overflows = 0;		///< Items dropped because the part was full (see AddOverflow()).
+		size_t peakBytes = 0;		///< Most bytes written in a frame.
+	};
+
+	/// Creates and maps the buffer (PARTITIONS * partitionSize bytes); throws GL::Error on failure.
+	explicit StreamBuffer(size_t partitionSize);
+	StreamBuffer(const StreamBuffer&) = delete;
+	~StreamBuffer();
+
+	GLuint GetId() const { return id; }
+	size_t GetPartitionSize() const { return partitionSize; }
+	const Stats& GetStats() const { return stats; }
+
+	/// Moves on to the next part, waiting for the GPU to finish reading it if need be.
+	void BeginFrame();
+
+	/// Marks the end of the draws that read the current part (call after each batch of them; the last one counts).
+	void Fence();
+
+	/**
+	 * The free space of the current part, aligned for T, to write up to that
+	 * many items before Commit()ing them. Empty if the part is full.
+	 */
+	template <typename T>
+	std::span<T> GetFree()
+	{
+		const size_t start = AlignUp(cursor, sizeof(T));
+		if (start >= partitionEnd) return {};
+		return std::span<T>(reinterpret_cast<T*>(mapped + start), (partitionEnd - start) / sizeof(T));
+	}
+
+	/**
+	 * Takes the first `count` items of GetFree() into the frame.
+	 * \return The index of the first of them in the buffer, in units of T
+	 * (the base instance or first vertex to draw them with).
+	 */
+	template <typename T>
+	GLuint Commit(size_t count)
+	{
+		const size_t start = AlignUp(cursor, sizeof(T));
+		cursor = start + count * sizeof(T);
+		return GLuint(start / sizeof(T));
+	}
+
+	/// Writers report the items they had to drop for lack of space.
+	void AddOverflow(uint64_t count = 1) { stats.overflows += count; }
+
+protected:
+
+	static size_t AlignUp(size_t offset, size_t alignment) { return (offset + alignment - 1) / alignment * alignment; }
+
+	GLuint id = 0;
+	uint8_t* mapped = nullptr;
+	GLsync fences[PARTITIONS] = { nullptr };
+	size_t partitionSize = 0;
+	int partition = 0;
+	size_t cursor = 0;			///< Offset of the free space, from the start of the buffer.
+	size_t partitionEnd = 0;
+	Stats stats;
+};
+
+} // namespace GL
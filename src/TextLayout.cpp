@@ -0,0 +1,171 @@
+#include "TextLayout.h"
+#include "ToUnicode.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+
+//---
+
+/// Lays out [begin, end) as one line with its baseline at y; returns its advance width.
+template <typename Iterator>
+static float EmitLine(const Font &font, Iterator begin, Iterator end, float y,
+	std::vector<TextLayout::Glyph> &glyphs)
+{
+	float x = 0.0f, width = 0.0f;
+	size_t keptCount = glyphs.size();
+	int previous = -1;
+	for (Iterator it = begin; it != end; ++it) {
+		const int charCode = int(*it);
+		stbtt_packedchar glyphGeometry;
+		if (!font.GetGlyphGeometry(charCode, glyphGeometry)) continue;
+		if (previous >= 0) {
+			x += font.GetKernAdvance(previous, charCode);
+		}
+		glyphs.push_back(TextLayout::Glyph{ charCode, x, y });
+		x += glyphGeometry.xadvance;
+		previous = charCode;
+		if (charCode != L' ') {
+			width = x;
+			keptCount = glyphs.size();
+		}
+	}
+
+	// spaces at the end of a wrapped line do not count into its width
+	glyphs.resize(keptCount);
+	return width;
+}
+
+//---
+
+/// TextLayout::Compute() over any forward range of code points.
+template <typename Iterator>
+static void ComputeLayout(const Font &font, Iterator begin, Iterator end, float wrapWidth, TextLayout &result)
+{
+	result.glyphs.clear();
+	result.width = 0.0f;
+	result.lineCount = 0;
+
+	const float lineHeight = font.GetLineHeight();
+	Iterator lineStart = begin;
+	bool moreLines = true;
+	while (moreLines) {
+
+		// find where the line ends: at '\n', at the end of the text,
+		// or at the last space before the line would exceed wrapWidth
+		Iterator lineEnd = end, nextLine = end, lastSpace = end;
+		moreLines = false;
+		float x = 0.0f;
+		int previous = -1;
+		for (Iterator it = lineStart; it != end; ++it) {
+			const int charCode = int(*it);
+			if (charCode == L'\n') {
+				lineEnd = it;
+				nextLine = std::next(it);
+				moreLines = true;
+				break;
+			}
+			if (charCode == L' ') {
+				lastSpace = it;
+			}
+
+			stbtt_packedchar glyphGeometry;
+			if (!font.GetGlyphGeometry(charCode, glyphGeometry)) continue;
+			float advance = glyphGeometry.xadvance;
+			if (previous >= 0) {
+				advance += font.GetKernAdvance(previous, charCode);
+			}
+			if (wrapWidth > 0.0f && charCode != L' ' && x + advance > wrapWidth && lastSpace != end) {
+				lineEnd = lastSpace;
+				nextLine = std::next(lastSpace);
+				moreLines = true;
+				break;
+			}
+			x += advance;
+			previous = charCode;
+		}
+
+		const float baseline = font.GetAscent() + result.lineCount * lineHeight;
+		result.width = std::max(result.width, EmitLine(font, lineStart, lineEnd, baseline, result.glyphs));
+		result.lineCount++;
+		lineStart = nextLine;
+	}
+
+	result.height = result.lineCount * lineHeight;
+}
+
+//---
+
+void TextLayout::Compute(const Font &font, std::wstring_view text, float wrapWidth, TextLayout &result)
+{
+	ComputeLayout(font, text.begin(), text.end(), wrapWidth, result);
+}
+
+//---
+
+void TextLayout::Compute(const Font &font, std::u32string_view text, float wrapWidth, TextLayout &result)
+{
+	ComputeLayout(font, text.begin(), text.end(), wrapWidth, result);
+}
+
+//---
+
+void TextLayout::Compute(const Font &font, std::u8string_view text, float wrapWidth, TextLayout &result)
+{
+	const Utf8Codepoints codepoints(text);
+	ComputeLayout(font, codepoints.begin(), codepoints.end(), wrapWidth, result);
+}
+
+//---
+
+size_t TextLayoutCache::KeyHash::operator()(const KeyView &key) const
+{
+	size_t hash = std::hash<std::string_view>()(key.bytes);
+	hash ^= std::hash<const Font*>()(key.font) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+	hash ^= std::hash<float>()(key.wrapWidth) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+	hash ^= size_t(key.encoding) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+	return hash;
+}
+
+//---
+
+template <typename Text>
+const TextLayout& TextLayoutCache::GetLayout(const Font &font, Encoding encoding, Text text, float wrapWidth)
+{
+	const std::string_view bytes(reinterpret_cast<const char*>(text.data()), text.size() * sizeof(text[0]));
+	auto found = layouts.find(KeyView{ &font, wrapWidth, encoding, bytes });
+	if (found != layouts.end()) {
+		hitCount++;
+		return found->second;
+	}
+
+	missCount++;
+	if (layouts.size() >= capacity) {
+		layouts.clear();
+	}
+
+	auto inserted = layouts.emplace(Key{ &font, wrapWidth, encoding, std::string(bytes) }, TextLayout());
+	TextLayout::Compute(font, text, wrapWidth, inserted.first->second);
+	return inserted.first->second;
+}
+
+//---
+
+const TextLayout& TextLayoutCache::Get(const Font &font, std::wstring_view text, float wrapWidth)
+{
+	return GetLayout(font, Encoding::kUtf32, text, wrapWidth);
+}
+
+//---
+
+const TextLayout& TextLayoutCache::Get(const Font &font, std::u32string_view text, float wrapWidth)
+{
+	return GetLayout(font, Encoding::kUtf32, text, wrapWidth);
+}
+
+//---
+
+const TextLayout& TextLayoutCache::Get(const Font &font, std::u8string_view text, float wrapWidth)
+{
+	return GetLayout(font, Encoding::kUtf8, text, wrapWidth);
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+
+#include "LoadFont.h"
+
+/// Glyphs of a piece of text positioned by TextLayout::Compute().
+struct TextLayout
+{
+	struct Glyph {
+		int charCode;
+		float x;		///< Pen position (glyph origin), relative to the layout origin.
+		float y;		///< Baseline of the glyph's line, relative to the layout origin.
+	};
+
+	std::vector<Glyph> glyphs;
+	float width = 0.0f;		///< Advance width of the longest line.
+	float height = 0.0f;	///< lineCount * the font's line height.
+	int lineCount = 0;
+
+	/**
+	 * Lays out the text: advances with kerning, line breaks at '\n', and
+	 * (if wrapWidth > 0) word wrapping at spaces so that lines fit in wrapWidth
+	 * (a single word longer than that overflows). The layout origin is the top
+	 * left corner; the first baseline is at the font's ascent.
+	 * Characters the font does not cover are skipped. Reusing `result`
+	 * avoids allocations once its glyph vector is large enough.
+	 */
+	static void Compute(const Font &font, std::wstring_view text, float wrapWidth, TextLayout &result);
+	static void Compute(const Font &font, std::u32string_view text, float wrapWidth, TextLayout &result);
+	static void Compute(const Font &font, std::u8string_view text, float wrapWidth, TextLayout &result);
+};
+
+//---
+
+/**
+ * Memoizes layouts keyed by text, font and wrap width, so that text drawn
+ * every frame (e.g. the score label) costs one hash lookup instead of a layout.
+ */
+class TextLayoutCache
+{
+public:
+
+	static const size_t DEFAULT_CAPACITY = 256;
+
+	/// When more than `capacity` layouts are cached, the cache starts over.
+	explicit TextLayoutCache(size_t capacity_ = DEFAULT_CAPACITY) : capacity(capacity_) {}
+
+	/**
+	 * Returns the layout of the text, computing it on the first request.
+	 * The reference stays valid until the next Get() or Clear().
+	 * A lookup does not allocate, whatever the encoding.
+	 */
+	const TextLayout& Get(const Font &font, std::wstring_view text, float wrapWidth = 0.0f);
+	const TextLayout& Get(const Font &font, std::u32string_view text, float wrapWidth = 0.0f);
+	const TextLayout& Get(const Font &font, std::u8string_view text, float wrapWidth = 0.0f);
+
+	void Clear() { layouts.clear(); }
+
+	size_t GetSize() const { return layouts.size(); }
+	uint64_t GetHitCount() const { return hitCount; }
+	uint64_t GetMissCount() const { return missCount; }
+
+protected:
+
+	/// wchar_t holds UTF-32 (see ToUnicode), so wide and UTF-32 text share their keys.
+	enum class Encoding : uint8_t {
+		kUtf8,
+		kUtf32
+	};
+
+	/// The text is kept as its raw bytes, so that any encoding is compared without converting it.
+	struct Key {
+		const Font* font;
+		float wrapWidth;
+		Encoding encoding;
+		std::string bytes;
+	};
+
+	/// Key without the owned string, so that lookups do not allocate.
+	struct KeyView {
+		const Font* font;
+		float wrapWidth;
+		Encoding encoding;
+		std::string_view bytes;
+	};
+
+	struct KeyHash {
+		using is_transparent = void;
+		size_t operator()(const KeyView &key) const;
+		size_t operator()(const Key &key) const { return (*this)(KeyView{ key.font, key.wrapWidth, key.encoding, key.bytes }); }
+	};
+
+	struct KeyEqual {
+		using is_transparent = void;
+		static bool Equal(const KeyView &a, const KeyView &b) {
+			return a.font == b.font && a.wrapWidth == b.wrapWidth && a.encoding == b.encoding && a.bytes == b.bytes;
+		}
+		static KeyView View(const Key &key) { return KeyView{ key.font, key.wrapWidth, key.encoding, key.bytes }; }
+		bool operator()(const Key &a, const Key &b) const { return Equal(View(a), View(b)); }
+		bool operator()(const KeyView &a, const Key &b) const { return Equal(a, View(b)); }
+		bool operator()(const Key &a, const KeyView &b) const { return Equal(View(a), b); }
+	};
+
+	template <typename Text>
+	const TextLayout& GetLayout(const Font &font, Encoding encoding, Text text, float wrapWidth);
+
+	size_t capacity;
+	uint64_t hitCount = 0;
+	uint64_t missCount = 0;
+	std::unordered_map<Key, TextLayout, KeyHash, KeyEqual> layouts;
+};
@@ -0,0 +1,197 @@
+#include "TextRenderer.h"
+#include "TextShaders.h"
+#include "ToUnicode.h"
+
+//---
+
+TextRenderer::TextRenderer(GL::Device &device_, Font &font_, int maxGlyphs_)
+	: device(device_), font(font_), maxGlyphs(maxGlyphs_)
+{
+	// what may throw comes first, so that no GL name is left behind for a destructor that will not run
+	program = std::make_unique<GL::Program>(TextShaders::kVertexShader,
+		font.IsSDF() ? TextShaders::kSdfFragmentShader : TextShaders::kCoverageFragmentShader);
+	stream = std::make_unique<GL::StreamBuffer>(sizeof(GlyphInstance) * size_t(maxGlyphs));
+
+	// the atlas surface is 8 bits per pixel, which maps to a single-channel texture
+	SDL::Surface &surface = font.GetSurface();
+	glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+	glTextureStorage2D(texture, 1, GL_R8, surface.GetWidth(), surface.GetHeight());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, surface.GetPitch());
+	glTextureSubImage2D(texture, 0, 0, 0, surface.GetWidth(), surface.GetHeight(),
+		GL_RED, GL_UNSIGNED_BYTE, surface.GetPixels());
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glCreateVertexArrays(1, &vertexArray);
+	glVertexArrayVertexBuffer(vertexArray, 0, stream->GetId(), 0, sizeof(GlyphInstance));
+	glVertexArrayBindingDivisor(vertexArray, 0, 1);
+	glEnableVertexArrayAttrib(vertexArray, 0);
+	glVertexArrayAttribFormat(vertexArray, 0, 4, GL_FLOAT, GL_FALSE, offsetof(GlyphInstance, rect));
+	glVertexArrayAttribBinding(vertexArray, 0, 0);
+	glEnableVertexArrayAttrib(vertexArray, 1);
+	glVertexArrayAttribFormat(vertexArray, 1, 4, GL_FLOAT, GL_FALSE, offsetof(GlyphInstance, texRect));
+	glVertexArrayAttribBinding(vertexArray, 1, 0);
+	glEnableVertexArrayAttrib(vertexArray, 2);
+	glVertexArrayAttribFormat(vertexArray, 2, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(GlyphInstance, color));
+	glVertexArrayAttribBinding(vertexArray, 2, 0);
+}
+
+//---
+
+TextRenderer::~TextRenderer()
+{
+	if (vertexArray) glDeleteVertexArrays(1, &vertexArray);
+	if (texture) glDeleteTextures(1, &texture);
+	device.Invalidate();	// the names may be bound, and will be reused
+}
+
+//---
+
+void TextRenderer::Begin(int viewportWidth_, int viewportHeight_)
+{
+	viewportWidth = viewportWidth_;
+	viewportHeight = viewportHeight_;
+	glyphCount = 0;
+	flushedCount = 0;
+	stream->BeginFrame();
+	frame = stream->GetFree<GlyphInstance>().first(size_t(maxGlyphs));
+}
+
+//---
+
+template <typename Codepoints>
+float TextRenderer::AddCodepoints(const Codepoints &text, float x, float y, uint32_t color, float pixelSize)
+{
+	const stbtt_packedchar* chars = font.GetPackedChars();
+	SDL::Surface &surface = font.GetSurface();
+	const int atlasWidth = surface.GetWidth(), atlasHeight = surface.GetHeight();
+	const float scale = (pixelSize > 0.0f) ? font.GetScaleForSize(pixelSize) : 1.0f;
+
+	// kerned as in Font::ComputeTextSizeOf(), so that text is drawn as wide as it was measured
+	GlyphInstance* out = frame.data() + glyphCount;
+	int previous = -1;
+	for (auto c : text) {
+		const int charCode = int(c);
+		if (charCode < 0 || charCode >= Font::NUMBER_OF_CHARS) continue;
+		if (previous >= 0) {
+			x += font.GetKernAdvance(previous, charCode) * scale;
+		}
+		previous = charCode;
+
+		stbtt_aligned_quad quad;
+		if (scale == 1.0f) {
+
+			// snap to whole pixels, the atlas is drawn 1:1
+			stbtt_GetPackedQuad(chars, atlasWidth, atlasHeight, charCode, &x, &y, &quad, 1);
+		}
+		else {
+			float penX = 0.0f, penY = 0.0f;
+			stbtt_GetPackedQuad(chars, atlasWidth, atlasHeight, charCode, &penX, &penY, &quad, 0);
+			quad.x0 = x + quad.x0 * scale;
+			quad.y0 = y + quad.y0 * scale;
+			quad.x1 = x + quad.x1 * scale;
+			quad.y1 = y + quad.y1 * scale;
+			x += penX * scale;
+		}
+
+		if (quad.x1 <= quad.x0) continue;	// blank
+		if (glyphCount >= int(frame.size())) {
+			stream->AddOverflow();
+			continue;
+		}
+
+		out->rect[0] = quad.x0;
+		out->rect[1] = quad.y0;
+		out->rect[2] = quad.x1;
+		out->rect[3] = quad.y1;
+		out->texRect[0] = quad.s0;
+		out->texRect[1] = quad.t0;
+		out->texRect[2] = quad.s1;
+		out->texRect[3] = quad.t1;
+		out->color = color;
+		out++;
+		glyphCount++;
+	}
+	return x;
+}
+
+//---
+
+float TextRenderer::AddText(std::wstring_view text, float x, float y, uint32_t color, float pixelSize)
+{
+	return AddCodepoints(text, x, y, color, pixelSize);
+}
+
+//---
+
+float TextRenderer::AddText(std::u32string_view text, float x, float y, uint32_t color, float pixelSize)
+{
+	return AddCodepoints(text, x, y, color, pixelSize);
+}
+
+//---
+
+float TextRenderer::AddText(std::u8string_view text, float x, float y, uint32_t color, float pixelSize)
+{
+	return AddCodepoints(Utf8Codepoints(text), x, y, color, pixelSize);
+}
+
+//---
+
+void TextRenderer::AddLayout(const TextLayout &layout, float x, float y, uint32_t color)
+{
+	const stbtt_packedchar* chars = font.GetPackedChars();
+	SDL::Surface &surface = font.GetSurface();
+	const int atlasWidth = surface.GetWidth(), atlasHeight = surface.GetHeight();
+
+	GlyphInstance* out = frame.data() + glyphCount;
+	for (const TextLayout::Glyph &glyph : layout.glyphs) {
+		float penX = x + glyph.x, penY = y + glyph.y;
+		stbtt_aligned_quad quad;
+		stbtt_GetPackedQuad(chars, atlasWidth, atlasHeight, glyph.charCode, &penX, &penY, &quad, 1);
+
+		if (quad.x1 <= quad.x0) continue;	// blank
+		if (glyphCount >= int(frame.size())) {
+			stream->AddOverflow();
+			continue;
+		}
+
+		out->rect[0] = quad.x0;
+		out->rect[1] = quad.y0;
+		out->rect[2] = quad.x1;
+		out->rect[3] = quad.y1;
+		out->texRect[0] = quad.s0;
+		out->texRect[1] = quad.t0;
+		out->texRect[2] = quad.s1;
+		out->texRect[3] = quad.t1;
+		out->color = color;
+		out++;
+		glyphCount++;
+	}
+}
+
+//---
+
+void TextRenderer::Flush()
+{
+	if (glyphCount == flushedCount) return;
+
+	device.UseProgram(program->GetId());
+	device.ProgramUniform2f(program->GetId(), 0, float(viewportWidth), float(viewportHeight));
+	if (font.IsSDF()) {
+		device.ProgramUniform1f(program->GetId(), 1, float(Font::SDF_ONEDGE_VALUE) / 255.0f);
+	}
+	device.BindTextureUnit(0, texture);
+	device.BindVertexArray(vertexArray);
+	device.SetBlend(true);
+	device.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	const int count = glyphCount - flushedCount;
+	device.DrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, count, stream->Commit<GlyphInstance>(size_t(count)));
+	flushedCount = glyphCount;
+	stream->Fence();
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <memory>
+
+#include "GLWrapper.h"
+#include "GLDevice.h"
+#include "StreamBuffer.h"
+#include "LoadFont.h"
+#include "TextLayout.h"
+
+/**
+ * Draws text from a Font atlas with one instanced draw call per frame.
+ * The atlas is uploaded to a texture once, on construction. Glyph quads
+ * (from stbtt_GetPackedQuad()) are written straight into a GL::StreamBuffer,
+ * and Flush() draws everything added since Begin(), setting GL state through
+ * the GL::Device (which drops whatever is already set).
+ * Requires a current GL 4.5 context for its whole lifetime.
+ */
+class TextRenderer
+{
+public:
+
+	/// Glyphs per frame; the buffer holds GL::StreamBuffer::PARTITIONS frames of them.
+	static const int DEFAULT_MAX_GLYPHS = 16384;
+
+	/// Per-glyph instance data, see TextShaders.h for the attribute layout.
+	struct GlyphInstance {
+		float rect[4];		///< x0, y0, x1, y1 in pixels
+		float texRect[4];	///< s0, t0, s1, t1
+		uint32_t color;		///< RGBA8, R in the lowest byte
+	};
+
+	/// Uploads the atlas and creates the GL objects; throws GL::Error on failure.
+	TextRenderer(GL::Device &device, Font &font, int maxGlyphs = DEFAULT_MAX_GLYPHS);
+	TextRenderer(const TextRenderer&) = delete;
+	~TextRenderer();
+
+	/// Starts a new frame of text for a viewport of the given size.
+	void Begin(int viewportWidth, int viewportHeight);
+
+	/**
+	 * Appends a run of text with its baseline starting at (x, y).
+	 * pixelSize 0 draws at the font's own size; other sizes look right with SDF fonts only.
+	 * Kerned like Font::ComputeTextSize(), so the run is as wide as measured there.
+	 * Glyphs that do not fit in the frame's buffer are dropped.
+	 * Does not allocate; UTF-8 is decoded on the fly.
+	 * \return The pen position after the run (x + advance).
+	 */
+	float AddText(std::wstring_view text, float x, float y,
+		uint32_t color = 0xffffffff, float pixelSize = 0.0f);
+	float AddText(std::u32string_view text, float x, float y,
+		uint32_t color = 0xffffffff, float pixelSize = 0.0f);
+	float AddText(std::u8string_view text, float x, float y,
+		uint32_t color = 0xffffffff, float pixelSize = 0.0f);
+
+	/// Appends laid-out text with its top left corner at (x, y).
+	void AddLayout(const TextLayout &layout, float x, float y, uint32_t color = 0xffffffff);
+
+	/// Draws the text added since Begin() (or the previous Flush()) with a single instanced draw call.
+	void Flush();
+
+	/// Number of glyphs added since Begin().
+	int GetGlyphCount() const { return glyphCount; }
+
+	/// Stalls waiting for the GPU and glyphs dropped for lack of room, see GL::StreamBuffer::Stats.
+	const GL::StreamBuffer::Stats& GetStreamStats() const { return stream->GetStats(); }
+
+protected:
+
+	template <typename Codepoints>
+	float AddCodepoints(const Codepoints &text, float x, float y, uint32_t color, float pixelSize);
+
+	GL::Device &device;
+	Font &font;
+	std::unique_ptr<GL::Program> program;
+	GLuint texture = 0;
+	GLuint vertexArray = 0;
+	std::unique_ptr<GL::StreamBuffer> stream;
+
+	/// The current frame's part of the stream, where glyphs are written.
+	std::span<GlyphInstance> frame;
+
+	int maxGlyphs = 0;
+	int glyphCount = 0;
+	int flushedCount = 0;		///< Glyphs of this frame already drawn by Flush().
+	int viewportWidth = 0;
+	int viewportHeight = 0;
+};
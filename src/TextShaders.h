@@ -0,0 +1,63 @@
+#pragma once
+
+// GLSL sources for drawing text from a Font atlas.
+//
+// Each glyph is one instance of a 4-vertex triangle strip; the corners
+// are derived from gl_VertexID. Per-instance attributes:
+//   location 0: vec4 rect      - x0, y0, x1, y1 in window pixels (y down)
+//   location 1: vec4 texRect   - s0, t0, s1, t1 in the atlas
+//   location 2: vec4 color     - normalized RGBA8
+// Uniforms:
+//   location 0: vec2 viewportSize - in pixels
+//   location 1: float sdfEdge     - Font::SDF_ONEDGE_VALUE / 255 (SDF only)
+//   binding 0:  sampler2D atlas   - single-channel (R8) atlas texture
+
+namespace TextShaders {
+
+static const char* const kVertexShader = R"(
+#version 450 core
+layout(location = 0) in vec4 rect;
+layout(location = 1) in vec4 texRect;
+layout(location = 2) in vec4 color;
+layout(location = 0) uniform vec2 viewportSize;
+out vec2 uv;
+out vec4 tint;
+void main() {
+	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+	vec2 position = mix(rect.xy, rect.zw, corner);
+	uv = mix(texRect.xy, texRect.zw, corner);
+	tint = color;
+	gl_Position = vec4(position / viewportSize * vec2(2.0, -2.0) + vec2(-1.0, 1.0), 0.0, 1.0);
+}
+)";
+
+/// Fragment shader for ordinary (coverage) atlases.
+static const char* const kCoverageFragmentShader = R"(
+#version 450 core
+layout(binding = 0) uniform sampler2D atlas;
+in vec2 uv;
+in vec4 tint;
+out vec4 fragColor;
+void main() {
+	fragColor = vec4(tint.rgb, tint.a * texture(atlas, uv).r);
+}
+)";
+
+/// Fragment shader for signed distance field atlases (Font::Settings::sdf);
+/// the edge is antialiased over one screen pixel at any scale.
+static const char* const kSdfFragmentShader = R"(
+#version 450 core
+layout(binding = 0) uniform sampler2D atlas;
+layout(location = 1) uniform float sdfEdge;
+in vec2 uv;
+in vec4 tint;
+out vec4 fragColor;
+void main() {
+	float distance = texture(atlas, uv).r;
+	float smoothing = max(fwidth(distance) * 0.5, 1.0 / 255.0);
+	float coverage = smoothstep(sdfEdge - smoothing, sdfEdge + smoothing, distance);
+	fragColor = vec4(tint.rgb, tint.a * coverage);
+}
+)";
+
+} // namespace TextShaders
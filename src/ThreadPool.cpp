@@ -0,0 +1,160 @@
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+// the pool (and worker index) of the calling thread, so that tasks submit to their own queue
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local int currentWorker = -1;
+
+} // namespace
+
+//---
+
+ThreadPool::ThreadPool(int threadCount)
+{
+	if (threadCount <= 0) {
+		threadCount = std::max(1, int(std::thread::hardware_concurrency()));
+	}
+	queues.reserve(threadCount);
+	for (int i = 0; i < threadCount; i++) {
+		queues.push_back(std::make_unique<Queue>());
+	}
+	workers.reserve(threadCount);
+	for (int i = 0; i < threadCount; i++) {
+		workers.emplace_back(&ThreadPool::WorkerMain, this, i);
+	}
+}
+
+//---
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeup.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+//---
+
+int ThreadPool::GetCurrentWorker() const
+{
+	return (currentPool == this) ? currentWorker : -1;
+}
+
+//---
+
+void ThreadPool::Submit(std::function<void(void)> task)
+{
+	int index = GetCurrentWorker();
+	if (index < 0) {
+		index = int(nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size());
+	}
+	{
+		std::lock_guard<std::mutex> lock(queues[index]->mutex);
+		queues[index]->tasks.push_back(std::move(task));
+	}
+	pendingCount.fetch_add(1);
+
+	// taking the lock orders this with a worker that is about to sleep, so the wakeup is not lost
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+	}
+	wakeup.notify_one();
+}
+
+//---
+
+void ThreadPool::ParallelFor(int count, const std::function<void(int)>& body)
+{
+	if (count <= 0) return;
+
+	// shared with the helper tasks, which may start only after we are done
+	struct State {
+		std::atomic<int> next { 0 };
+		std::atomic<int> finished { 0 };
+		std::mutex mutex;
+		std::condition_variable allFinished;
+		const std::function<void(int)>* body;
+		int count;
+
+		void Work() {
+			int i;
+			while ((i = next.fetch_add(1)) < count) {
+				(*body)(i);
+				if (finished.fetch_add(1) + 1 == count) {
+					std::lock_guard<std::mutex> lock(mutex);
+					allFinished.notify_all();
+				}
+			}
+		}
+	};
+	auto state = std::make_shared<State>();
+	state->body = &body;
+	state->count = count;
+
+	const int helperCount = std::min(count - 1, GetThreadCount());
+	for (int i = 0; i < helperCount; i++) {
+		Submit([state]() { state->Work(); });
+	}
+
+	state->Work();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->allFinished.wait(lock, [&state]() { return state->finished.load() == state->count; });
+}
+
+//---
+
+bool ThreadPool::RunOneTask(int index)
+{
+	std::function<void(void)> task;
+	const int queueCount = int(queues.size());
+	for (int i = 0; i < queueCount && !task; i++) {
+		Queue &queue = *queues[(index + i) % queueCount];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty()) continue;
+		if (i == 0) {
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		}
+		else {
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		}
+	}
+	if (!task) return false;
+
+	pendingCount.fetch_sub(1);
+	PROFILE_ZONE("ThreadPool task");
+	task();
+	return true;
+}
+
+//---
+
+void ThreadPool::WorkerMain(int index)
+{
+	currentPool = this;
+	currentWorker = index;
+#ifdef PROFILE_ZONES
+	char threadName[32];
+	snprintf(threadName, sizeof(threadName), "worker %d", index);
+	PROFILE_THREAD_NAME(threadName);
+#endif
+	while (1) {
+		if (RunOneTask(index)) continue;
+
+		std::unique_lock<std::mutex> lock(mutex);
+		wakeup.wait(lock, [this]() { return stopping || pendingCount.load() > 0; });
+		if (stopping && pendingCount.load() == 0) return;	// nothing left to do
+	}
+}
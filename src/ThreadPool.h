@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+/**
+ * A fixed set of worker threads executing submitted tasks. Every worker has
+ * its own queue: tasks submitted from a worker go to its queue and are run
+ * newest first (cache-warm, depth-first), workers with nothing to do steal
+ * the oldest tasks from the others, and tasks from other threads are dealt
+ * out round robin.
+ */
+class ThreadPool
+{
+public:
+
+	/// Starts the workers; threadCount 0 means one per hardware thread.
+	explicit ThreadPool(int threadCount = 0);
+	ThreadPool(const ThreadPool&) = delete;
+
+	/// Finishes the queued tasks and joins the workers.
+	~ThreadPool();
+
+	int GetThreadCount() const { return int(workers.size()); }
+
+	/// Index of the calling thread among this pool's workers, -1 for other threads.
+	int GetCurrentWorker() const;
+
+	/// Queues a task for execution on one of the workers.
+	void Submit(std::function<void(void)> task);
+
+	/**
+	 * Calls body(i) for every i in [0, count), spread over the workers
+	 * and the calling thread; returns when all calls have finished.
+	 * Safe to call from within a task (the caller helps instead of blocking).
+	 */
+	void ParallelFor(int count, const std::function<void(int)>& body);
+
+protected:
+
+	struct Queue {
+		std::mutex mutex;
+		std::deque<std::function<void(void)>> tasks;
+	};
+
+	void WorkerMain(int index);
+
+	/// Runs one task: the newest of the worker's own queue, else the oldest one found in another queue.
+	/// \return False if all queues were empty.
+	bool RunOneTask(int index);
+
+	std::vector<std::thread> workers;
+	std::vector<std::unique_ptr<Queue>> queues;
+
+	/// Tasks queued and not yet taken.
+	std::atomic<int> pendingCount { 0 };
+
+	/// Queue for the next task submitted from outside the pool.
+	std::atomic<unsigned> nextQueue { 0 };
+
+	// idle workers sleep on these
+	std::mutex mutex;
+	std::condition_variable wakeup;
+	bool stopping = false;
+};
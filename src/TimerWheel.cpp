@@ -0,0 +1,288 @@
+#include "TimerWheel.h"
+
+#include "SDL.h"
+
+#include <algorithm>
+
+//---
+
+uint64_t TimerWheel::NowNs()
+{
+	const uint64_t counter = SDL_GetPerformanceCounter();
+	const uint64_t frequency = SDL_GetPerformanceFrequency();
+
+	// in two parts, so that counter * 10^9 cannot overflow
+	return (counter / frequency) * 1000000000ull + (counter % frequency) * 1000000000ull / frequency;
+}
+
+//---
+
+TimerWheel::TimerWheel(uint64_t nowNs)
+	: now(nowNs), tick(nowNs >> GRANULARITY_BITS)
+{
+	// list heads: empty lists point to themselves
+	for (uint32_t i = 0; i < FIRST_TIMER; i++) {
+		nodes.emplace_back();
+		nodes[i].prev = nodes[i].next = i;
+	}
+}
+
+//---
+
+TimerWheel::Handle TimerWheel::Add(uint64_t delayNs, std::function<void(void)> callback, uint64_t intervalNs)
+{
+	return AddAt(now + delayNs, std::move(callback), intervalNs);
+}
+
+//---
+
+TimerWheel::Handle TimerWheel::AddAt(uint64_t deadlineNs, std::function<void(void)> callback, uint64_t intervalNs)
+{
+	uint32_t index;
+	if (freeList != NONE) {
+		index = freeList;
+		freeList = nodes[index].next;
+	}
+	else {
+		index = uint32_t(nodes.size());
+		nodes.emplace_back();
+	}
+
+	Node &node = nodes[index];
+	node.active = true;
+	node.deadline = deadlineNs;
+	node.interval = intervalNs;
+	node.callback = std::move(callback);
+	activeCount++;
+	Schedule(index);
+	return MakeHandle(index, node.generation);
+}
+
+//---
+
+bool TimerWheel::Cancel(Handle handle)
+{
+	if (!IsActive(handle)) return false;
+
+	const uint32_t index = uint32_t(handle);
+	Unlink(index);
+	nodes[index].active = false;
+	activeCount--;
+
+	// a callback that cancels its own timer is still running; Fire() frees the timer afterwards
+	if (index != firingIndex) {
+		Free(index);
+	}
+	return true;
+}
+
+//---
+
+bool TimerWheel::IsActive(Handle handle) const
+{
+	const uint32_t index = uint32_t(handle);
+	return index >= FIRST_TIMER && index < nodes.size()
+		&& nodes[index].active && nodes[index].generation == uint32_t(handle >> 32);
+}
+
+//---
+
+int TimerWheel::Advance(uint64_t nowNs)
+{
+	now = std::max(now, nowNs);
+	const uint64_t target = now >> GRANULARITY_BITS;
+
+	int fired = 0;
+	while (tick < target) {
+		if (activeCount == 0) {
+			tick = target;
+			break;
+		}
+
+		// the whole slot is due: its deadlines are before the start of the next tick
+		fired += Fire(uint32_t(tick & (SLOTS - 1)));
+		tick++;
+		CascadeTurns();
+
+		// skip the empty slots at once (after a long sleep there may be billions of them)
+		if (IsEmpty(uint32_t(tick & (SLOTS - 1)))) {
+			uint32_t list;
+			const uint64_t next = std::min(FindBusyTick(list), target);
+			if (next != tick) {
+				tick = next;
+				CascadeTurns();
+			}
+		}
+	}
+
+	// the current tick only partly
+	fired += Fire(uint32_t(tick & (SLOTS - 1)));
+	return fired;
+}
+
+//---
+
+uint64_t TimerWheel::GetNextDeadline() const
+{
+	if (activeCount == 0) return UINT64_MAX;
+
+	uint32_t list;
+	const uint64_t busyTick = FindBusyTick(list);
+	if (list >= SLOTS) {
+		return busyTick << GRANULARITY_BITS;
+	}
+
+	// a level 0 slot: the exact earliest deadline
+	uint64_t deadline = UINT64_MAX;
+	for (uint32_t i = nodes[list].next; i != list; i = nodes[i].next) {
+		deadline = std::min(deadline, nodes[i].deadline);
+	}
+	return deadline;
+}
+
+//---
+
+void TimerWheel::Link(uint32_t list, uint32_t index)
+{
+	Node &node = nodes[index];
+	node.prev = nodes[list].prev;
+	node.next = list;
+	nodes[node.prev].next = index;
+	nodes[list].prev = index;
+}
+
+//---
+
+void TimerWheel::Unlink(uint32_t index)
+{
+	Node &node = nodes[index];
+	nodes[node.prev].next = node.next;
+	nodes[node.next].prev = node.prev;
+	node.prev = node.next = index;
+}
+
+//---
+
+void TimerWheel::Schedule(uint32_t index)
+{
+	// the lowest level whose current turn includes the deadline
+	const uint64_t deadlineTick = std::max(nodes[index].deadline >> GRANULARITY_BITS, tick);
+	for (int level = 0; level < LEVELS; level++) {
+		const int turnShift = SLOT_BITS * (level + 1);
+		if ((deadlineTick >> turnShift) == (tick >> turnShift)) {
+			const uint64_t slot = (deadlineTick >> (SLOT_BITS * level)) & (SLOTS - 1);
+			Link(uint32_t(level * SLOTS + slot), index);
+			return;
+		}
+	}
+	Link(FAR_LIST, index);
+}
+
+//---
+
+void TimerWheel::Cascade(uint32_t list)
+{
+	// the list is emptied first: timers far beyond the wheel go back to FAR_LIST
+	uint32_t index = nodes[list].next;
+	nodes[list].prev = nodes[list].next = list;
+	while (index != list) {
+		const uint32_t next = nodes[index].next;
+		Schedule(index);
+		index = next;
+	}
+}
+
+//---
+
+void TimerWheel::CascadeTurns()
+{
+	// where a turn of level 0 starts, the next slot of level 1 comes down (and so on up)
+	int turns = 0;
+	while (turns < LEVELS && (tick & ((uint64_t(1) << (SLOT_BITS * (turns + 1))) - 1)) == 0) {
+		turns++;
+	}
+	if (turns == LEVELS) {
+		Cascade(FAR_LIST);
+	}
+	for (int level = std::min(turns, LEVELS - 1); level >= 1; level--) {
+		Cascade(uint32_t(level * SLOTS + ((tick >> (SLOT_BITS * level)) & (SLOTS - 1))));
+	}
+}
+
+//---
+
+uint64_t TimerWheel::FindBusyTick(uint32_t &list) const
+{
+	// the rest of the current turn of each level, slot by slot; on level 0 that
+	// is the tick the slot fires, on the others the tick it cascades down
+	for (int level = 0; level < LEVELS; level++) {
+		const int shift = SLOT_BITS * level;
+		const uint64_t turnStart = (tick >> (shift + SLOT_BITS)) << (shift + SLOT_BITS);
+		const uint64_t first = ((tick >> shift) & (SLOTS - 1)) + (level > 0 ? 1 : 0);
+		for (uint64_t slot = first; slot < SLOTS; slot++) {
+			if (!IsEmpty(uint32_t(level * SLOTS + slot))) {
+				list = uint32_t(level * SLOTS + slot);
+				return turnStart | (slot << shift);
+			}
+		}
+	}
+	list = FAR_LIST;
+	return ((tick >> (SLOT_BITS * LEVELS)) + 1) << (SLOT_BITS * LEVELS);
+}
+
+//---
+
+int TimerWheel::Fire(uint32_t slot)
+{
+	if (IsEmpty(slot)) return 0;
+
+	// move the slot's timers aside, as callbacks may add timers to the slot, or cancel ones in it
+	nodes[nodes[slot].next].prev = FIRING_LIST;
+	nodes[nodes[slot].prev].next = FIRING_LIST;
+	nodes[FIRING_LIST].next = nodes[slot].next;
+	nodes[FIRING_LIST].prev = nodes[slot].prev;
+	nodes[slot].prev = nodes[slot].next = slot;
+
+	int fired = 0;
+	while (!IsEmpty(FIRING_LIST)) {
+		const uint32_t index = nodes[FIRING_LIST].next;
+		Node &node = nodes[index];
+		Unlink(index);
+		if (node.deadline > now) {
+			Link(slot, index);		// later in the current tick
+			continue;
+		}
+
+		fired++;
+		if (node.interval == 0) {
+			std::function<void(void)> callback = std::move(node.callback);
+			node.active = false;
+			activeCount--;
+			Free(index);
+			callback();
+			continue;
+		}
+
+		// the next period after now: missed periods are skipped rather than fired in a burst
+		node.deadline += node.interval * ((now - node.deadline) / node.interval + 1);
+		Schedule(index);
+		firingIndex = index;
+		node.callback();
+		firingIndex = NONE;
+		if (!node.active) {
+			Free(index);
+		}
+	}
+	return fired;
+}
+
+//---
+
+void TimerWheel::Free(uint32_t index)
+{
+	Node &node = nodes[index];
+	node.callback = nullptr;
+	node.generation++;
+	node.next = freeList;
+	freeList = index;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+/**
+ * Timers for the main thread (gem animations, effects, delays): a
+ * hierarchical timer wheel of LEVELS levels of SLOTS slots each. Level 0
+ * has one slot per GRANULARITY_NS; a slot of each next level spans a whole
+ * turn of the level below, and its timers move down a level when the level
+ * below gets to it. Adding and cancelling a timer is O(1); Advance() runs
+ * the callbacks that are due, on the calling thread.
+ *
+ * Deadlines are kept in nanoseconds: a timer fires at the first Advance()
+ * at or after its deadline, never early. Timers due in the same Advance()
+ * fire in the order of their slots (GRANULARITY_NS), not strictly by deadline.
+ */
+class TimerWheel
+{
+public:
+
+	/// Identifies a timer; stays unique (a stale handle is simply not active). 0 is never a timer.
+	using Handle = uint64_t;
+
+	static const int LEVELS = 4;
+	static const int SLOT_BITS = 8;
+	static const int SLOTS = 1 << SLOT_BITS;
+
+	/// Width of a level 0 slot: 2^16 ns, about 66 us (the whole wheel covers 78 hours; later timers wait aside).
+	static const int GRANULARITY_BITS = 16;
+	static const uint64_t GRANULARITY_NS = uint64_t(1) << GRANULARITY_BITS;
+
+	/// The current time in nanoseconds, from SDL_GetPerformanceCounter().
+	static uint64_t NowNs();
+
+	explicit TimerWheel(uint64_t nowNs = NowNs());
+	TimerWheel(const TimerWheel&) = delete;
+
+	/**
+	 * Starts a timer that calls back delayNs after the time of the last Advance()
+	 * (or construction), then every intervalNs if that is not 0.
+	 */
+	Handle Add(uint64_t delayNs, std::function<void(void)> callback, uint64_t intervalNs = 0);
+
+	/// Same as Add(), with an absolute deadline (NowNs() time).
+	Handle AddAt(uint64_t deadlineNs, std::function<void(void)> callback, uint64_t intervalNs = 0);
+
+	/// Stops a timer; callable from its own callback. \return False if it was not active (fired or cancelled).
+	bool Cancel(Handle handle);
+
+	bool IsActive(Handle handle) const;
+
+	/// Runs the callbacks of the timers due at nowNs. \return The number of callbacks run.
+	int Advance(uint64_t nowNs = NowNs());
+
+	size_t GetActiveCount() const { return activeCount; }
+
+	/// The time of the last Advance() (or construction).
+	uint64_t GetTime() const { return now; }
+
+	/**
+	 * A time at or before the next deadline, for sleeping until then;
+	 * exact if the next timer is due within a turn of level 0.
+	 * \return UINT64_MAX if there are no timers.
+	 */
+	uint64_t GetNextDeadline() const;
+
+protected:
+
+	static const uint32_t NONE = 0xffffffff;
+
+	/// Timer, or the head of a list (the slots, the far future list and the list being fired).
+	struct Node {
+		uint32_t prev;
+		uint32_t next;
+		uint32_t generation = 1;
+		bool active = false;
+		uint64_t deadline = 0;
+		uint64_t interval = 0;
+		std::function<void(void)> callback;
+	};
+
+	static const uint32_t FAR_LIST = LEVELS * SLOTS;	///< Timers beyond the wheel's reach.
+	static const uint32_t FIRING_LIST = FAR_LIST + 1;	///< Timers of the slot being fired.
+	static const uint32_t FIRST_TIMER = FIRING_LIST + 1;
+
+	static Handle MakeHandle(uint32_t index, uint32_t generation) { return (uint64_t(generation) << 32) | index; }
+
+	void Link(uint32_t list, uint32_t index);
+	void Unlink(uint32_t index);
+	bool IsEmpty(uint32_t list) const { return nodes[list].next == list; }
+
+	/// Puts a timer in the list its deadline belongs to, seen from the current tick.
+	void Schedule(uint32_t index);
+
+	/// Moves the timers of a list back to their proper (lower) slots.
+	void Cascade(uint32_t list);
+
+	/// Cascades the slots whose turn starts at the current tick.
+	void CascadeTurns();
+
+	/// The first tick (from the current one) at which an occupied list fires or cascades. \param list Set to that list.
+	uint64_t FindBusyTick(uint32_t &list) const;
+
+	/// Runs the timers of a level 0 slot that are due at `now`; the others go back to the slot.
+	int Fire(uint32_t slot);
+
+	void Free(uint32_t index);
+
+	/// Stable storage (callbacks run in place while others are added).
+	std::deque<Node> nodes;
+	uint32_t freeList = NONE;
+
+	uint64_t now;
+	uint64_t tick;				///< now / GRANULARITY_NS, up to which the wheel has turned.
+	size_t activeCount = 0;
+	uint32_t firingIndex = NONE;	///< The timer whose callback is running.
+};
@@ -1,30 +1,225 @@
 #include "ToUnicode.h"
-#include "SDL.h"
-#include <iostream>
-#include <cwchar>
 
-std::wstring MultibyteToWideString(const char* source)
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__SSE2__)
+#define TOUNICODE_X86 1
+#include <immintrin.h>
+#endif
+
+static_assert(sizeof(wchar_t) == sizeof(char32_t), "wchar_t must hold UTF-32");
+
+namespace {
+
+//---
+
+/**
+ * Decodes one sequence whose lead byte is not ASCII (ranges per the Unicode
+ * standard, table 3-7: no overlongs, surrogates or code points above U+10FFFF).
+ * \return The length of the sequence; on error, minus the length of its
+ * maximal valid prefix (at least 1), and `status` is set.
+ */
+inline int DecodeSequence(const uint8_t* p, const uint8_t* end, char32_t &codepoint, Utf8Status &status)
+{
+	const uint8_t lead = p[0];
+	int length;
+	uint8_t low = 0x80, high = 0xbf;	// allowed range of the second byte
+	if (lead >= 0xc2 && lead <= 0xdf) {
+		length = 2;
+		codepoint = lead & 0x1f;
+	}
+	else if (lead >= 0xe0 && lead <= 0xef) {
+		length = 3;
+		codepoint = lead & 0x0f;
+		if (lead == 0xe0) low = 0xa0;
+		if (lead == 0xed) high = 0x9f;
+	}
+	else if (lead >= 0xf0 && lead <= 0xf4) {
+		length = 4;
+		codepoint = lead & 0x07;
+		if (lead == 0xf0) low = 0x90;
+		if (lead == 0xf4) high = 0x8f;
+	}
+	else {
+		status = Utf8Status::InvalidSequence;
+		return -1;
+	}
+
+	for (int i = 1; i < length; i++) {
+		if (p + i >= end) {
+			status = Utf8Status::Truncated;
+			return -i;
+		}
+		const uint8_t byte = p[i];
+		if (byte < low || byte > high) {
+			status = Utf8Status::InvalidSequence;
+			return -i;
+		}
+		codepoint = (codepoint << 6) | (byte & 0x3f);
+		low = 0x80;
+		high = 0xbf;
+	}
+	return length;
+}
+
+//---
+
+#ifdef TOUNICODE_X86
+
+/// Widens 16 bytes to 16 code points; returns how many of them are ASCII
+/// before the first non-ASCII byte (only those are valid output).
+inline size_t WidenAsciiSSE2(const uint8_t* in, void* out)
+{
+	const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i low = _mm_unpacklo_epi8(bytes, zero);
+	const __m128i high = _mm_unpackhi_epi8(bytes, zero);
+	__m128i* dest = static_cast<__m128i*>(out);
+	_mm_storeu_si128(dest + 0, _mm_unpacklo_epi16(low, zero));
+	_mm_storeu_si128(dest + 1, _mm_unpackhi_epi16(low, zero));
+	_mm_storeu_si128(dest + 2, _mm_unpacklo_epi16(high, zero));
+	_mm_storeu_si128(dest + 3, _mm_unpackhi_epi16(high, zero));
+
+	const unsigned mask = unsigned(_mm_movemask_epi8(bytes));
+	return mask ? size_t(__builtin_ctz(mask)) : 16;
+}
+
+/// Same as WidenAsciiSSE2(), 32 bytes at a time.
+__attribute__((target("avx2")))
+size_t WidenAsciiAVX2(const uint8_t* in, void* out)
+{
+	const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+	__m256i* dest = static_cast<__m256i*>(out);
+	for (int i = 0; i < 4; i++) {
+		const __m128i eight = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + 8 * i));
+		_mm256_storeu_si256(dest + i, _mm256_cvtepu8_epi32(eight));
+	}
+
+	const unsigned mask = unsigned(_mm256_movemask_epi8(bytes));
+	return mask ? size_t(__builtin_ctz(mask)) : 32;
+}
+
+#endif
+
+//---
+
+/**
+ * The decoding loop: blocks of ASCII go through the vector path `widen`
+ * (which handles `blockSize` bytes at once), everything else through
+ * DecodeSequence().
+ */
+template <typename OutChar, size_t blockSize, size_t (*widen)(const uint8_t*, void*)>
+Utf8DecodeResult Decode(const char* source, size_t size, OutChar* output, size_t capacity)
 {
-	std::wstring result;
+	Utf8DecodeResult result;
+	const uint8_t* const begin = reinterpret_cast<const uint8_t*>(source);
+	const uint8_t* const end = begin + size;
+	const uint8_t* p = begin;
+	OutChar* out = output;
+	OutChar* const outEnd = output + capacity;
 
-	const char* p = source;
-	size_t messageCharCount = 0;
+	while (p < end) {
+		if constexpr (blockSize > 0) {
 
-	// calculate the number of wide characters needed (also checks encoding validity)
-	{
-		auto mbstate = std::mbstate_t();
-		messageCharCount = std::mbsrtowcs(nullptr, &p, 0, &mbstate);
-		if (messageCharCount == size_t(-1)) {
-			SDL_SetError("Invalid character sequence");
-			return result;
+			// only worth trying at the start of an ASCII run
+			while (*p < 0x80 && size_t(end - p) >= blockSize && size_t(outEnd - out) >= blockSize) {
+				const size_t asciiCount = widen(p, out);
+				p += asciiCount;
+				out += asciiCount;
+				if (asciiCount < blockSize || p >= end) break;
+			}
+			if (p >= end) break;
 		}
-	}	
 
-	result.resize(messageCharCount);
-	{
-		auto mbstate = std::mbstate_t();
-		p = source;
-		std::mbsrtowcs(const_cast<wchar_t*>(result.data()), &p, messageCharCount, &mbstate);
+		if (out >= outEnd) {
+			result.status = Utf8Status::OutputFull;
+			break;
+		}
+		if (*p < 0x80) {
+			*out++ = OutChar(*p++);
+			continue;
+		}
+
+		char32_t codepoint;
+		const int length = DecodeSequence(p, end, codepoint, result.status);
+		if (length < 0) {
+			result.errorLength = size_t(-length);
+			break;
+		}
+		*out++ = OutChar(codepoint);
+		p += length;
 	}
+
+	result.written = size_t(out - output);
+	result.consumed = size_t(p - begin);
 	return result;
 }
+
+//---
+
+template <typename OutChar>
+Utf8DecodeResult DecodeDispatch(const char* source, size_t size, OutChar* output, size_t capacity)
+{
+#ifdef TOUNICODE_X86
+	static const bool haveAVX2 = __builtin_cpu_supports("avx2");
+	if (haveAVX2) {
+		return Decode<OutChar, 32, WidenAsciiAVX2>(source, size, output, capacity);
+	}
+	return Decode<OutChar, 16, WidenAsciiSSE2>(source, size, output, capacity);
+#else
+	return Decode<OutChar, 0, nullptr>(source, size, output, capacity);
+#endif
+}
+
+} // namespace
+
+//---
+
+Utf8DecodeResult DecodeUtf8(const char* source, size_t size, char32_t* output, size_t capacity)
+{
+	return DecodeDispatch(source, size, output, capacity);
+}
+
+//---
+
+Utf8DecodeResult DecodeUtf8(const char* source, size_t size, wchar_t* output, size_t capacity)
+{
+	return DecodeDispatch(source, size, output, capacity);
+}
+
+//---
+
+std::wstring MultibyteToWideString(const char* source)
+{
+	const size_t size = strlen(source);
+
+	// every byte yields at most one character (or one U+FFFD)
+	std::wstring result(size, L'\0');
+	size_t consumed = 0, written = 0;
+	while (consumed < size) {
+		const Utf8DecodeResult decoded = DecodeUtf8(source + consumed, size - consumed,
+			result.data() + written, size - written);
+		consumed += decoded.consumed;
+		written += decoded.written;
+		if (decoded.status == Utf8Status::Ok) break;
+
+		result[written++] = L'\xfffd';
+		consumed += decoded.errorLength;
+	}
+	result.resize(written);
+	return result;
+}
+
+//---
+
+void Utf8Iterator::DecodeMultibyte()
+{
+	Utf8Status status = Utf8Status::Ok;
+	length = DecodeSequence(reinterpret_cast<const uint8_t*>(position),
+		reinterpret_cast<const uint8_t*>(end), codepoint, status);
+	if (length < 0) {
+		codepoint = U'\xfffd';
+		length = -length;
+	}
+}
@@ -1,13 +1,105 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <string_view>
+#include <iterator>
+#include <cstddef>
+
+/// Outcome of DecodeUtf8().
+enum class Utf8Status {
+	Ok,					///< The whole input was decoded.
+	InvalidSequence,	///< Malformed, overlong, surrogate or out-of-range sequence at `consumed`.
+	Truncated,			///< The input ends in the middle of a sequence (at `consumed`).
+	OutputFull,			///< The output buffer is full; decoding can continue from `consumed`.
+};
+
+struct Utf8DecodeResult {
+	size_t written = 0;		///< Code points stored into the output.
+	size_t consumed = 0;	///< Input bytes decoded; on error, the offset of the bad sequence.
+	size_t errorLength = 0;	///< On error, the length of the bad sequence (its maximal valid prefix, at least 1).
+	Utf8Status status = Utf8Status::Ok;
+};
+
+/**
+ * Decodes UTF-8 into UTF-32 in a single pass, independently of the locale.
+ * Decoding stops at the first invalid sequence; the error is reported in the
+ * result, together with everything decoded before it. Runs of ASCII are
+ * widened with SSE2 (or AVX2, when the CPU has it).
+ * An output buffer of `size` code points is always large enough.
+ */
+Utf8DecodeResult DecodeUtf8(const char* source, size_t size, char32_t* output, size_t capacity);
+
+/// Same as above, for wide strings (wchar_t holds UTF-32 on the supported platforms).
+Utf8DecodeResult DecodeUtf8(const char* source, size_t size, wchar_t* output, size_t capacity);
 
 /**
- * Converts a string from multibyte encoding to wide string
- * (under normal conditions, it is from utf-8 to Unicode).
+ * Converts a string from UTF-8 to a wide string.
+ * Invalid sequences are replaced with U+FFFD (one per maximal invalid
+ * subpart), so errors remain visible in the result.
  * \return The new wide string.
- * \bug If an error occurs, an empty string is returned,
- * and SDL_Error is set; however, without querying SDL_Error,
- * there is no way to tell if that happened.
  */
 std::wstring MultibyteToWideString(const char* source);
+
+/**
+ * Forward iterator that decodes UTF-8 lazily, one code point per step,
+ * so that text can be measured and drawn straight from a u8string_view
+ * without converting it into a buffer first. Invalid sequences decode
+ * as U+FFFD, as in MultibyteToWideString().
+ */
+class Utf8Iterator {
+public:
+
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = char32_t;
+	using difference_type = std::ptrdiff_t;
+	using pointer = const char32_t*;
+	using reference = char32_t;
+
+	Utf8Iterator() = default;
+	Utf8Iterator(const char8_t* position_, const char8_t* end_) : position(position_), end(end_) { Decode(); }
+
+	char32_t operator*() const { return codepoint; }
+	Utf8Iterator& operator++() { position += length; Decode(); return *this; }
+	Utf8Iterator operator++(int) { Utf8Iterator previous = *this; ++(*this); return previous; }
+	bool operator==(const Utf8Iterator &other) const { return position == other.position; }
+	bool operator!=(const Utf8Iterator &other) const { return position != other.position; }
+
+	/// Returns the first byte of the current code point.
+	const char8_t* GetPosition() const { return position; }
+
+protected:
+
+	void Decode()
+	{
+		if (position == end) {
+			length = 0;
+		}
+		else if (*position < 0x80) {
+			codepoint = *position;
+			length = 1;
+		}
+		else {
+			DecodeMultibyte();
+		}
+	}
+
+	void DecodeMultibyte();
+
+	const char8_t* position = nullptr;
+	const char8_t* end = nullptr;
+	char32_t codepoint = 0;
+	int length = 0;		///< Bytes of the current code point.
+};
+
+/// The code points of a UTF-8 string, for range-based for loops.
+class Utf8Codepoints {
+public:
+
+	explicit Utf8Codepoints(std::u8string_view text_) : text(text_) {}
+	Utf8Iterator begin() const { return Utf8Iterator(text.data(), text.data() + text.size()); }
+	Utf8Iterator end() const { return Utf8Iterator(text.data() + text.size(), text.data() + text.size()); }
+
+protected:
+
+	std::u8string_view text;
+};